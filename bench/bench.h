@@ -0,0 +1,77 @@
+#pragma once
+
+#include <CPU.h>
+#include <functional>
+#include <instructions.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Builds guest code for 0x8000, where CPU(program, size) loads it,
+ * one instruction at a time.
+ * */
+class Assembler {
+  public:
+    uint16_t Here() { return 0x8000 + m_code.size(); }
+
+    void Op(Instruction op) { m_code.push_back(op); }
+
+    void Op(Instruction op, uint8_t operand) {
+        m_code.insert(m_code.end(), {uint8_t(op), operand});
+    }
+
+    void Op16(Instruction op, uint16_t address) {
+        auto [low, high] = bytes_from_address(address);
+        m_code.insert(m_code.end(), {uint8_t(op), low, high});
+    }
+
+    /**
+     * @brief A branch back to target.
+     * */
+    void Branch(Instruction op, uint16_t target) {
+        int offset = target - (Here() + 2);
+        ASSERT(offset >= -128, "Branch out of range")
+        Op(op, uint8_t(offset));
+    }
+
+    /**
+     * @brief A branch to a later Bind of the returned position.
+     * */
+    size_t Forward(Instruction op) {
+        Op(op, 0);
+        return m_code.size() - 1;
+    }
+
+    void Bind(size_t position) {
+        size_t offset = m_code.size() - (position + 1);
+        ASSERT(offset <= 127, "Branch out of range")
+        m_code[position] = offset;
+    }
+
+    const std::vector<uint8_t>& GetCode() { return m_code; }
+
+  private:
+    std::vector<uint8_t> m_code;
+};
+
+/**
+ * @brief Guest code plus what it needs to run. Every iteration of a
+ * benchmark restores the CPU to its state after setup, then runs it for
+ * cycle_budget cycles or until it traps.
+ * */
+struct Workload {
+    std::string name;
+    std::vector<uint8_t> code;
+    std::function<void(CPU&)> setup; // data, vectors and registers, or null
+    std::function<bool(CPU&)> check; // validates the last run, or null
+    uint64_t cycle_budget;
+};
+
+/**
+ * @brief Register name/<engine> for every engine, reporting the emulated
+ * clock rate and the host time per guest instruction.
+ * */
+void RegisterWorkload(Workload workload);
+
+void RegisterOpBenchmarks();
+void RegisterProgramBenchmarks();
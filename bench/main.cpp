@@ -0,0 +1,87 @@
+#include "bench.h"
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <trace.h>
+
+class CountingSink : public TraceSink {
+  public:
+    void Trace(CPU&) override { m_count++; }
+
+    uint64_t GetCount() { return m_count; }
+
+  private:
+    uint64_t m_count = 0;
+};
+
+static std::unique_ptr<CPU> make_cpu(const Workload& workload,
+                                     Engine engine) {
+    auto cpu = std::make_unique<CPU>(const_cast<uint8_t*>(workload.code.data()),
+                                     workload.code.size(), engine);
+    if (workload.setup) {
+        workload.setup(*cpu);
+    }
+    return cpu;
+}
+
+static void run(benchmark::State& state, const Workload& workload,
+                Engine engine, uint64_t instructions) {
+    auto cpu = make_cpu(workload, engine);
+    CPU::State start = cpu->Snapshot();
+    uint64_t cycles = 0;
+    for (auto _ : state) {
+        // Only the pages the last iteration wrote are restored.
+        cpu->Restore(start);
+        cpu->Run(workload.cycle_budget);
+        cycles += cpu->GetCycles() - start.cycles;
+    }
+
+    if (workload.check && !workload.check(*cpu)) {
+        state.SkipWithError("The guest program computed a wrong result");
+    }
+    // Shown as emulated_Hz=<guest cycles per host second> and
+    // per_inst=<host time per guest instruction>.
+    double total = double(instructions) * state.iterations();
+    state.SetItemsProcessed(total);
+    state.counters["emulated_Hz"] =
+        benchmark::Counter(cycles, benchmark::Counter::kIsRate);
+    state.counters["per_inst"] = benchmark::Counter(
+        total, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+void RegisterWorkload(Workload workload) {
+    // Every engine runs the same instructions, so a traced run on the table
+    // engine counts them once for all.
+    CountingSink sink;
+    auto cpu = make_cpu(workload, Engine::Table);
+    cpu->SetTraceSink(&sink);
+    cpu->Run(workload.cycle_budget);
+    uint64_t instructions = sink.GetCount();
+
+    static const std::pair<const char*, Engine> engines[] = {
+        {"table", Engine::Table},
+        {"threaded", Engine::Threaded},
+        {"predecoded", Engine::Predecoded},
+        {"jit", Engine::Jit},
+    };
+    auto shared = std::make_shared<Workload>(std::move(workload));
+    for (auto [name, engine] : engines) {
+        benchmark::RegisterBenchmark(
+            (shared->name + "/" + name).c_str(),
+            [shared, engine = engine, instructions](benchmark::State& state) {
+                run(state, *shared, engine, instructions);
+            });
+    }
+}
+
+int main(int argc, char** argv) {
+    RegisterOpBenchmarks();
+    RegisterProgramBenchmarks();
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
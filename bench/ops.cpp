@@ -0,0 +1,154 @@
+#include "bench.h"
+
+using I = Instruction;
+
+// Copies of the block per loop, so the closing JMP is a small share.
+#define BLOCK_COPIES 64
+
+/**
+ * @brief A loop of BLOCK_COPIES blocks. The registers start at X = Y = 5
+ * and the pointers at 0x20 and 0x25 lead to 0x0300.
+ * */
+static void repeat(const std::string& name,
+                   const std::function<void(Assembler&)>& block) {
+    Assembler code;
+    for (int i = 0; i < BLOCK_COPIES; i++) {
+        block(code);
+    }
+    code.Op16(I::JMP_ABS, 0x8000);
+
+    auto setup = [](CPU& cpu) {
+        cpu.X = 5;
+        cpu.Y = 5;
+        for (uint8_t pointer : {0x20, 0x25}) {
+            cpu.GetMemory().write(pointer, 0x00);
+            cpu.GetMemory().write(pointer + 1, 0x03);
+        }
+    };
+    RegisterWorkload({name, code.GetCode(), setup, nullptr, 20000});
+}
+
+static void op(const std::string& name, Instruction instruction) {
+    repeat(name, [=](Assembler& code) { code.Op(instruction); });
+}
+
+static void op(const std::string& name, Instruction instruction,
+               uint8_t operand) {
+    repeat(name, [=](Assembler& code) { code.Op(instruction, operand); });
+}
+
+static void op16(const std::string& name, Instruction instruction,
+                 uint16_t address) {
+    repeat(name, [=](Assembler& code) { code.Op16(instruction, address); });
+}
+
+/**
+ * @brief One benchmark per INST_* handler family, in its most common
+ * addressing mode, and one per ADDR_* mode, with LDA where it has the mode.
+ * */
+void RegisterOpBenchmarks() {
+    op("op/ADC", I::ADC_IMM, 0x01);
+    op("op/SBC", I::SBC_IMM, 0x01);
+    op("op/AND", I::AND_IMM, 0xF7);
+    op("op/ORA", I::ORA_IMM, 0x01);
+    op("op/EOR", I::EOR_IMM, 0xFF);
+    op("op/CMP", I::CMP_IMM, 0x40);
+    op("op/CMX", I::CMX_IMM, 0x40);
+    op("op/CMY", I::CMY_IMM, 0x40);
+    op("op/BIT", I::BIT_ZP, 0x10);
+    op("op/LDA", I::LDA_IMM, 0x5A);
+    op("op/LDX", I::LDX_IMM, 0x5A);
+    op("op/LDY", I::LDY_IMM, 0x5A);
+    op("op/STA", I::STA_ZP, 0x10);
+    op("op/STX", I::STX_ZP, 0x11);
+    op("op/STY", I::STY_ZP, 0x12);
+    op("op/INC", I::INC_ZP, 0x10);
+    op("op/DEC", I::DEC_ZP, 0x10);
+    op("op/ASL", I::ASL_ZP, 0x10);
+    op("op/LSR", I::LSR_ZP, 0x10);
+    op("op/ROL", I::ROL_ZP, 0x10);
+    op("op/ROR", I::ROR_ZP, 0x10);
+    op("op/ASL_ACC", I::ASL_ACC);
+    op("op/LSR_ACC", I::LSR_ACC);
+    op("op/ROL_ACC", I::ROL_ACC);
+    op("op/ROR_ACC", I::ROR_ACC);
+    op("op/INX", I::INX);
+    op("op/INY", I::INY);
+    op("op/DEX", I::DEX);
+    op("op/DEY", I::DEY);
+    op("op/NOP", I::NOP);
+    repeat("op/STATUS", [](Assembler& code) {
+        code.Op(I::SEC);
+        code.Op(I::CLC);
+        code.Op(I::SEI);
+        code.Op(I::CLI);
+    });
+    repeat("op/TRANSFER", [](Assembler& code) {
+        code.Op(I::TAX);
+        code.Op(I::TAY);
+        code.Op(I::TXA);
+        code.Op(I::TYA);
+    });
+    repeat("op/PUSH_PULL", [](Assembler& code) {
+        code.Op(I::PHA);
+        code.Op(I::PLA);
+        code.Op(I::PHP);
+        code.Op(I::PLP);
+    });
+    // Carry is clear: one taken and one untaken branch to the next op_code.
+    repeat("op/BRANCH", [](Assembler& code) {
+        code.Op(I::BCC, 0x00);
+        code.Op(I::BCS, 0x00);
+    });
+    repeat("op/JMP", [](Assembler& code) {
+        code.Op16(I::JMP_ABS, code.Here() + 3);
+    });
+    {
+        // BRK and its padding byte, serviced by an RTI at 0x9000.
+        Assembler code;
+        for (int i = 0; i < BLOCK_COPIES; i++) {
+            code.Op(I::BRK, I::NOP);
+        }
+        code.Op16(I::JMP_ABS, 0x8000);
+        auto setup = [](CPU& cpu) {
+            cpu.GetMemory().write(0x9000, I::RTI);
+            cpu.GetMemory().write(0xFFFE, 0x00);
+            cpu.GetMemory().write(0xFFFF, 0x90);
+        };
+        RegisterWorkload({"op/BRK_RTI", code.GetCode(), setup, nullptr, 20000});
+    }
+    {
+        // Calls of an RTS at 0x9000.
+        Assembler code;
+        for (int i = 0; i < BLOCK_COPIES; i++) {
+            code.Op16(I::JSR, 0x9000);
+        }
+        code.Op16(I::JMP_ABS, 0x8000);
+        auto setup = [](CPU& cpu) { cpu.GetMemory().write(0x9000, I::RTS); };
+        RegisterWorkload({"op/JSR_RTS", code.GetCode(), setup, nullptr, 20000});
+    }
+
+    op("mode/IMM", I::LDA_IMM, 0x5A);
+    op("mode/ZP", I::LDA_ZP, 0x10);
+    op("mode/ZPX", I::LDA_ZPX, 0x10);
+    op("mode/ZPY", I::LDX_ZPY, 0x10);
+    op16("mode/ABS", I::LDA_ABS, 0x0300);
+    op16("mode/ABSX", I::LDA_ABSX, 0x0300);
+    op16("mode/ABSX_PAGE_CROSS", I::LDA_ABSX, 0x02FF);
+    op16("mode/ABSY", I::LDA_ABSY, 0x0300);
+    op("mode/INDX", I::LDA_INDX, 0x20);
+    op("mode/INDY", I::LDA_INDY, 0x25);
+    op("mode/ACC", I::ASL_ACC);
+    op("mode/IMPLIED", I::NOP);
+    repeat("mode/REL", [](Assembler& code) { code.Op(I::BCC, 0x00); });
+    {
+        // JMP ($0030) to itself.
+        Assembler code;
+        code.Op16(I::JMP_IND, 0x0030);
+        auto setup = [](CPU& cpu) {
+            cpu.GetMemory().write(0x30, 0x00);
+            cpu.GetMemory().write(0x31, 0x80);
+        };
+        RegisterWorkload({"mode/IND", code.GetCode(), setup, nullptr, 20000});
+    }
+}
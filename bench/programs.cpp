@@ -0,0 +1,230 @@
+#include "bench.h"
+#include <algorithm>
+
+using I = Instruction;
+
+// Whole programs run to their trapping op_code well within this.
+#define PROGRAM_BUDGET (uint64_t(1) << 32)
+
+static const uint8_t trap = 0x02;
+
+/**
+ * @brief Copy 16 pages from 0x1000 to 0x2000 through (zp),Y pointers.
+ * */
+static Workload memcpy_program() {
+    Assembler code;
+    code.Op(I::LDA_IMM, 0x00);
+    code.Op(I::STA_ZP, 0x00);
+    code.Op(I::STA_ZP, 0x02);
+    code.Op(I::LDA_IMM, 0x10);
+    code.Op(I::STA_ZP, 0x01);
+    code.Op(I::LDA_IMM, 0x20);
+    code.Op(I::STA_ZP, 0x03);
+    code.Op(I::LDX_IMM, 0x10);
+    code.Op(I::LDY_IMM, 0x00);
+    uint16_t loop = code.Here();
+    code.Op(I::LDA_INDY, 0x00);
+    code.Op(I::STA_INDY, 0x02);
+    code.Op(I::INY);
+    code.Branch(I::BNE, loop);
+    code.Op(I::INC_ZP, 0x01);
+    code.Op(I::INC_ZP, 0x03);
+    code.Op(I::DEX);
+    code.Branch(I::BNE, loop);
+    code.Op(Instruction(trap));
+
+    auto setup = [](CPU& cpu) {
+        for (uint16_t i = 0; i < 0x1000; i++) {
+            cpu.GetMemory().write(0x1000 + i, uint8_t(i * 7 + 3));
+        }
+    };
+    auto check = [](CPU& cpu) {
+        for (uint16_t i = 0; i < 0x1000; i++) {
+            if (cpu.Peek(0x2000 + i) != uint8_t(i * 7 + 3)) {
+                return false;
+            }
+        }
+        return true;
+    };
+    return {"program/memcpy", code.GetCode(), setup, check, PROGRAM_BUDGET};
+}
+
+/**
+ * @brief CRC-16/CCITT (polynomial 0x1021, initial 0xFFFF) of 16 pages at
+ * 0x1000, bit by bit, into 0x10 (low) and 0x11 (high).
+ * */
+static Workload crc_program() {
+    Assembler code;
+    code.Op(I::LDA_IMM, 0x00);
+    code.Op(I::STA_ZP, 0x00);
+    code.Op(I::LDA_IMM, 0x10);
+    code.Op(I::STA_ZP, 0x01);
+    code.Op(I::LDA_IMM, 0xFF);
+    code.Op(I::STA_ZP, 0x10);
+    code.Op(I::STA_ZP, 0x11);
+    code.Op(I::LDX_IMM, 0x10);
+    code.Op(I::LDY_IMM, 0x00);
+    uint16_t byte = code.Here();
+    code.Op(I::LDA_INDY, 0x00);
+    code.Op(I::EOR_ZP, 0x11);
+    code.Op(I::STA_ZP, 0x11);
+    code.Op(I::LDA_IMM, 0x08);
+    code.Op(I::STA_ZP, 0x12);
+    uint16_t bit = code.Here();
+    code.Op(I::ASL_ZP, 0x10);
+    code.Op(I::ROL_ZP, 0x11);
+    size_t no_carry = code.Forward(I::BCC);
+    code.Op(I::LDA_ZP, 0x11);
+    code.Op(I::EOR_IMM, 0x10);
+    code.Op(I::STA_ZP, 0x11);
+    code.Op(I::LDA_ZP, 0x10);
+    code.Op(I::EOR_IMM, 0x21);
+    code.Op(I::STA_ZP, 0x10);
+    code.Bind(no_carry);
+    code.Op(I::DEC_ZP, 0x12);
+    code.Branch(I::BNE, bit);
+    code.Op(I::INY);
+    code.Branch(I::BNE, byte);
+    code.Op(I::INC_ZP, 0x01);
+    code.Op(I::DEX);
+    code.Branch(I::BNE, byte);
+    code.Op(Instruction(trap));
+
+    auto setup = [](CPU& cpu) {
+        for (uint16_t i = 0; i < 0x1000; i++) {
+            cpu.GetMemory().write(0x1000 + i, uint8_t(i * 13 + i / 256));
+        }
+    };
+    auto check = [](CPU& cpu) {
+        uint16_t crc = 0xFFFF;
+        for (uint16_t i = 0; i < 0x1000; i++) {
+            crc ^= uint8_t(i * 13 + i / 256) << 8;
+            for (int n = 0; n < 8; n++) {
+                crc = crc & 0x8000 ? crc << 1 ^ 0x1021 : crc << 1;
+            }
+        }
+        return cpu.Peek(0x10) == (crc & 0xFF) && cpu.Peek(0x11) == crc >> 8;
+    };
+    return {"program/crc16", code.GetCode(), setup, check, PROGRAM_BUDGET};
+}
+
+#define SORT_LENGTH 128
+
+/**
+ * @brief Bubble sort of SORT_LENGTH bytes at 0x1000, with the swapped flag
+ * at 0x20.
+ * */
+static Workload sort_program() {
+    Assembler code;
+    uint16_t pass = code.Here();
+    code.Op(I::LDA_IMM, 0x00);
+    code.Op(I::STA_ZP, 0x20);
+    code.Op(I::LDX_IMM, 0x00);
+    uint16_t compare = code.Here();
+    code.Op16(I::LDA_ABSX, 0x1000);
+    code.Op16(I::CMP_ABSX, 0x1001);
+    size_t ordered = code.Forward(I::BCC);
+    size_t equal = code.Forward(I::BEQ);
+    code.Op16(I::LDA_ABSX, 0x1001);
+    code.Op(I::STA_ZP, 0x21);
+    code.Op16(I::LDA_ABSX, 0x1000);
+    code.Op16(I::STA_ABSX, 0x1001);
+    code.Op(I::LDA_ZP, 0x21);
+    code.Op16(I::STA_ABSX, 0x1000);
+    code.Op(I::INC_ZP, 0x20);
+    code.Bind(ordered);
+    code.Bind(equal);
+    code.Op(I::INX);
+    code.Op(I::CMX_IMM, SORT_LENGTH - 1);
+    code.Branch(I::BNE, compare);
+    code.Op(I::LDA_ZP, 0x20);
+    code.Branch(I::BNE, pass);
+    code.Op(Instruction(trap));
+
+    auto setup = [](CPU& cpu) {
+        for (int i = 0; i < SORT_LENGTH; i++) {
+            cpu.GetMemory().write(0x1000 + i, uint8_t(255 - i * 37 % 251));
+        }
+    };
+    auto check = [](CPU& cpu) {
+        std::vector<uint8_t> expected, actual;
+        for (int i = 0; i < SORT_LENGTH; i++) {
+            expected.push_back(uint8_t(255 - i * 37 % 251));
+            actual.push_back(cpu.Peek(0x1000 + i));
+        }
+        std::sort(expected.begin(), expected.end());
+        return actual == expected;
+    };
+    return {"program/sort", code.GetCode(), setup, check, PROGRAM_BUDGET};
+}
+
+/**
+ * @brief Sieve of Eratosthenes below 4096: the byte at 0x1000 + n becomes 1
+ * for every composite n. The pointer to the multiple lives at 0x04 and the
+ * prime at 0x06.
+ * */
+static Workload sieve_program() {
+    Assembler code;
+    code.Op(I::LDX_IMM, 0x02);
+    uint16_t candidate = code.Here();
+    code.Op16(I::LDA_ABSX, 0x1000);
+    size_t composite = code.Forward(I::BNE);
+    code.Op(I::STX_ZP, 0x06);
+    code.Op(I::TXA);
+    code.Op(I::STA_ZP, 0x04);
+    code.Op(I::LDA_IMM, 0x10);
+    code.Op(I::STA_ZP, 0x05);
+    uint16_t multiple = code.Here();
+    code.Op(I::CLC);
+    code.Op(I::LDA_ZP, 0x04);
+    code.Op(I::ADC_ZP, 0x06);
+    code.Op(I::STA_ZP, 0x04);
+    code.Op(I::LDA_ZP, 0x05);
+    code.Op(I::ADC_IMM, 0x00);
+    code.Op(I::STA_ZP, 0x05);
+    code.Op(I::CMP_IMM, 0x20);
+    size_t done = code.Forward(I::BCS);
+    code.Op(I::LDA_IMM, 0x01);
+    code.Op(I::LDY_IMM, 0x00);
+    code.Op(I::STA_INDY, 0x04);
+    code.Op16(I::JMP_ABS, multiple);
+    code.Bind(composite);
+    code.Bind(done);
+    code.Op(I::INX);
+    code.Op(I::CMX_IMM, 64);
+    code.Branch(I::BNE, candidate);
+    code.Op(Instruction(trap));
+
+    auto check = [](CPU& cpu) {
+        for (int n = 2; n < 4096; n++) {
+            bool prime = true;
+            for (int d = 2; d * d <= n; d++) {
+                prime = prime && n % d != 0;
+            }
+            if (cpu.Peek(0x1000 + n) != !prime) {
+                return false;
+            }
+        }
+        return true;
+    };
+    return {"program/sieve", code.GetCode(), nullptr, check, PROGRAM_BUDGET};
+}
+
+void RegisterProgramBenchmarks() {
+    RegisterWorkload(memcpy_program());
+    RegisterWorkload(crc_program());
+    RegisterWorkload(sort_program());
+    RegisterWorkload(sieve_program());
+
+    // Next to program/sieve, the cost of watches that never hit: breakpoints
+    // and watchpoints on pages the sieve doesn't run or touch.
+    Workload watched = sieve_program();
+    watched.name = "program/sieve_watched";
+    watched.setup = [](CPU& cpu) {
+        cpu.SetBreakpoint(0x9000);
+        cpu.SetBreakpoint(0x9123);
+        cpu.SetWatchpoint(0x0300, WATCH_WRITE);
+        cpu.SetWatchpoint(0x2000, WATCH_READ | WATCH_WRITE);
+    };
+    RegisterWorkload(watched);
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <CPU.h>
+#include <atomic>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief One run of a batch: boot rom (mapped at 0x8000 like CPU(RomImage)),
+ * optionally load a checkpoint chain as the initial state, then run for
+ * cycle_budget cycles or until the CPU traps.
+ * */
+struct BatchJob {
+    std::string rom;
+    std::vector<std::string> checkpoints; // for LoadCheckpoint, may be empty
+    uint64_t cycle_budget;
+};
+
+enum class BatchStatus : uint8_t {
+    Finished, // the budget was spent
+    Trapped,  // stopped on an unknown op_code before the budget was spent
+    Failed,   // the ROM or a checkpoint couldn't be loaded, see error
+};
+
+/**
+ * @brief The CPU at the end of a job, and where and how long it ran.
+ * */
+struct BatchResult {
+    BatchStatus status;
+    std::string error;
+    uint64_t cycles; // run by the job, from the initial state
+    uint16_t PC;
+    uint8_t AC, X, Y, SP, SR;
+    uint8_t trap_op_code;
+    uint32_t worker;
+    uint64_t nanoseconds;
+};
+
+/**
+ * @brief Parse a manifest, one job per line:
+ *
+ *     <rom> <cycle budget> [<checkpoint> ...]
+ *
+ * Empty lines are skipped and # starts a comment. Relative paths are
+ * relative to directory. Returns false with a message naming the line on
+ * malformed input.
+ * */
+bool ParseManifest(std::istream& input, const std::string& directory,
+                   std::vector<BatchJob>& jobs, std::string& error);
+
+/**
+ * @brief Write results as JSON lines, one object per job in job order.
+ * */
+void WriteResults(std::ostream& output, const std::vector<BatchJob>& jobs,
+                  const std::vector<BatchResult>& results);
+
+/**
+ * @brief Runs batches of jobs on a fixed set of worker threads.
+ *
+ * Each worker starts with a contiguous slice of the jobs, so jobs of the
+ * same ROM and initial state listed together tend to run on the same
+ * worker, and takes them from the front. A worker that runs dry steals the
+ * back half of another worker's remaining slice. Slices are single atomic
+ * words, so taking or stealing jobs never locks.
+ *
+ * Workers keep one CPU per ROM across jobs and batches, and return it to
+ * its initial state with CPU::Restore, which only touches the pages the
+ * previous job dirtied when the initial state is the same. ROMs are mapped
+ * once per batch and shared read-only by all workers. On Linux each worker
+ * can be pinned to its own core of the process's affinity mask.
+ * */
+class BatchRunner {
+  public:
+    /**
+     * @brief workers 0 uses one per hardware thread.
+     * */
+    explicit BatchRunner(size_t workers = 0, bool pin = true,
+                         Engine engine = CPU::GetDefaultEngine());
+
+    ~BatchRunner();
+
+    BatchRunner(const BatchRunner&) = delete;
+    BatchRunner& operator=(const BatchRunner&) = delete;
+
+    size_t GetWorkerCount() { return m_workers.size(); }
+
+    /**
+     * @brief Run every job, returning their results in job order.
+     * */
+    std::vector<BatchResult> Run(const std::vector<BatchJob>& jobs);
+
+    /**
+     * @brief Jobs taken from other workers since the runner was created.
+     * */
+    uint64_t CountSteals() { return m_steals; }
+
+  private:
+    struct Worker;
+
+    void work(size_t index, const std::vector<BatchJob>& jobs,
+              std::vector<BatchResult>& results);
+    bool take(size_t index, uint32_t& job);
+    bool steal(size_t index);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::map<std::string, std::shared_ptr<RomImage>> m_roms; // of the batch
+    bool m_pin;
+    Engine m_engine;
+    std::atomic<uint64_t> m_steals;
+};
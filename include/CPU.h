@@ -1,17 +1,117 @@
 #pragma once
 
 #include <Memory.h>
+#include <Scheduler.h>
+#include <algorithm>
+#include <array>
 #include <cstring>
+#include <functional>
+#include <memory>
 #include <stdint.h>
 #include <string>
-#include <unordered_map>
 #include <utils.h>
 
-#define ADD_CYCLE(cpu) cpu.read(0)
+#define ADD_CYCLE(cpu) cpu.Tick()
+
+// Unoptimized builds don't have the registers left for CALL_TRAMPOLINE.
+#if MEMORY_TRAMPOLINES && defined(__OPTIMIZE__)
+#define CPU_TRAMPOLINES 1
+#else
+#define CPU_TRAMPOLINES 0
+#endif
+
+#if CPU_TRAMPOLINES
+#if defined(__AVX512F__)
+#define TRAMPOLINE_VECTOR_CLOBBERS                                             \
+    "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7", "xmm8",    \
+        "xmm9", "xmm10", "xmm11", "xmm12", "xmm13", "xmm14", "xmm15", "xmm16", \
+        "xmm17", "xmm18", "xmm19", "xmm20", "xmm21", "xmm22", "xmm23",         \
+        "xmm24", "xmm25", "xmm26", "xmm27", "xmm28", "xmm29", "xmm30",         \
+        "xmm31", "k1", "k2", "k3", "k4", "k5", "k6", "k7"
+#else
+#define TRAMPOLINE_VECTOR_CLOBBERS                                             \
+    "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5", "xmm6", "xmm7", "xmm8",    \
+        "xmm9", "xmm10", "xmm11", "xmm12", "xmm13", "xmm14", "xmm15"
+#endif
+
+/**
+ * Run the slow path of a bus access through a Memory trampoline. Unlike a
+ * call, which may change anything, the asm only tells the compiler that it
+ * reads the Memory, so the engines keep PC, the registers and the cycle count
+ * in host registers across it. Declaring any write to memory, even to a
+ * single field, brings back the stores and reloads around every access that a
+ * call on the slow path causes on the fast path too. What the slow path may
+ * change, the page tables and code versions of the Memory and m_next_stop and
+ * the watch state of the CPU, is read with load_fresh instead; the rest of
+ * what a device changes during an access is only read by Service, a call,
+ * after the lowered m_next_stop.
+ * */
+#define CALL_TRAMPOLINE(trampoline, result, address, data)                     \
+    asm volatile("lea -128(%%rsp), %%rsp\n\t"                                 \
+                 "call " trampoline "\n\t"                                     \
+                 "lea 128(%%rsp), %%rsp"                                       \
+                 : "=a"(result)                                                \
+                 : "D"(m_memory.get()), "S"(uint32_t(address)),                \
+                   "d"(uint32_t(data)), "m"(*m_memory)                         \
+                 : "cc", TRAMPOLINE_VECTOR_CLOBBERS)
+#endif
 
 class CPU;
+class DecodeCache;
+class JitCache;
+class Mapper;
+class Profiler;
+class RomImage;
+class TraceSink;
 
 using inst_func_t = void (*)(CPU&, uint8_t);
+using dispatch_table_t = std::array<inst_func_t, 256>;
+
+/**
+ * @brief Interpreter core that runs the program in CPU::Execute.
+ * */
+enum class Engine : uint8_t {
+    Table,    // portable loop calling through isa_table
+    Threaded, // direct-threaded code using computed goto (GCC/Clang only)
+    Predecoded, // threaded over instructions decoded once per PC (DecodeCache)
+    Jit,        // hot blocks compiled to x86-64 (JitCache), else Table
+};
+
+/**
+ * @brief Called by CPU::Run every callback_interval cycles; returning false
+ * halts the run at the instruction boundary it was called at.
+ * */
+using halt_func_t = std::function<bool(CPU&)>;
+
+/**
+ * @brief When CPU::Run stops, besides traps, breakpoints and watchpoints.
+ * Every condition is optional and they combine: the run halts on the first
+ * one met. All of them are turned into the cycle compare the engines make
+ * before every instruction, so a condition costs nothing until it is close
+ * to being met, with one exception: counting instructions needs the
+ * instrumented engines, as a sink or profiler does.
+ * */
+struct HaltConditions {
+    uint64_t cycles = UINT64_MAX;       // budget, see CPU::Run
+    uint64_t instructions = UINT64_MAX; // number of instructions to run
+    int32_t pc = -1;  // sentinel, halted in front of like a breakpoint
+    bool brk = false; // halt in front of BRK, which then traps
+    uint64_t callback_interval = 0;
+    halt_func_t callback;
+};
+
+/**
+ * @brief Why the last CPU::Run or Execute returned.
+ * */
+enum class HaltReason : uint8_t {
+    None,         // nothing ran since the CPU was created or restored
+    Cycles,       // the budget was spent
+    Instructions, // the instruction count was reached
+    PC,           // PC reached the sentinel
+    Trap,         // an unknown op_code, or BRK when halting on it
+    Callback,     // the callback returned false
+    Watch,        // a breakpoint or watchpoint, see CPU::IsWatchHit
+};
 
 class CPU {
   public:
@@ -21,74 +121,514 @@ class CPU {
     uint8_t X;   // X register	(8 bit)
     uint8_t Y;   // Y register	(8 bit)
 
-    struct {
-        uint8_t N : 1;        // Negative
-        uint8_t V : 1;        // Overflow
-        uint8_t _ignore_ : 1; // ignored
-        uint8_t B : 1;        // Break
-        uint8_t D : 1;        // Decimal(use BCD for arithmetics)
-        uint8_t I : 1;        // Interrupt(IRQ disable)
-        uint8_t Z : 1;        // Zero
-        uint8_t C : 1;        // Carry
+    /**
+     * @brief The status register[NV - BDIZC] kept as a packed byte for V, B,
+     * D, I and C, while N and Z are evaluated lazily from the last result
+     * stored by SetNZ. Each flag reads and assigns like a bit field, so only
+     * Value, branches and the few instructions that observe N or Z pay for
+     * decoding them.
+     * */
+    struct StatusRegister {
+        // Flags of nz, the last result in the low byte and bit 8 forcing N.
+        static constexpr std::array<uint8_t, 512> s_nz_flags = [] {
+            std::array<uint8_t, 512> flags = {};
+            for (int nz = 0; nz < 512; nz++) {
+                flags[nz] = ((nz & 0x180) != 0) << 7 | ((nz & 0xFF) == 0) << 1;
+            }
+            return flags;
+        }();
+
+        struct Storage {
+            uint8_t bits; // NV1BDIZC with N, 1 and Z clear
+            uint16_t nz;
+        };
+
+        // All flags share Storage as their common initial sequence.
+        template <uint8_t MASK> struct PackedFlag : Storage {
+            operator uint8_t() const { return (bits & MASK) != 0; }
+            PackedFlag& operator=(const PackedFlag&) = delete;
+            PackedFlag& operator=(uint8_t value) {
+                bits = value ? bits | MASK : bits & ~MASK;
+                return *this;
+            }
+        };
+
+        struct NegativeFlag : Storage {
+            operator uint8_t() const { return (nz & 0x180) != 0; }
+            NegativeFlag& operator=(const NegativeFlag&) = delete;
+            NegativeFlag& operator=(uint8_t value) {
+                nz = (value != 0) << 8 | ((nz & 0xFF) != 0);
+                return *this;
+            }
+        };
+
+        struct ZeroFlag : Storage {
+            operator uint8_t() const { return (nz & 0xFF) == 0; }
+            ZeroFlag& operator=(const ZeroFlag&) = delete;
+            ZeroFlag& operator=(uint8_t value) {
+                nz = ((nz & 0x180) != 0) << 8 | (value == 0);
+                return *this;
+            }
+        };
+
+        union {
+            Storage raw;
+            NegativeFlag N;       // Negative
+            PackedFlag<0x40> V;   // Overflow
+            PackedFlag<0x10> B;   // Break
+            PackedFlag<0x08> D;   // Decimal(use BCD for arithmetics)
+            PackedFlag<0x04> I;   // Interrupt(IRQ disable)
+            ZeroFlag Z;           // Zero
+            PackedFlag<0x01> C;   // Carry
+        };
+
+        StatusRegister() { Set(0); }
+        StatusRegister(const StatusRegister& other) : raw(other.raw) {}
+
+        StatusRegister& operator=(const StatusRegister& other) {
+            raw = other.raw;
+            return *this;
+        }
+
+        /**
+         * @brief N and Z from result, with a single store.
+         * */
+        ALWAYS_INLINE void SetNZ(uint8_t result) { raw.nz = result; }
+
+        /**
+         * @brief N from bit 7 of negative and Z from zero, as BIT does.
+         * */
+        ALWAYS_INLINE void SetNZ(uint8_t negative, uint8_t zero) {
+            raw.nz = (negative & 0x80) << 1 | (zero != 0);
+        }
+
+        /**
+         * @brief V and C at once from a byte in the NV1BDIZC layout.
+         * */
+        ALWAYS_INLINE void SetVC(uint8_t flags) {
+            raw.bits = (raw.bits & ~0x41) | (flags & 0x41);
+        }
 
-        uint8_t Value() { return N << V << 1 << B << D << I << Z << C; }
+        uint8_t Value() const { return raw.bits | 0x20 | s_nz_flags[raw.nz]; }
 
         void Set(uint8_t val) {
-            N = GET_BIT(val, 7);
-            V = GET_BIT(val, 6);
-            B = GET_BIT(val, 4);
-            D = GET_BIT(val, 3);
-            I = GET_BIT(val, 2);
-            Z = GET_BIT(val, 1);
-            C = GET_BIT(val, 0);
+            raw.bits = val & 0x5D;
+            SetNZ(val, ~val & 0x02);
         }
-    } SR; // status register[NV - BDIZC](8 bit)
+    } SR;
+
+    static_assert(sizeof(StatusRegister) == sizeof(StatusRegister::Storage),
+                  "Flags must alias the packed storage");
 
     uint8_t SP; // stack pointer (8 bit)
 
+    /**
+     * @brief Everything Execute depends on besides the configuration.
+     * memory is a copy-on-write clone, so taking a State costs a page table.
+     * */
+    struct State {
+        uint16_t PC;
+        uint8_t AC, X, Y;
+        StatusRegister SR;
+        uint8_t SP;
+        uint64_t cycles;
+        bool trapped;
+        uint8_t trap_op_code;
+        std::shared_ptr<const Memory> memory;
+    };
+
   public:
-    CPU(uint8_t* program, uint16_t size);
+    CPU(uint8_t* program, uint16_t size, Engine engine = GetDefaultEngine());
+
+    /**
+     * @brief Like the program constructor, but the image is mapped as ROM at
+     * 0x8000 instead of being copied.
+     * */
+    CPU(RomImage& rom, Engine engine = GetDefaultEngine());
+
+    /**
+     * @brief Run on an existing address space, possibly shared with other
+     * CPUs or cloned with Memory::Clone, starting at the reset vector
+     * (0xFFFC).
+     * */
+    CPU(std::shared_ptr<Memory> memory, Engine engine = GetDefaultEngine());
+
+    /**
+     * @brief Boot from a bank switched cartridge: attach the mapper and start
+     * at the reset vector (0xFFFC).
+     * */
+    CPU(Mapper& cartridge, Engine engine = GetDefaultEngine());
+
+    ~CPU();
+
+    /**
+     * @brief Engine used by CPUs constructed without an explicit one.
+     * */
+    static Engine GetDefaultEngine() { return s_default_engine; }
+
+    static void SetDefaultEngine(Engine engine) { s_default_engine = engine; }
 
     /**
      * @brief CPU gives a signal to read from the bus
      * */
-    uint8_t read(uint16_t address) {
+    ALWAYS_INLINE uint8_t read(uint16_t address) {
         m_cycles++;
-        return m_memory.read(address);
+#if CPU_TRAMPOLINES
+        const uint8_t* page =
+            load_fresh(m_memory->GetReadPointers()[PAGE_OF(address)]);
+        if (LIKELY(page != nullptr)) {
+            return page[PAGE_OFFSET(address)];
+        }
+        uint32_t data;
+        CALL_TRAMPOLINE("memory_read_trampoline", data, address, 0);
+        return data;
+#else
+        return m_memory->read(address);
+#endif
     }
 
     /**
      * @brief CPU gives a signal to write to the bus
      * */
-    void write(uint16_t address, uint8_t data) {
+    ALWAYS_INLINE void write(uint16_t address, uint8_t data) {
         m_cycles++;
-        return m_memory.write(address, data);
+#if CPU_TRAMPOLINES
+        uint8_t* page =
+            load_fresh(m_memory->GetWritePointers()[PAGE_OF(address)]);
+        if (LIKELY(page != nullptr)) {
+            page[PAGE_OFFSET(address)] = data;
+            return;
+        }
+        uint32_t unused;
+        CALL_TRAMPOLINE("memory_write_trampoline", unused, address, data);
+#else
+        m_memory->write(address, data);
+#endif
     }
 
+    /**
+     * @brief An internal cycle that does not access the bus.
+     * */
+    ALWAYS_INLINE void Tick() { m_cycles++; }
+
+    /**
+     * @brief Read memory without driving the bus, so no cycle is consumed
+     * and no device sees the access.
+     * */
+    uint8_t Peek(uint16_t address) { return m_memory->peek(address); }
+
+    Memory& GetMemory() { return *m_memory; }
+
+    std::shared_ptr<Memory> ShareMemory() { return m_memory; }
+
   public:
-    uint16_t GetCycles() { return m_cycles; }
+    uint64_t GetCycles() { return m_cycles; }
 
     /**
      * @brief Pushing bytes to the stack causes the stack pointer to be
      * decremented.
      * */
-    void PUSH(uint8_t val) { write(0x100 + (SP--), val); }
+    ALWAYS_INLINE void PUSH(uint8_t val) { write(0x100 + (SP--), val); }
 
     /**
      * @brief Pulling bytes from stack causes it to be incremented.
      * */
-    uint8_t POP() { return read(0x100 + (++SP)); }
+    ALWAYS_INLINE uint8_t POP() { return read(0x100 + (++SP)); }
 
     /**
      * @brief Fetch the next byte.
      * */
-    uint8_t Fetch() { return read(PC++); }
+    ALWAYS_INLINE uint8_t Fetch() { return read(PC++); }
+
+    /**
+     * @brief Fetch the op_code of the next instruction, where breakpoints
+     * are checked.
+     * */
+    ALWAYS_INLINE uint8_t FetchOpCode() {
+        m_cycles++;
+#if CPU_TRAMPOLINES
+        uint16_t address = PC++;
+        const uint8_t* page =
+            load_fresh(m_memory->GetFetchPointers()[PAGE_OF(address)]);
+        if (LIKELY(page != nullptr)) {
+            return page[PAGE_OFFSET(address)];
+        }
+        uint32_t op_code;
+        CALL_TRAMPOLINE("memory_fetch_trampoline", op_code, address, 0);
+        return op_code;
+#else
+        return m_memory->fetch(PC++);
+#endif
+    }
+
+    /**
+     * @brief Operand bytes of the instruction being run by the predecoded
+     * engine, see the DECODED addressing modes.
+     * */
+    ALWAYS_INLINE uint16_t GetOperand() { return m_operand; }
+
+    /**
+     * @brief Stop execution on an op_code that is not part of the instruction
+     * set, leaving PC on the offending op_code. BRK only traps when halting
+     * on it, in front of it like a breakpoint.
+     * */
+    void Trap(uint8_t op_code) {
+        PC--;
+        // Set by the fetch, see CALL_TRAMPOLINE.
+        if (load_fresh(m_watch_hit) &&
+            load_fresh(m_watch_kind) == WATCH_EXECUTE &&
+            load_fresh(m_watch_address) == PC) {
+            // A breakpoint: undo the op_code fetch and stop in front of it.
+            m_cycles--;
+            return;
+        }
+        if (op_code == 0x00) { // BRK
+            m_cycles--;
+        }
+        m_trapped = true;
+        m_trap_op_code = op_code;
+        m_next_stop = 0;
+    }
+
+    bool IsTrapped() { return m_trapped; }
+
+    uint8_t GetTrapOpCode() { return m_trap_op_code; }
+
+    /**
+     * @brief Whether BRK traps instead of interrupting, see HaltConditions.
+     * */
+    bool HaltsOnBRK() { return m_halt_on_brk; }
+
+    Engine GetEngine() { return m_engine; }
+
+    /**
+     * @brief Push PC and the status register and jump through vector, as
+     * BRK, IRQ and NMI do. brk sets the B bit of the pushed status.
+     * */
+    void Interrupt(uint16_t vector, bool brk);
+
+    /**
+     * @brief Drive the level triggered IRQ line. Each device uses its own
+     * source bit and the line stays asserted while any bit is set. The CPU
+     * takes the interrupt at an instruction boundary once SR.I is clear.
+     * */
+    void AssertIRQ(uint32_t source = 1) {
+        m_irq_lines |= source;
+        m_next_stop = 0;
+    }
+
+    void ReleaseIRQ(uint32_t source = 1) { m_irq_lines &= ~source; }
+
+    bool IsIRQAsserted() { return m_irq_lines != 0; }
+
+    /**
+     * @brief An edge on the NMI line, taken at the next instruction boundary
+     * regardless of SR.I.
+     * */
+    void TriggerNMI() {
+        m_nmi_pending = true;
+        m_next_stop = 0;
+    }
+
+    /**
+     * @brief The RESET sequence: 7 cycles, SP lowered by 3 without writing,
+     * interrupts disabled and PC loaded from 0xFFFC. Clears a trap.
+     * */
+    void Reset();
+
+    /**
+     * @brief Call event at the first instruction boundary at or after cycle,
+     * e.g. to assert an IRQ from a timer. Returns an id for CancelEvent.
+     * */
+    uint64_t ScheduleEvent(uint64_t cycle, event_func_t event) {
+        m_next_stop = std::min(m_next_stop, cycle);
+        return m_scheduler.Schedule(cycle, std::move(event));
+    }
+
+    bool CancelEvent(uint64_t id) { return m_scheduler.Cancel(id); }
+
+    State Snapshot();
+
+    /**
+     * @brief Go back to state. When state is the last Snapshot of this CPU's
+     * memory (or was restored last) only the pages written since are
+     * touched. CPUs sharing the memory see it restored too. Scheduled events
+     * and interrupt lines belong to the devices and are left alone.
+     * */
+    void Restore(const State& state);
+
+    /**
+     * @brief Stop in front of the instruction at address, before its op_code
+     * is fetched. Execute and Run return with PC on it, and continuing
+     * from there runs it.
+     * */
+    void SetBreakpoint(uint16_t address) { watch(address, WATCH_EXECUTE); }
 
+    void ClearBreakpoint(uint16_t address) {
+        m_memory->ClearWatch(address, WATCH_EXECUTE);
+    }
+
+    /**
+     * @brief Stop after the instruction that reads or writes address, as
+     * chosen by kinds (WATCH_READ, WATCH_WRITE). Operand bytes count as
+     * read. Watchpoints are kept by the memory, so a CPU sharing it reports
+     * them as long as it was the last to set one.
+     * */
+    void SetWatchpoint(uint16_t address, uint8_t kinds) {
+        watch(address, kinds & (WATCH_READ | WATCH_WRITE));
+    }
+
+    void ClearWatchpoint(uint16_t address, uint8_t kinds) {
+        m_memory->ClearWatch(address, kinds & (WATCH_READ | WATCH_WRITE));
+    }
+
+    /**
+     * @brief Whether the last Execute or Run stopped at a breakpoint or
+     * watchpoint. The next one clears it and carries on.
+     * */
+    bool IsWatchHit() { return m_watch_hit; }
+
+    uint16_t GetWatchAddress() { return m_watch_address; }
+
+    Watch GetWatchKind() { return m_watch_kind; }
+
+    /**
+     * @brief Attach a sink that sees the CPU before every instruction, or
+     * detach it with nullptr. Without a sink Execute runs an instantiation of
+     * the engine that contains no tracing code at all.
+     * */
+    void SetTraceSink(TraceSink* sink) { m_trace_sink = sink; }
+
+    /**
+     * @brief Attach a profiler that counts the cycles of every instruction,
+     * or detach it with nullptr. Like a sink, it runs the instrumented
+     * instantiation of the engine, which the JIT leaves to the predecoded
+     * engine.
+     * */
+    void SetProfiler(Profiler* profiler) { m_profiler = profiler; }
+
+    /**
+     * @brief Run the program until it traps or runs into a BRK, such as the
+     * zeroed memory after it. It may call and jump anywhere on the way.
+     * */
     void Execute();
 
+    /**
+     * @brief Run for cycle_budget cycles regardless of PC. The last
+     * instruction may finish past the budget; the extra cycles are returned
+     * so the caller can shorten the next time slice. Returns 0 when the CPU
+     * traps before the budget is spent.
+     * */
+    uint64_t Run(uint64_t cycle_budget);
+
+    /**
+     * @brief Run until one of conditions is met, or the CPU traps or hits a
+     * breakpoint or watchpoint. The sentinel PC is an execute watch of the
+     * memory, kept until a run with another one, so like a breakpoint it
+     * keeps the JIT off its instruction. Continuing from the sentinel runs
+     * the instruction there.
+     * */
+    HaltReason Run(const HaltConditions& conditions);
+
+    HaltReason GetHaltReason() { return m_halt_reason; }
+
   private:
-    Memory m_memory;
-    std::unordered_map<uint8_t, inst_func_t> isa_map;
-    uint16_t m_program_size, m_cycles;
-    void dump();
+    // Keeps the registers and cycles of its lanes in its own arrays.
+    friend class Lockstep;
+
+    static Engine s_default_engine;
+
+    std::shared_ptr<Memory> m_memory;
+    uint64_t m_cycles, m_cycle_limit;
+    // Earliest cycle at which the engines must call Service: the cycle limit,
+    // the next event, or 0 when a trap, interrupt or halt needs attention.
+    uint64_t m_next_stop;
+    bool m_trapped;
+    uint8_t m_trap_op_code;
+    bool m_watch_hit;
+    bool m_watching; // installed the watch handler of m_memory
+    uint16_t m_watch_address;
+    Watch m_watch_kind;
+    uint64_t m_resume_cycle; // when the breakpoint continued from is passed
+    // Counted by the instrumented engines, UINT64_MAX when there is no limit.
+    uint64_t m_instructions_left;
+    int32_t m_halt_pc;
+    bool m_halt_pc_owned; // m_halt_pc isn't also a breakpoint
+    bool m_halt_on_brk;
+    bool m_halt_requested; // by m_halt_callback
+    halt_func_t m_halt_callback;
+    uint64_t m_halt_event;
+    HaltReason m_halt_reason;
+    bool m_nmi_pending;
+    uint32_t m_irq_lines;
+    Scheduler m_scheduler;
+    Engine m_engine;
+    TraceSink* m_trace_sink;
+    Profiler* m_profiler;
+    uint16_t m_operand;
+    // Allocated by the first predecoded run.
+    std::unique_ptr<DecodeCache> m_decode_cache;
+    // Allocated by the first JIT run.
+    std::unique_ptr<JitCache> m_jit_cache;
+
+    /**
+     * @brief Loop condition of the engines. Limits, events, interrupts,
+     * traps and every halt condition share the single m_next_stop compare.
+     * */
+    ALWAYS_INLINE bool Running() {
+        return LIKELY(m_cycles < load_fresh(m_next_stop)) || Service();
+    }
+
+    /**
+     * @brief Whether Service has to stop the engine whatever the cycle.
+     * */
+    bool halting() {
+        return m_trapped || m_watch_hit || m_halt_requested ||
+               m_instructions_left == 0;
+    }
+
+    /**
+     * @brief Run due events and take pending interrupts, then compute the
+     * next stop. Returns false when the engine has to return.
+     * */
+    bool Service();
+
+    void watch(uint16_t address, uint8_t kinds);
+
+    /**
+     * @brief Handler of m_memory's watches: note the first hit of an
+     * instruction and stop at the next boundary.
+     * */
+    bool on_watch(uint16_t address, Watch kind);
+
+    /**
+     * @brief Prepare a new Execute or Run.
+     * */
+    void start(const HaltConditions& conditions);
+
+    void schedule_halt_callback(uint64_t cycle, uint64_t interval);
+
+    /**
+     * @brief End a run: drop the callback and find the halt reason.
+     * */
+    HaltReason finish();
+
+    /**
+     * @brief Run before every instruction by the traced instantiations of
+     * the engines, which also count instructions. Instructions the run
+     * stops in front of are skipped. Defined in trace.h.
+     * */
+    ALWAYS_INLINE void trace_instruction();
+
+    /**
+     * @brief Whether the run stops in front of the instruction at PC, at a
+     * breakpoint or a BRK it halts on, without running it.
+     * */
+    ALWAYS_INLINE bool stops_in_front();
+
+    void Dispatch();
+    template <bool TRACE> void ExecuteTable();
+    template <bool TRACE> void ExecuteThreaded();
+    template <bool TRACE> void ExecutePredecoded();
+    template <bool TRACE> void ExecuteJit();
 };
\ No newline at end of file
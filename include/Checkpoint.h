@@ -0,0 +1,83 @@
+#pragma once
+
+#include <CPU.h>
+#include <Memory.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A checkpoint file is this header, zero padded to
+ * CHECKPOINT_DATA_OFFSET, followed by page_count pages of MEM_PAGE_SIZE
+ * bytes, all in host byte order. The page section is aligned for mmap, so a
+ * loaded checkpoint maps its pages in place.
+ *
+ * A full checkpoint (sequence 0) stores every page that was written, a
+ * missing RAM or ROM page reads as zero. An incremental checkpoint stores the
+ * pages changed since the previous checkpoint of its chain, a missing page
+ * is unchanged. Device pages and pages mapped with MapBank are not saved.
+ * */
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t data_offset;
+    uint64_t chain;    // shared by a full checkpoint and its increments
+    uint32_t sequence; // position in the chain, 0 for a full checkpoint
+    uint32_t page_count;
+    uint64_t cycles;
+    uint16_t pc;
+    uint8_t ac;
+    uint8_t x;
+    uint8_t y;
+    uint8_t sp;
+    uint8_t sr; // NV1BDIZC
+    uint8_t trapped;
+    uint8_t trap_op_code;
+    uint8_t kinds[MEM_PAGE_COUNT];  // PageKind or CHECKPOINT_KIND_SKIPPED
+    uint16_t slots[MEM_PAGE_COUNT]; // index in the page section
+};
+
+#define CHECKPOINT_FILE_MAGIC "6502CKP"
+#define CHECKPOINT_FILE_VERSION 1
+#define CHECKPOINT_DATA_OFFSET 4096
+#define CHECKPOINT_KIND_SKIPPED 0xFF
+#define CHECKPOINT_NO_SLOT 0xFFFF
+
+static_assert(sizeof(CheckpointHeader) <= CHECKPOINT_DATA_OFFSET,
+              "The page section must stay aligned");
+
+/**
+ * @brief Writes the checkpoints of one chain: the first is full, the
+ * following ones are incremental against the previous checkpoint, which the
+ * writer keeps as a copy-on-write snapshot.
+ * */
+class CheckpointWriter {
+  public:
+    CheckpointWriter();
+
+    /**
+     * @brief Write cpu's state to path, through a temporary file so a crash
+     * never leaves a partial checkpoint. Returns false on I/O errors.
+     * */
+    bool Write(CPU& cpu, const std::string& path);
+
+    /**
+     * @brief Make the next checkpoint a full one that starts a new chain.
+     * */
+    void Reset();
+
+    uint32_t GetSequence() { return m_sequence; }
+
+  private:
+    uint64_t m_chain;
+    uint32_t m_sequence;
+    CPU::State m_previous;
+};
+
+/**
+ * @brief Load a full checkpoint followed by its increments, in order. The
+ * pages are mapped copy-on-write from the files, so loading costs an mmap
+ * per file and a register copy. Device pages and banks of cpu's memory are
+ * left as they are. cpu is untouched when false is returned.
+ * */
+bool LoadCheckpoint(CPU& cpu, const std::vector<std::string>& chain);
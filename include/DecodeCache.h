@@ -0,0 +1,58 @@
+#pragma once
+
+#include <Memory.h>
+#include <memory>
+#include <stdint.h>
+#include <utils.h>
+
+// Labels of the predecoded engine past the 256 op_codes: instructions that
+// are fetched and dispatched like the table engine does, then the pairs of
+// FUSION_PROFILE in order.
+#define DECODE_LABEL_FETCH 256
+#define DECODE_LABEL_FUSED 257
+
+/**
+ * @brief An instruction as the predecoded engine runs it. The handler,
+ * length and fetch cycles are constants of the label (see
+ * make_decode_table), so only the operand bytes are stored. The label is
+ * the op_code, DECODE_LABEL_FETCH, or a fused pair whose second instruction
+ * is the decoded entry behind this one.
+ * */
+struct DecodedInstruction {
+    uint32_t version; // Memory code version of the page it was decoded from
+    uint16_t operand;
+    uint16_t label;
+};
+
+/**
+ * @brief Decoded instructions keyed by PC, allocated a page at a time when
+ * code first runs there. An entry is valid while its page's code version
+ * is unchanged, so a write to a code page drops all entries of that page at
+ * once without touching them.
+ *
+ * Instructions on device pages and instructions whose operand crosses into
+ * the next page are never decoded; they are fetched through the bus as
+ * usual. An instruction followed on the same page by the second op_code of
+ * a FUSION_PROFILE pair starting with it is decoded as that pair. Storage
+ * changed behind Memory's back, such as a bank buffer the host writes
+ * directly, isn't seen.
+ * */
+class DecodeCache {
+  public:
+    ALWAYS_INLINE const DecodedInstruction& Lookup(Memory& memory,
+                                                   uint16_t pc) {
+        DecodedInstruction* page = m_pages[PAGE_OF(pc)].get();
+        if (LIKELY(page != nullptr)) {
+            DecodedInstruction& entry = page[PAGE_OFFSET(pc)];
+            if (LIKELY(entry.version == memory.GetCodeVersion(PAGE_OF(pc)))) {
+                return entry;
+            }
+        }
+        return decode(memory, pc);
+    }
+
+  private:
+    const DecodedInstruction& decode(Memory& memory, uint16_t pc);
+
+    std::unique_ptr<DecodedInstruction[]> m_pages[MEM_PAGE_COUNT];
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <Memory.h>
+#include <memory>
+#include <stdint.h>
+#include <utils.h>
+
+#if defined(__x86_64__) && defined(__linux__)
+#define JIT_AVAILABLE 1
+#else
+#define JIT_AVAILABLE 0
+#endif
+
+// Interpreted runs of a PC before its block is compiled.
+#define JIT_HOT_THRESHOLD 16
+// Instructions per compiled block.
+#define JIT_MAX_BLOCK 32
+// Size of the executable arena, flushed as a whole when it is full.
+#define JIT_CODE_SIZE (1024 * 1024)
+
+/**
+ * @brief Guest state handed to a compiled block, which keeps it in host
+ * registers while it runs. pc and cycles are exact when the block returns.
+ * */
+struct JitContext {
+    const uint8_t* const* read; // Memory::GetReadPointers
+    uint8_t* const* write;      // Memory::GetWritePointers
+    uint64_t cycles;
+    uint64_t limit; // a block looping on itself stops before this cycle
+    uint16_t pc;
+    uint16_t nz; // StatusRegister::Storage
+    uint8_t ac, x, y;
+    uint8_t bits; // StatusRegister::Storage
+};
+
+using jit_code_t = void (*)(JitContext*);
+
+/**
+ * @brief A basic block starting at some PC. Until code is set it only counts
+ * the times the PC was interpreted.
+ * */
+struct JitBlock {
+    jit_code_t code;
+    uint32_t version; // Memory code version of the block's page
+    uint16_t hits;
+    uint16_t max_cycles; // with every page crossing and branch taken
+    uint8_t last;        // offset of the last instruction from PC
+};
+
+/**
+ * @brief Compiles the basic blocks where the CPU spends its time to x86-64
+ * code. A block is a straight run of instructions within one page, ending
+ * at a branch, a JMP or the first instruction the compiler doesn't handle.
+ * A, X, Y, the flags and the cycle counter live in host registers while it
+ * runs.
+ *
+ * Memory accesses use the direct pointer tables of Memory. When an access
+ * would take the slow path (devices, ROM or code page writes, copy on
+ * write) the block returns before the instruction, which the interpreter
+ * then runs. Blocks are invalidated by page code versions like the
+ * DecodeCache, and a write to a code page always leaves compiled code, so
+ * self-modifying code is seen at the next instruction.
+ * */
+class JitCache {
+  public:
+    JitCache();
+
+    ~JitCache();
+
+    JitCache(const JitCache&) = delete;
+    JitCache& operator=(const JitCache&) = delete;
+
+    /**
+     * @brief The compiled block at pc, or nullptr while pc isn't hot or
+     * can't be compiled.
+     * */
+    ALWAYS_INLINE const JitBlock* Lookup(Memory& memory, uint16_t pc) {
+        JitBlock* page = m_pages[PAGE_OF(pc)].get();
+        if (LIKELY(page != nullptr)) {
+            JitBlock& block = page[PAGE_OFFSET(pc)];
+            if (LIKELY(block.version == memory.GetCodeVersion(PAGE_OF(pc)))) {
+                if (LIKELY(block.code != nullptr)) {
+                    return &block;
+                }
+                if (block.hits >= JIT_HOT_THRESHOLD) {
+                    return nullptr;
+                }
+            }
+        }
+        return count(memory, pc);
+    }
+
+    /**
+     * @brief Number of blocks compiled since the cache was created.
+     * */
+    uint32_t CountCompiledBlocks() { return m_compiled; }
+
+  private:
+    const JitBlock* count(Memory& memory, uint16_t pc);
+    jit_code_t install(const uint8_t* code, size_t size);
+    void flush();
+
+    std::unique_ptr<JitBlock[]> m_pages[MEM_PAGE_COUNT];
+    uint8_t* m_code;
+    size_t m_code_used;
+    uint32_t m_compiled;
+};
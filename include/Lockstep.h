@@ -0,0 +1,108 @@
+#pragma once
+
+#include <CPU.h>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+// Lanes stored together, a multiple of the widest vector in bytes.
+#define LOCKSTEP_CHUNK 64
+
+/**
+ * @brief Runs many CPUs over the same program in lockstep, e.g. one ROM
+ * with thousands of different inputs. The registers of all lanes live in
+ * structure of arrays form while they run.
+ *
+ * The lanes at the lowest PC among the running ones form a group, kept as
+ * a mask. Each instruction of the group is a loop over all lanes that only
+ * keeps the results of masked ones, which the compiler turns into vector
+ * code (AVX2 or AVX-512 when the build targets them). The group runs on
+ * while its lanes agree on PC. When a branch splits it, or a lane is due
+ * for an event or its budget, the lanes regroup at the lowest PC again, so
+ * lanes that diverged wait at their PC until the others catch up.
+ *
+ * Register, immediate, zero page and absolute instructions run in these
+ * kernels, with each lane's memory reached through its own direct pointer
+ * tables. Any other instruction, and any lane whose access would take the
+ * slow path of Memory or whose code page differs from the other lanes',
+ * runs that one instruction on the lane's own CPU with the table engine.
+ * SP and the interrupt state stay in the lane's CPU. Every lane thus ends
+ * exactly as its CPU would after CPU::Run.
+ * */
+class Lockstep {
+  public:
+    /**
+     * @brief lanes copies of prototype: registers, cycles and a copy-on-write
+     * clone of its memory.
+     * */
+    Lockstep(CPU& prototype, size_t lanes);
+
+    ~Lockstep();
+
+    Lockstep(const Lockstep&) = delete;
+    Lockstep& operator=(const Lockstep&) = delete;
+
+    size_t GetLaneCount() { return m_lanes.size(); }
+
+    /**
+     * @brief The CPU of a lane, to set its inputs, schedule its events or
+     * read its results between runs.
+     * */
+    CPU& GetLane(size_t lane) { return *m_lanes[lane]; }
+
+    /**
+     * @brief Run every lane like CPU::Run(cycle_budget), events and
+     * interrupts included.
+     * */
+    void Run(uint64_t cycle_budget);
+
+    /**
+     * @brief Instructions run by the vector kernels and on single lanes,
+     * counted once per lane, since the Lockstep was created.
+     * */
+    uint64_t CountVectorInstructions() { return m_vector_instructions; }
+
+    uint64_t CountScalarInstructions() { return m_scalar_instructions; }
+
+  private:
+    /**
+     * @brief The registers of LOCKSTEP_CHUNK lanes while they run, plus the
+     * scratch of the kernels. Lanes past the last one never run.
+     * */
+    struct LaneChunk {
+        uint64_t cycles[LOCKSTEP_CHUNK];
+        uint64_t next_stop[LOCKSTEP_CHUNK];
+        const uint8_t* const* read[LOCKSTEP_CHUNK];  // Memory::GetReadPointers
+        uint8_t* const* write[LOCKSTEP_CHUNK];       // Memory::GetWritePointers
+        const uint8_t* const* fetch[LOCKSTEP_CHUNK]; // Memory::GetFetchPointers
+        uint8_t* pointer[LOCKSTEP_CHUNK];            // the operand's byte
+        uint16_t pc[LOCKSTEP_CHUNK];
+        uint16_t nz[LOCKSTEP_CHUNK]; // StatusRegister::Storage
+        uint8_t ac[LOCKSTEP_CHUNK];
+        uint8_t x[LOCKSTEP_CHUNK];
+        uint8_t y[LOCKSTEP_CHUNK];
+        uint8_t bits[LOCKSTEP_CHUNK]; // StatusRegister::Storage
+        uint8_t running[LOCKSTEP_CHUNK];
+        uint8_t mask[LOCKSTEP_CHUNK]; // 1 for the lanes of the group
+        uint8_t value[LOCKSTEP_CHUNK];
+        uint8_t extra[LOCKSTEP_CHUNK]; // cycles past the mode's
+    };
+
+    LaneChunk& chunk_of(size_t lane);
+    void load(size_t lane);
+    void store(size_t lane);
+    void step_lane(size_t lane);
+    void run_group(uint16_t pc);
+    void run_kernel(uint8_t op_code, uint16_t operand);
+    void compare(uint8_t (LaneChunk::*reg)[LOCKSTEP_CHUNK]);
+    void count(uint8_t (LaneChunk::*reg)[LOCKSTEP_CHUNK], uint8_t delta);
+    void flag(uint8_t flag, bool set);
+    void branch(uint8_t op_code, uint16_t operand);
+
+    std::vector<std::unique_ptr<CPU>> m_lanes;
+    std::vector<LaneChunk> m_chunks;
+    std::vector<LaneChunk*> m_group; // the chunks with lanes in the group
+    std::vector<size_t> m_fallback; // lanes a kernel left to step_lane
+    uint64_t m_vector_instructions;
+    uint64_t m_scalar_instructions;
+};
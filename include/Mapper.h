@@ -0,0 +1,88 @@
+#pragma once
+
+#include <Memory.h>
+#include <stdint.h>
+
+/**
+ * @brief Bank switching hardware in front of an image larger than the
+ * address space. A bank switch re-points page table entries into the image
+ * with Memory::MapBank; bank contents are never copied.
+ *
+ * The image is owned by the caller and must outlive the Memory the mapper is
+ * attached to. A mapper serves one Memory at a time.
+ * */
+class Mapper : public Device {
+  public:
+    /**
+     * @brief image_size must be a non zero multiple of bank_size, which must
+     * be a multiple of MEM_PAGE_SIZE.
+     * */
+    Mapper(uint8_t* image, uint32_t image_size, uint32_t bank_size);
+
+    /**
+     * @brief Map the power on banks and the mapper's registers into memory.
+     * */
+    virtual void Attach(Memory& memory) = 0;
+
+    uint32_t GetBankCount() { return m_bank_count; }
+
+  protected:
+    /**
+     * @brief Map bank (modulo the bank count, as the unused high bits of a
+     * bank register are not wired) read only at first_page. CPU writes to
+     * those pages reach this mapper.
+     * */
+    void SelectBank(uint8_t first_page, uint32_t bank);
+
+    Memory* m_memory;
+    uint8_t* m_image;
+    uint32_t m_bank_size, m_bank_count;
+};
+
+/**
+ * @brief 16 KiB banks: 0x8000-0xBFFF is switchable and 0xC000-0xFFFF is
+ * fixed to the last bank, which holds the vectors. Any write to 0x8000-0xFFFF
+ * selects the bank of the lower window, like the NES UxROM boards.
+ * */
+class UxROMMapper : public Mapper {
+  public:
+    UxROMMapper(uint8_t* image, uint32_t image_size);
+
+    void Attach(Memory& memory) override;
+
+    uint8_t Read(uint16_t address) override;
+
+    void Write(uint16_t address, uint8_t data) override;
+
+    uint32_t GetBank() { return m_bank; }
+
+  private:
+    uint32_t m_bank;
+};
+
+/**
+ * @brief 8 KiB banks in four windows at 0x8000, 0xA000, 0xC000 and 0xE000.
+ * The registers live on their own device page: writing register n (offset
+ * n of that page, mirrored every 4 bytes) selects the bank of window n and
+ * reading it returns that bank. At power on window n holds bank n, except
+ * the last window, which holds the last bank.
+ * */
+class WindowMapper : public Mapper {
+  public:
+    static constexpr uint16_t WINDOW_COUNT = 4;
+
+    WindowMapper(uint8_t* image, uint32_t image_size,
+                 uint8_t register_page = 0x7F);
+
+    void Attach(Memory& memory) override;
+
+    uint8_t Read(uint16_t address) override;
+
+    void Write(uint16_t address, uint8_t data) override;
+
+    uint32_t GetBank(uint16_t window) { return m_banks[window]; }
+
+  private:
+    uint8_t m_register_page;
+    uint32_t m_banks[WINDOW_COUNT];
+};
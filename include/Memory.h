@@ -1,22 +1,378 @@
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <memory>
 #include <stdint.h>
-#include <unordered_map>
+#include <utils.h>
 
 #define MEM_SIZE (1024 * 64)
+#define MEM_PAGE_SIZE 256
+#define MEM_PAGE_COUNT (MEM_SIZE / MEM_PAGE_SIZE)
+#define PAGE_OF(address) ((address) >> 8)
+#define PAGE_OFFSET(address) ((address) & 0xFF)
 
+#if defined(__x86_64__) && defined(__GNUC__) && defined(__ELF__)
+#define MEMORY_TRAMPOLINES 1
+#else
+#define MEMORY_TRAMPOLINES 0
+#endif
+
+/**
+ * @brief Memory mapped I/O. A device mapped on a page receives every CPU
+ * access to that page with the full 16 bit address. During an access a
+ * device may raise interrupts and schedule or cancel events on the CPU, but
+ * not change its registers or cycle count.
+ * */
+class Device {
+  public:
+    virtual ~Device() = default;
+
+    virtual uint8_t Read(uint16_t address) = 0;
+
+    virtual void Write(uint16_t address, uint8_t data) = 0;
+
+    /**
+     * @brief Read for debuggers and tracers. Override it when Read has side
+     * effects such as acknowledging an interrupt.
+     * */
+    virtual uint8_t Peek(uint16_t address) { return Read(address); }
+};
+
+/**
+ * @brief Kinds of access a watched address reports, see Memory::SetWatch.
+ * */
+enum Watch : uint8_t {
+    WATCH_READ = 0x1,
+    WATCH_WRITE = 0x2,
+    WATCH_EXECUTE = 0x4, // the op_code fetch of an instruction
+};
+
+/**
+ * @brief Called on a watched access before it happens. For WATCH_EXECUTE,
+ * returning true makes the fetch return WATCH_BREAK_OP_CODE, which is not an
+ * instruction, so the CPU traps before running the one at address.
+ * */
+using watch_func_t = std::function<bool(uint16_t address, Watch kind)>;
+
+#define WATCH_BREAK_OP_CODE 0x02
+
+class Memory;
+
+#if MEMORY_TRAMPOLINES
+/**
+ * The slow paths of Memory::read, fetch and write, called by the
+ * trampolines in Memory.cpp. A trampoline saves every general purpose
+ * register but eax, which holds the byte read, and aligns the stack. It
+ * takes the Memory in rdi, the address in esi and the byte to write in edx,
+ * and its caller must step over the red zone. See CPU::read.
+ * */
+extern "C" {
+__attribute__((visibility("hidden"))) uint8_t
+memory_slow_read(Memory* memory, uint16_t address);
+__attribute__((visibility("hidden"))) uint8_t
+memory_slow_fetch(Memory* memory, uint16_t address);
+__attribute__((visibility("hidden"))) void
+memory_slow_write(Memory* memory, uint16_t address, uint8_t data);
+}
+#endif
+
+enum class PageKind : uint8_t {
+    RAM,
+    ROM,    // CPU writes are ignored, or passed to the page's Device if any
+    DEVICE, // every access goes to the page's Device
+};
+
+/**
+ * @brief The CPU bus. The 64 KiB address space is split in 256 pages, each
+ * mapped to RAM, ROM or a Device.
+ *
+ * RAM and ROM pages are reached through direct pointers in m_read/m_write,
+ * so a plain RAM access is one table load plus the byte access. A null
+ * pointer sends the access to the slow path, which serves devices, drops
+ * writes to ROM and copies shared pages on their first write. The CPU calls
+ * the slow path through a trampoline that keeps its state in registers.
+ *
+ * The storage of RAM and ROM pages is allocated per page and reference
+ * counted. A new Memory maps every page to one shared zero page and Clone
+ * shares all pages with the original, so both cost a page table instead of
+ * 64 KiB and only the pages written afterwards are copied.
+ *
+ * Watched addresses are flagged per page as well. A page with a read or
+ * write watch loses that direct pointer, and one with an execute watch its
+ * direct pointer for op_code fetches, so only accesses to flagged pages
+ * consult the bitmap of watched addresses.
+ *
+ * Each page also has a code version for caches of decoded instructions. It
+ * changes whenever the page's contents may have changed behind the cache:
+ * on writes to pages marked with MarkCode, which lose their direct write
+ * pointer for that purpose, and on every map, load and restore. Versions
+ * are unique across all Memory objects.
+ * */
 class Memory {
   public:
-    void write(uint16_t address, uint8_t* data, uint16_t size) {
-        for (int i = 0; i < size; i++) {
-            m_data[address + i] = data[i];
+    Memory();
+
+    ~Memory();
+
+    Memory(const Memory&) = delete;
+    Memory& operator=(const Memory&) = delete;
+
+    /**
+     * @brief A copy-on-write copy of this address space. Devices and external
+     * banks are shared with the original, not copied. The clone becomes the
+     * baseline of this Memory's dirty page tracking.
+     * */
+    std::shared_ptr<Memory> Clone();
+
+    /**
+     * @brief Return to the contents and mappings of snapshot, a clone that
+     * must not have been written since. Restoring the current baseline
+     * only touches the pages dirtied since it was taken or last restored,
+     * and shares them again instead of copying. Storage behind MapBank is
+     * not part of the snapshot.
+     * */
+    void Restore(const Memory& snapshot);
+
+    /**
+     * @brief Pages written or remapped since the baseline.
+     * */
+    uint16_t CountDirtyPages() { return m_dirty_count; }
+
+    /**
+     * @brief Copy size bytes into memory, including ROM pages. Device pages
+     * are skipped. Used to load programs, not by the CPU.
+     * */
+    void write(uint16_t address, uint8_t* data, uint16_t size);
+
+    ALWAYS_INLINE void write(uint16_t address, uint8_t data) {
+        uint8_t* page = m_write[PAGE_OF(address)];
+        if (LIKELY(page != nullptr)) {
+            page[PAGE_OFFSET(address)] = data;
+        } else {
+            slow_write(address, data);
+        }
+    }
+
+    ALWAYS_INLINE uint8_t read(uint16_t address) {
+        const uint8_t* page = m_read[PAGE_OF(address)];
+        if (LIKELY(page != nullptr)) {
+            return page[PAGE_OFFSET(address)];
+        }
+        return slow_read(address);
+    }
+
+    /**
+     * @brief Read the op_code of the instruction at address.
+     * */
+    ALWAYS_INLINE uint8_t fetch(uint16_t address) {
+        const uint8_t* page = m_fetch[PAGE_OF(address)];
+        if (LIKELY(page != nullptr)) {
+            return page[PAGE_OFFSET(address)];
+        }
+        return slow_fetch(address);
+    }
+
+    /**
+     * @brief Read without side effects on devices.
+     * */
+    uint8_t peek(uint16_t address);
+
+    /**
+     * @brief Report the given Watch kinds of access to address to the watch
+     * handler. Decode caches on the page are invalidated. Watches belong to
+     * this Memory: Clone and Restore neither copy nor drop them.
+     * */
+    void SetWatch(uint16_t address, uint8_t kinds);
+
+    void ClearWatch(uint16_t address, uint8_t kinds);
+
+    /**
+     * @brief The Watch kinds set on address.
+     * */
+    uint8_t GetWatch(uint16_t address) const {
+        uint8_t kinds = 0;
+        if (m_watch_pages[PAGE_OF(address)] != 0) {
+            for (int kind = 0; kind < WATCH_KINDS; kind++) {
+                kinds |= GET_BIT(watch_word(kind, address), address % 64)
+                         << kind;
+            }
         }
+        return kinds;
     }
 
-    void write(uint16_t address, uint8_t data) { m_data[address] = data; }
+    /**
+     * @brief Whether the instruction of length bytes at pc has a breakpoint
+     * or a read watch on an operand byte. Caches of decoded or compiled
+     * code leave such instructions to the interpreter, so the watches see
+     * them.
+     * */
+    bool WatchesInstruction(uint16_t pc, uint8_t length) const {
+        bool watched = GetWatch(pc) & WATCH_EXECUTE;
+        for (int i = 1; i < length; i++) {
+            watched |= GetWatch(pc + i) & WATCH_READ;
+        }
+        return watched;
+    }
+
+    void SetWatchHandler(watch_func_t handler) {
+        m_watch_handler = std::move(handler);
+    }
+
+    void MapRAM(uint8_t first_page, uint16_t page_count);
+
+    void MapROM(uint8_t first_page, uint16_t page_count);
+
+    void MapDevice(uint8_t first_page, uint16_t page_count, Device* device);
+
+    /**
+     * @brief Point page_count pages at external storage, e.g. a bank of a
+     * cartridge image larger than the address space. Nothing is copied, so
+     * switching banks costs one pointer update per page. When kind is ROM a
+     * non null device receives the CPU writes, which is how mappers see
+     * their bank select registers.
+     * */
+    void MapBank(uint8_t first_page, uint16_t page_count, uint8_t* data,
+                 PageKind kind, Device* device = nullptr);
+
+    PageKind GetPageKind(uint8_t page) const { return m_pages[page].kind; }
+
+    /**
+     * @brief The direct pointer tables behind read and write, for code
+     * generated at run time. A null entry means the access has to go
+     * through the slow path.
+     * */
+    const uint8_t* const* GetReadPointers() const { return m_read; }
+
+    uint8_t* const* GetWritePointers() const { return m_write; }
+
+    /**
+     * @brief Like GetReadPointers, for the bytes of instructions. An entry is
+     * null when the page has a device or a read or execute watch, as code
+     * run from it directly must not skip the checks of either.
+     * */
+    const uint8_t* const* GetFetchPointers() const { return m_fetch; }
+
+    ALWAYS_INLINE uint32_t GetCodeVersion(uint8_t page) const {
+        return load_fresh(m_code_versions[page]);
+    }
+
+    /**
+     * @brief Renew page's code version on its next write. The mark is
+     * dropped once the version changes, so call it again after decoding the
+     * page anew.
+     * */
+    ALWAYS_INLINE void MarkCode(uint8_t page) {
+        if (!m_pages[page].code) {
+            mark_code(page);
+        }
+    }
 
-    uint8_t read(uint16_t address) { return m_data[address]; }
+    /**
+     * @brief Map page to data, a page of a read-only mapping that mapping
+     * keeps alive, e.g. a checkpoint file. Nothing is copied: the page is
+     * shared like a cloned one and copied on its first write. A null data
+     * maps the zero page.
+     * */
+    void MapCopyOnWrite(uint8_t page, PageKind kind, const uint8_t* data,
+                        std::shared_ptr<const void> mapping);
+
+    /**
+     * @brief Contents of a RAM or ROM page, or nullptr for device pages and
+     * pages mapped with MapBank, which this Memory doesn't own.
+     * */
+    const uint8_t* GetPageData(uint8_t page) const;
+
+    /**
+     * @brief Whether page was never written since this Memory was created.
+     * */
+    bool IsZeroPage(uint8_t page) const {
+        return m_pages[page].storage == &s_zero_page;
+    }
+
+    /**
+     * @brief Whether page has the same mapping and storage as in other, i.e.
+     * neither was written or remapped since one was cloned from the other.
+     * */
+    bool SamePage(const Memory& other, uint8_t page) const;
+
+    /**
+     * @brief Number of pages whose storage belongs to this Memory alone,
+     * i.e. the pages it had to allocate or copy.
+     * */
+    uint16_t CountPrivatePages();
 
   private:
-    uint8_t m_data[MEM_SIZE] = {0};
+#if MEMORY_TRAMPOLINES
+    friend uint8_t memory_slow_read(Memory*, uint16_t);
+    friend uint8_t memory_slow_fetch(Memory*, uint16_t);
+    friend void memory_slow_write(Memory*, uint16_t, uint8_t);
+#endif
+
+    struct Storage {
+        Storage() : references(1), data(bytes) {}
+
+        std::atomic<uint32_t> references;
+        uint8_t* data; // bytes, or a page of mapping
+        std::shared_ptr<const void> mapping;
+        uint8_t bytes[MEM_PAGE_SIZE];
+    };
+
+    struct Page {
+        uint8_t* data;     // what RAM and ROM accesses reach: storage or a bank
+        Storage* storage;  // the page's own storage, kept while unmapped
+        Device* device;    // handler of DEVICE pages and ROM page writes
+        PageKind kind;
+        bool dirty;        // listed in m_dirty_pages
+        bool code;         // writes renew the code version
+    };
+
+    static Storage s_zero_page;
+    static std::atomic<uint64_t> s_next_id;
+    static std::atomic<uint32_t> s_next_code_version;
+
+    static Storage* acquire(Storage* storage);
+    static void release(Storage* storage);
+    bool is_private(uint8_t page);
+    uint8_t* own(uint8_t page);
+    void mark_dirty(uint8_t page);
+    void reset_baseline(uint64_t baseline);
+    void mark_code(uint8_t page);
+    void renew_code_version(uint8_t page, uint32_t version);
+
+    static constexpr int WATCH_KINDS = 3;
+
+    uint64_t watch_word(int kind, uint16_t address) const {
+        return m_watch_bits[kind * (MEM_SIZE / 64) + address / 64];
+    }
+
+    bool watched(uint16_t address, Watch kind) {
+        return (m_watch_pages[PAGE_OF(address)] & kind) &&
+               m_watch_handler != nullptr &&
+               GET_BIT(watch_word(kind >> 1, address), address % 64);
+    }
+
+    void update_watch(uint8_t page);
+    uint8_t slow_read(uint16_t address);
+    uint8_t slow_fetch(uint16_t address);
+    void slow_write(uint16_t address, uint8_t data);
+    void map(uint8_t first_page, uint16_t page_count, PageKind kind,
+             Device* device, uint8_t* data);
+    void refresh(uint8_t page);
+
+    const uint8_t* m_read[MEM_PAGE_COUNT];
+    uint8_t* m_write[MEM_PAGE_COUNT];
+    const uint8_t* m_fetch[MEM_PAGE_COUNT];
+    Page m_pages[MEM_PAGE_COUNT];
+    uint8_t m_dirty_pages[MEM_PAGE_COUNT];
+    uint32_t m_code_versions[MEM_PAGE_COUNT];
+    uint16_t m_dirty_count;
+    // Unique, and renewed whenever a page is copied or mapped so that a
+    // snapshot changed after it became a baseline doesn't match it anymore.
+    uint64_t m_id;
+    uint64_t m_baseline; // m_id of the clone dirty pages are relative to
+    uint8_t m_watch_pages[MEM_PAGE_COUNT]; // Watch kinds set in each page
+    // One bit per address and Watch kind, allocated by the first SetWatch.
+    std::unique_ptr<uint64_t[]> m_watch_bits;
+    watch_func_t m_watch_handler;
 };
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <Memory.h>
+#include <iosfwd>
+#include <map>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <utils.h>
+#include <vector>
+
+/**
+ * @brief Where guest code spends its cycles: a cycle histogram with an entry
+ * per PC and cycle and instruction counts per op_code, in flat arrays, and a
+ * call graph of the guest's subroutines.
+ *
+ * Attach it with CPU::SetProfiler. Like a TraceSink, it makes Execute run
+ * the instrumented instantiation of the engine, which calls Record before
+ * every instruction; without a profiler or sink the engines contain no
+ * profiling code at all. The cycles between two calls belong to the first
+ * instruction, so cycles spent on events and interrupt entry count toward
+ * the instruction before them. Counts add up over runs until Reset.
+ *
+ * The call graph follows a shadow stack of frames, each remembering SP just
+ * below the return address it was entered with. JSR and interrupts push a
+ * frame. RTS, RTI and TXS pop every frame whose return address is above SP
+ * again, so a routine that pulls its return address to read inline
+ * arguments and pushes it back still returns once. An RTS or RTI that pops
+ * no frame is a jump through the stack, like an RTS dispatch table, and the
+ * target replaces the routine of the top frame.
+ * */
+class Profiler {
+  public:
+    Profiler();
+
+    /**
+     * @brief Called with the instruction about to run at pc, SP and the
+     * cycle counter, which closes the previous instruction.
+     * */
+    ALWAYS_INLINE void Record(uint16_t pc, uint8_t op_code, uint8_t sp,
+                              uint64_t cycles) {
+        close(cycles);
+        if (UNLIKELY(m_moves_stack[m_stack_op] || m_interrupt_sp >= 0)) {
+            follow(pc, sp);
+        }
+        m_pc = pc;
+        m_op_code = op_code;
+        m_stack_op = op_code;
+        m_op_codes[pc] = op_code;
+    }
+
+    /**
+     * @brief Called by CPU::Interrupt before it pushes PC and SR, so the
+     * handler it enters gets a frame.
+     * */
+    void Interrupt(uint16_t pc, uint8_t sp) {
+        follow(pc, sp);
+        m_interrupt_sp = int(sp) - 3;
+    }
+
+    /**
+     * @brief Called when the engine starts and returns. An open instruction
+     * at End gets the cycles up to then. The call stack lives on.
+     * */
+    void Begin(uint64_t cycles) {
+        m_pc = MEM_SIZE;
+        m_op_code = 256;
+        m_last_cycles = cycles;
+    }
+
+    void End(uint64_t cycles) {
+        close(cycles);
+        Begin(cycles);
+    }
+
+    void Reset();
+
+    uint64_t GetCycles(uint16_t pc) { return m_pc_cycles[pc]; }
+
+    uint64_t GetOpCycles(uint8_t op_code) { return m_op_cycles[op_code]; }
+
+    uint64_t GetOpCount(uint8_t op_code) { return m_op_counts[op_code]; }
+
+    uint64_t GetTotalCycles();
+
+    /**
+     * @brief Cycles of the routine at address and everything it called,
+     * counted once when it is on the stack more than once.
+     * */
+    uint64_t GetInclusiveCycles(uint16_t routine);
+
+    /**
+     * @brief Cycles spent in the routine at address itself.
+     * */
+    uint64_t GetExclusiveCycles(uint16_t routine);
+
+    /**
+     * @brief How often the routine at address was called or interrupted to.
+     * */
+    uint64_t GetCallCount(uint16_t routine);
+
+    /**
+     * @brief The names of the routines on the shadow stack, outermost first,
+     * as of the last instruction recorded.
+     * */
+    std::vector<std::string> GetCallStack();
+
+    /**
+     * @brief The top PCs by cycles, with their share and instruction.
+     * */
+    void WriteHotspots(std::ostream& out, size_t top = 20);
+
+    /**
+     * @brief Every op_code that ran, by cycles: count, cycles, cycles per
+     * instruction and share.
+     * */
+    void WriteOpCodes(std::ostream& out);
+
+    /**
+     * @brief Collapsed stacks for flamegraph.pl and compatible viewers, one
+     * line per PC that ran: "page_80;8012_LDA_ABSX <cycles>".
+     * */
+    void WriteFlameGraph(std::ostream& out);
+
+    /**
+     * @brief Every routine by inclusive cycles: calls, inclusive and
+     * exclusive cycles and their shares. Routines are named by address:
+     * start_8000 where a run started, sub_8123 for a JSR target and
+     * int_9000 for an interrupt handler.
+     * */
+    void WriteRoutines(std::ostream& out);
+
+    /**
+     * @brief Collapsed call stacks for flamegraph.pl and compatible viewers,
+     * one line per stack that spent cycles:
+     * "start_8000;sub_8123;int_9000 <exclusive cycles>".
+     * */
+    void WriteCallStacks(std::ostream& out);
+
+  private:
+    enum class FrameKind : uint8_t { START, CALL, INTERRUPT };
+
+    /**
+     * @brief A call path: the routine on top of its parent's path, with the
+     * cycles spent while it was the whole stack. Parents come first.
+     * */
+    struct CallNode {
+        uint32_t parent;
+        uint16_t routine;
+        FrameKind kind;
+        uint64_t cycles;
+        uint64_t calls;
+    };
+
+    struct Frame {
+        uint32_t node;
+        int sp; // frames above it have been returned from once SP is above
+    };
+
+    struct RoutineTotals {
+        uint64_t inclusive;
+        uint64_t exclusive;
+        uint64_t calls;
+    };
+
+    static constexpr uint32_t NO_NODE = UINT32_MAX;
+
+    // Values of m_stack_op past the op_codes: the first instruction is yet
+    // to name the routine the run starts in, or there is nothing to follow.
+    static constexpr uint16_t STACK_START = 256;
+    static constexpr uint16_t STACK_FOLLOWED = 257;
+
+    ALWAYS_INLINE void close(uint64_t cycles) {
+        uint64_t spent = cycles - m_last_cycles;
+        m_pc_cycles[m_pc] += spent;
+        m_op_cycles[m_op_code] += spent;
+        m_op_counts[m_op_code]++;
+        m_nodes[m_frames.back().node].cycles += spent;
+        m_last_cycles = cycles;
+    }
+
+    /**
+     * @brief Update the shadow stack for the last instruction that moved it,
+     * then for a pending interrupt.
+     * */
+    void follow(uint16_t pc, uint8_t sp);
+
+    uint32_t node_of(uint32_t parent, uint16_t routine, FrameKind kind);
+
+    void push(uint16_t routine, int sp, FrameKind kind);
+
+    /**
+     * @brief Cycles and calls per routine, keyed by kind << 16 | address.
+     * */
+    std::map<uint32_t, RoutineTotals> routine_totals();
+
+    // One extra entry past the last PC and op_code collects the time before
+    // the first instruction, so Record needs no branch.
+    std::vector<uint64_t> m_pc_cycles;
+    std::vector<uint8_t> m_op_codes; // last op_code seen at each PC
+    uint64_t m_op_cycles[257];
+    uint64_t m_op_counts[257];
+    uint32_t m_pc;
+    uint16_t m_op_code;
+    uint64_t m_last_cycles;
+
+    // The op_codes after which follow runs, and the last instruction the
+    // shadow stack hasn't followed yet.
+    bool m_moves_stack[258];
+    uint16_t m_stack_op;
+    int m_interrupt_sp; // SP below the pushes of a pending interrupt, or -1
+    std::vector<CallNode> m_nodes;
+    std::unordered_map<uint64_t, uint32_t> m_children;
+    std::vector<Frame> m_frames;
+};
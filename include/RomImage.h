@@ -0,0 +1,43 @@
+#pragma once
+
+#include <Memory.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+/**
+ * @brief A program image mapped read-only from a file with mmap, so loading
+ * costs no read or copy; the kernel pages the image in as the CPU touches it.
+ * */
+class RomImage {
+  public:
+    explicit RomImage(const std::string& path);
+
+    ~RomImage();
+
+    RomImage(const RomImage&) = delete;
+    RomImage& operator=(const RomImage&) = delete;
+
+    bool IsOpen() { return m_data != nullptr; }
+
+    const uint8_t* GetData() { return m_data; }
+
+    size_t GetSize() { return m_size; }
+
+    /**
+     * @brief Whether the image fits in the address space mapped at address.
+     * */
+    bool Fits(uint16_t address) { return address + m_size <= MEM_SIZE; }
+
+    /**
+     * @brief Map the image as ROM pages starting at the page aligned address.
+     * The tail of the last page reads as zero. The image must outlive every
+     * use of memory, and the host loader Memory::write must not be used on
+     * these pages since the mapping is read-only.
+     * */
+    void Map(Memory& memory, uint16_t address);
+
+  private:
+    uint8_t* m_data;
+    size_t m_size;
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+class CPU;
+
+using event_func_t = std::function<void(CPU&)>;
+
+/**
+ * @brief Min-heap of callbacks stamped with the cycle they are due at. Events
+ * due at the same cycle run in the order they were scheduled.
+ * */
+class Scheduler {
+  public:
+    Scheduler() : m_next_id(1) {}
+
+    /**
+     * @brief Returns an id for Cancel.
+     * */
+    uint64_t Schedule(uint64_t cycle, event_func_t callback);
+
+    /**
+     * @brief Returns false if the event already ran or was cancelled.
+     * */
+    bool Cancel(uint64_t id);
+
+    /**
+     * @brief Cycle of the earliest event, UINT64_MAX when there is none.
+     * */
+    uint64_t GetNextCycle() const {
+        return m_heap.empty() ? UINT64_MAX : m_heap.front().cycle;
+    }
+
+    /**
+     * @brief Remove the earliest event into callback if it is due at now.
+     * */
+    bool PopDue(uint64_t now, event_func_t& callback);
+
+    bool IsEmpty() const { return m_heap.empty(); }
+
+  private:
+    struct Event {
+        uint64_t cycle;
+        uint64_t id; // breaks ties between events of the same cycle
+        event_func_t callback;
+
+        // std::push_heap builds a max-heap, so the earliest compares largest.
+        bool operator<(const Event& other) const {
+            return cycle != other.cycle ? cycle > other.cycle : id > other.id;
+        }
+    };
+
+    std::vector<Event> m_heap;
+    uint64_t m_next_id;
+};
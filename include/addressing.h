@@ -1,13 +1,121 @@
 #pragma once
 #include <CPU.h>
 
-uint16_t ADDR_IMM(CPU& cpu);
-uint16_t ADDR_ZP(CPU& cpu);
-uint16_t ADDR_ZPX(CPU& cpu);
-uint16_t ADDR_ZPY(CPU& cpu);
-uint16_t ADDR_ABS(CPU& cpu);
-uint16_t ADDR_ABSX(CPU& cpu, bool force_cycle = false);
-uint16_t ADDR_ABSY(CPU& cpu, bool force_cycle = false);
-uint16_t ADDR_IND(CPU& cpu);
-uint16_t ADDR_INDX(CPU& cpu);
-uint16_t ADDR_INDY(CPU& cpu, bool force_cycle = false);
\ No newline at end of file
+/**
+ * @brief An addressing mode consumes the operand bytes of the current
+ * instruction and returns the effective address.
+ *
+ * The modes are defined inline so that handlers instantiated over them
+ * (see handlers.h) compile to straight-line code.
+ *
+ * DECODED modes serve the predecoded engine: the operand bytes come from
+ * CPU::GetOperand, and PC and the cycles of the fetches were already
+ * advanced when the instruction was dispatched.
+ * */
+using addr_func_t = uint16_t (*)(CPU&);
+
+template <bool DECODED> ALWAYS_INLINE uint8_t operand_byte(CPU& cpu) {
+    if constexpr (DECODED) {
+        return cpu.GetOperand();
+    } else {
+        return cpu.Fetch();
+    }
+}
+
+template <bool DECODED> ALWAYS_INLINE uint16_t operand_address(CPU& cpu) {
+    if constexpr (DECODED) {
+        return cpu.GetOperand();
+    } else {
+        uint8_t low = cpu.Fetch();
+        uint8_t high = cpu.Fetch();
+        return address_from_bytes(low, high);
+    }
+}
+
+/**
+ * @brief The operand byte itself is read by the handler, so a DECODED
+ * immediate only points behind the op_code.
+ * */
+template <bool DECODED = false> ALWAYS_INLINE uint16_t ADDR_IMM(CPU& cpu) {
+    return DECODED ? cpu.PC - 1 : cpu.PC++;
+}
+
+template <bool DECODED = false> ALWAYS_INLINE uint16_t ADDR_ZP(CPU& cpu) {
+    return operand_byte<DECODED>(cpu);
+}
+
+template <bool DECODED = false> ALWAYS_INLINE uint16_t ADDR_ZPX(CPU& cpu) {
+    ADD_CYCLE(cpu);
+    uint16_t address = operand_byte<DECODED>(cpu) + cpu.X;
+    return address & 0x00FF;
+}
+
+template <bool DECODED = false> ALWAYS_INLINE uint16_t ADDR_ZPY(CPU& cpu) {
+    ADD_CYCLE(cpu);
+    uint16_t address = operand_byte<DECODED>(cpu) + cpu.Y;
+    return address & 0x00FF;
+}
+
+template <bool DECODED = false> ALWAYS_INLINE uint16_t ADDR_ABS(CPU& cpu) {
+    return operand_address<DECODED>(cpu);
+}
+
+/**
+ * @brief FORCE_CYCLE adds the page-crossing cycle unconditionally, as stores
+ * and read-modify-write instructions always pay it.
+ * */
+template <bool FORCE_CYCLE = false, bool DECODED = false>
+ALWAYS_INLINE uint16_t ADDR_ABSX(CPU& cpu) {
+    uint16_t base_address = operand_address<DECODED>(cpu);
+    uint16_t address = base_address + cpu.X;
+
+    if (FORCE_CYCLE || ((address >> 8) != (base_address >> 8))) {
+        ADD_CYCLE(cpu);
+    }
+
+    return address;
+}
+
+template <bool FORCE_CYCLE = false, bool DECODED = false>
+ALWAYS_INLINE uint16_t ADDR_ABSY(CPU& cpu) {
+    uint16_t base_address = operand_address<DECODED>(cpu);
+    uint16_t address = base_address + cpu.Y;
+
+    if (FORCE_CYCLE || ((address >> 8) != (base_address >> 8))) {
+        ADD_CYCLE(cpu);
+    }
+
+    return address;
+}
+
+template <bool DECODED = false> ALWAYS_INLINE uint16_t ADDR_IND(CPU& cpu) {
+    uint16_t abs_add = operand_address<DECODED>(cpu);
+    uint8_t low = cpu.read(abs_add);
+    uint8_t high = cpu.read(abs_add + 1);
+    return address_from_bytes(low, high);
+}
+
+template <bool DECODED = false> ALWAYS_INLINE uint16_t ADDR_INDX(CPU& cpu) {
+    uint16_t address = (uint16_t)operand_byte<DECODED>(cpu) + (uint16_t)cpu.X;
+    ADD_CYCLE(cpu);
+
+    uint8_t low = cpu.read(address & 0x00FF);
+    uint8_t high = cpu.read((address + 1) & 0x00FF);
+    return address_from_bytes(low, high);
+}
+
+template <bool FORCE_CYCLE = false, bool DECODED = false>
+ALWAYS_INLINE uint16_t ADDR_INDY(CPU& cpu) {
+    uint16_t address = operand_byte<DECODED>(cpu);
+    uint8_t low = cpu.read(address & 0x00FF);
+    uint8_t high = cpu.read((address + 1) & 0x00FF);
+
+    uint16_t base_address = address_from_bytes(low, high);
+    address = base_address + cpu.Y;
+
+    if (FORCE_CYCLE || ((address >> 8) != (base_address >> 8))) {
+        ADD_CYCLE(cpu);
+    }
+
+    return address;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * @brief Outcome of a decimal mode ADC or SBC: the new accumulator and the
+ * N, V, Z and C flags at their status register positions (NV....ZC).
+ * */
+struct DecimalResult {
+    uint8_t value;
+    uint8_t flags;
+};
+
+/**
+ * @brief Precomputed decimal mode results indexed by [carry][AC][operand],
+ * following the NMOS 6502 for all inputs, including invalid BCD digits:
+ * ADC takes N and V from the intermediate sum before the high digit is
+ * adjusted and Z from the binary sum, SBC sets every flag like binary SBC.
+ * Built before main.
+ * */
+extern DecimalResult decimal_adc[2][256][256];
+extern DecimalResult decimal_sbc[2][256][256];
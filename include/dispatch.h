@@ -0,0 +1,22 @@
+#pragma once
+
+/**
+ * @brief X-macros that expand M once per op_code, for the engines that give
+ * every op_code its own label (threaded.cpp, DecodeCache.cpp).
+ * */
+
+// clang-format off
+#define OP_ROW(M, h)                                                           \
+    M(0x##h##0) M(0x##h##1) M(0x##h##2) M(0x##h##3)                            \
+    M(0x##h##4) M(0x##h##5) M(0x##h##6) M(0x##h##7)                            \
+    M(0x##h##8) M(0x##h##9) M(0x##h##A) M(0x##h##B)                            \
+    M(0x##h##C) M(0x##h##D) M(0x##h##E) M(0x##h##F)
+
+#define OP_ALL(M)                                                              \
+    OP_ROW(M, 0) OP_ROW(M, 1) OP_ROW(M, 2) OP_ROW(M, 3)                        \
+    OP_ROW(M, 4) OP_ROW(M, 5) OP_ROW(M, 6) OP_ROW(M, 7)                        \
+    OP_ROW(M, 8) OP_ROW(M, 9) OP_ROW(M, A) OP_ROW(M, B)                        \
+    OP_ROW(M, C) OP_ROW(M, D) OP_ROW(M, E) OP_ROW(M, F)
+// clang-format on
+
+#define LABEL_ADDRESS(op) &&op_##op,
@@ -0,0 +1,34 @@
+#pragma once
+
+/**
+ * @brief Op_code pairs the predecoded engine runs as one superinstruction,
+ * as M(first, second) with Instruction names, most frequent first. The
+ * first op_code must fall through to the second (no branch, jump or
+ * return), the second may be anything.
+ *
+ * Generated by `6502_pairs` from binary traces of the 6502_bench programs
+ * (memcpy, crc16, sort and sieve), each run to completion:
+ * 16 pairs covering 74.9% of 403707 pairs counted. Regenerate it from
+ * traces of the workload that matters; every pair costs one more label in
+ * the predecoded engine, so keep it short. Only pairs are fused, longer
+ * sequences such as triples are out of scope.
+ * */
+// clang-format off
+#define FUSION_PROFILE(M)                                                      \
+    M(EOR_IMM, STA_ZP)                                                         \
+    M(LDA_ZP, EOR_IMM)                                                         \
+    M(ASL_ZP, ROL_ZP)                                                          \
+    M(ROL_ZP, BCC)                                                             \
+    M(DEC_ZP, BNE)                                                             \
+    M(STA_ZP, LDA_ZP)                                                          \
+    M(STA_ZP, DEC_ZP)                                                          \
+    M(INX, CMX_IMM)                                                            \
+    M(CMX_IMM, BNE)                                                            \
+    M(CMP_ABSX, BCC)                                                           \
+    M(LDA_ABSX, CMP_ABSX)                                                      \
+    M(INY, BNE)                                                                \
+    M(CLC, LDA_ZP)                                                             \
+    M(CMP_IMM, BCS)                                                            \
+    M(LDA_ZP, ADC_IMM)                                                         \
+    M(LDA_ZP, ADC_ZP)
+// clang-format on
@@ -0,0 +1,699 @@
+#pragma once
+
+#include <addressing.h>
+#include <decimal.h>
+#include <instructions.h>
+
+/**
+ * Instruction handlers, one instantiation per (operation, addressing mode)
+ * pair. The dispatch table already knows the addressing mode of every
+ * op_code, so the handlers receive it as a template argument instead of
+ * switching on op_code again.
+ * */
+
+ALWAYS_INLINE void apply_decimal(CPU& cpu, const DecimalResult& result) {
+    cpu.AC = result.value;
+    cpu.SR.SetNZ(result.flags, ~result.flags & 0x02);
+    cpu.SR.SetVC(result.flags);
+}
+
+template <addr_func_t ADDR> ALWAYS_INLINE void INST_ADC(CPU& cpu, uint8_t) {
+    uint16_t address = ADDR(cpu);
+
+    uint8_t operand = cpu.read(address);
+    if (UNLIKELY(cpu.SR.D)) {
+        apply_decimal(cpu, decimal_adc[cpu.SR.C][cpu.AC][operand]);
+        return;
+    }
+
+    uint8_t ac = cpu.AC;
+    uint16_t val = operand + cpu.AC + cpu.SR.C;
+    cpu.AC = (val & 0xFF);
+
+    cpu.SR.SetNZ(cpu.AC);
+    // Overflow when both operands have the sign the result lacks.
+    uint8_t overflow = (ac ^ cpu.AC) & (operand ^ cpu.AC) & 0x80;
+    cpu.SR.SetVC(overflow >> 1 | GET_BIT(val, 8));
+}
+
+template <addr_func_t ADDR> ALWAYS_INLINE void INST_AND(CPU& cpu, uint8_t) {
+    uint16_t address = ADDR(cpu);
+
+    cpu.AC &= cpu.read(address);
+
+    cpu.SR.SetNZ(cpu.AC);
+}
+
+ALWAYS_INLINE void INST_ASL_ACC(CPU& cpu, uint8_t) {
+    ADD_CYCLE(cpu);
+    uint16_t val = cpu.AC;
+    val <<= 1;
+    cpu.AC = val & 0xFF;
+
+    cpu.SR.SetNZ(val);
+    cpu.SR.C = GET_BIT(val, 8);
+}
+
+template <addr_func_t ADDR> ALWAYS_INLINE void INST_ASL(CPU& cpu, uint8_t) {
+    uint16_t address = ADDR(cpu);
+
+    ADD_CYCLE(cpu);
+    uint16_t val = cpu.read(address);
+    val <<= 1;
+    cpu.write(address, val & 0xFF);
+
+    cpu.SR.SetNZ(val);
+    cpu.SR.C = GET_BIT(val, 8);
+}
+
+template <Instruction OP> ALWAYS_INLINE void INST_BRANCH(CPU& cpu, uint8_t) {
+    uint8_t offset = cpu.Fetch();
+    bool condition = false;
+
+    if constexpr (OP == Instruction::BCC) {
+        condition = (cpu.SR.C == 0);
+    } else if constexpr (OP == Instruction::BCS) {
+        condition = (cpu.SR.C == 1);
+    } else if constexpr (OP == Instruction::BEQ) {
+        condition = (cpu.SR.Z == 1);
+    } else if constexpr (OP == Instruction::BNE) {
+        condition = (cpu.SR.Z == 0);
+    } else if constexpr (OP == Instruction::BMI) {
+        condition = (cpu.SR.N == 1);
+    } else if constexpr (OP == Instruction::BPL) {
+        condition = (cpu.SR.N == 0);
+    } else if constexpr (OP == Instruction::BVC) {
+        condition = (cpu.SR.V == 0);
+    } else if constexpr (OP == Instruction::BVS) {
+        condition = (cpu.SR.V == 1);
+    }
+
+    if (condition) {
+        ADD_CYCLE(cpu);
+        auto old_pc = cpu.PC;
+        cpu.PC += int8_t(offset);
+        if ((cpu.PC >> 8) != (old_pc >> 8)) {
+            ADD_CYCLE(cpu);
+        }
+    }
+}
+
+template <addr_func_t ADDR> ALWAYS_INLINE void INST_BIT(CPU& cpu, uint8_t) {
+    uint16_t address = ADDR(cpu);
+
+    uint8_t operand = cpu.read(address);
+    cpu.SR.SetNZ(operand, cpu.AC & operand);
+    cpu.SR.V = GET_BIT(operand, 6);
+}
+
+template <Instruction OP> ALWAYS_INLINE void INST_STATUS(CPU& cpu, uint8_t) {
+    if constexpr (OP == Instruction::CLC) {
+        cpu.SR.C = 0;
+    } else if constexpr (OP == Instruction::CLD) {
+        cpu.SR.D = 0;
+    } else if constexpr (OP == Instruction::CLI) {
+        cpu.SR.I = 0;
+    } else if constexpr (OP == Instruction::CLV) {
+        cpu.SR.V = 0;
+    } else if constexpr (OP == Instruction::SEC) {
+        cpu.SR.C = 1;
+    } else if constexpr (OP == Instruction::SED) {
+        cpu.SR.D = 1;
+    } else if constexpr (OP == Instruction::SEI) {
+        cpu.SR.I = 1;
+    }
+
+    ADD_CYCLE(cpu);
+}
+
+ALWAYS_INLINE void INST_BRK(CPU& cpu, uint8_t op_code) {
+    if (UNLIKELY(cpu.HaltsOnBRK())) {
+        cpu.Trap(op_code);
+        return;
+    }
+    // BRK skips a padding byte, so RTI returns past it.
+    cpu.Fetch();
+    cpu.Interrupt(0xFFFE, true);
+}
+
+template <addr_func_t ADDR> ALWAYS_INLINE void INST_CMP(CPU& cpu, uint8_t) {
+    uint16_t address = ADDR(cpu);
+
+    auto value = cpu.read(address);
+    uint8_t result = cpu.AC - value;
+
+    cpu.SR.SetNZ(result);
+    cpu.SR.C = (cpu.AC >= value);
+}
+
+template <addr_func_t ADDR> ALWAYS_INLINE void INST_CMX(CPU& cpu, uint8_t) {
+    uint16_t address = ADDR(cpu);
+
+    auto value = cpu.read(address);
+    uint8_t result = cpu.X - value;
+
+    cpu.SR.SetNZ(result);
+    cpu.SR.C = (cpu.X >= value);
+}
+
+template <addr_func_t ADDR> ALWAYS_INLINE void INST_CMY(CPU& cpu, uint8_t) {
+    uint16_t address = ADDR(cpu);
+
+    auto value = cpu.read(address);
+    uint8_t result = cpu.Y - value;
+
+    cpu.SR.SetNZ(result);
+    cpu.SR.C = (cpu.Y >= value);
+}
+
+template <addr_func_t ADDR> ALWAYS_INLINE void INST_DEC(CPU& cpu, uint8_t) {
+    uint16_t address = ADDR(cpu);
+
+    uint8_t value = cpu.read(address);
+    value--;
+    ADD_CYCLE(cpu);
+    cpu.write(address, value);
+
+    cpu.SR.SetNZ(value);
+}
+
+ALWAYS_INLINE void INST_DEX(CPU& cpu, uint8_t) {
+    cpu.X--;
+
+    ADD_CYCLE(cpu);
+    cpu.SR.SetNZ(cpu.X);
+}
+
+ALWAYS_INLINE void INST_DEY(CPU& cpu, uint8_t) {
+    cpu.Y--;
+
+    ADD_CYCLE(cpu);
+    cpu.SR.SetNZ(cpu.Y);
+}
+
+template <addr_func_t ADDR> ALWAYS_INLINE void INST_EOR(CPU& cpu, uint8_t) {
+    uint16_t address = ADDR(cpu);
+
+    cpu.AC = cpu.AC ^ cpu.read(address);
+    cpu.SR.SetNZ(cpu.AC);
+}
+
+template <addr_func_t ADDR> ALWAYS_INLINE void INST_INC(CPU& cpu, uint8_t) {
+    uint16_t address = ADDR(cpu);
+
+    uint8_t value = cpu.read(address);
+    value++;
+    ADD_CYCLE(cpu);
+    cpu.write(address, value);
+
+    cpu.SR.SetNZ(value);
+}
+
+ALWAYS_INLINE void INST_INX(CPU& cpu, uint8_t) {
+    cpu.X++;
+
+    ADD_CYCLE(cpu);
+    cpu.SR.SetNZ(cpu.X);
+}
+
+ALWAYS_INLINE void INST_INY(CPU& cpu, uint8_t) {
+    cpu.Y++;
+
+    ADD_CYCLE(cpu);
+    cpu.SR.SetNZ(cpu.Y);
+}
+
+template <addr_func_t ADDR> ALWAYS_INLINE void INST_JMP(CPU& cpu, uint8_t) {
+    cpu.PC = ADDR(cpu);
+}
+
+ALWAYS_INLINE void INST_JSR(CPU& cpu, uint8_t) {
+    // Pushes the address of its own last byte, RTS adds the missing 1.
+    uint16_t address = ADDR_ABS(cpu);
+    auto [low, high] = bytes_from_address(cpu.PC - 1);
+    cpu.PUSH(high);
+    cpu.PUSH(low);
+    ADD_CYCLE(cpu);
+    cpu.PC = address;
+}
+
+template <addr_func_t ADDR> ALWAYS_INLINE void INST_LDA(CPU& cpu, uint8_t) {
+    uint16_t address = ADDR(cpu);
+
+    cpu.AC = cpu.read(address);
+    cpu.SR.SetNZ(cpu.AC);
+}
+
+template <addr_func_t ADDR> ALWAYS_INLINE void INST_LDX(CPU& cpu, uint8_t) {
+    uint16_t address = ADDR(cpu);
+
+    cpu.X = cpu.read(address);
+    cpu.SR.SetNZ(cpu.X);
+}
+
+template <addr_func_t ADDR> ALWAYS_INLINE void INST_LDY(CPU& cpu, uint8_t) {
+    uint16_t address = ADDR(cpu);
+
+    cpu.Y = cpu.read(address);
+    cpu.SR.SetNZ(cpu.Y);
+}
+
+ALWAYS_INLINE void INST_LSR_ACC(CPU& cpu, uint8_t) {
+    ADD_CYCLE(cpu);
+    uint16_t val = cpu.AC;
+    cpu.SR.C = GET_BIT(val, 0);
+    val >>= 1;
+    cpu.AC = val & 0xFF;
+
+    cpu.SR.SetNZ(val);
+}
+
+template <addr_func_t ADDR> ALWAYS_INLINE void INST_LSR(CPU& cpu, uint8_t) {
+    uint16_t address = ADDR(cpu);
+
+    ADD_CYCLE(cpu);
+    uint16_t val = cpu.read(address);
+    cpu.SR.C = GET_BIT(val, 0);
+    val >>= 1;
+    cpu.write(address, val & 0xFF);
+
+    cpu.SR.SetNZ(val);
+}
+
+ALWAYS_INLINE void INST_NOP(CPU& cpu, uint8_t) { ADD_CYCLE(cpu); }
+
+template <addr_func_t ADDR> ALWAYS_INLINE void INST_ORA(CPU& cpu, uint8_t) {
+    uint16_t address = ADDR(cpu);
+
+    cpu.AC = cpu.AC | cpu.read(address);
+    cpu.SR.SetNZ(cpu.AC);
+}
+
+template <Instruction OP> ALWAYS_INLINE void INST_PUSH(CPU& cpu, uint8_t) {
+    if constexpr (OP == Instruction::PHA) {
+        cpu.PUSH(cpu.AC);
+    } else if constexpr (OP == Instruction::PHP) {
+        cpu.PUSH(cpu.SR.Value());
+    }
+    ADD_CYCLE(cpu);
+}
+
+template <Instruction OP> ALWAYS_INLINE void INST_PULL(CPU& cpu, uint8_t) {
+    if constexpr (OP == Instruction::PLA) {
+        cpu.AC = cpu.POP();
+    } else if constexpr (OP == Instruction::PLP) {
+        cpu.SR.Set(cpu.POP());
+    }
+    ADD_CYCLE(cpu);
+    ADD_CYCLE(cpu);
+}
+
+ALWAYS_INLINE void INST_ROL_ACC(CPU& cpu, uint8_t) {
+    ADD_CYCLE(cpu);
+    uint16_t val = cpu.AC;
+    val = val << 1 | cpu.SR.C;
+    cpu.AC = val & 0xFF;
+
+    cpu.SR.SetNZ(cpu.AC);
+    cpu.SR.C = GET_BIT(val, 8);
+}
+
+template <addr_func_t ADDR> ALWAYS_INLINE void INST_ROL(CPU& cpu, uint8_t) {
+    uint16_t address = ADDR(cpu);
+
+    ADD_CYCLE(cpu);
+    uint16_t val = cpu.read(address);
+    val = val << 1 | cpu.SR.C;
+    cpu.write(address, val & 0xFF);
+
+    cpu.SR.SetNZ(val);
+    cpu.SR.C = GET_BIT(val, 8);
+}
+
+ALWAYS_INLINE void INST_ROR_ACC(CPU& cpu, uint8_t) {
+    ADD_CYCLE(cpu);
+    uint16_t val = cpu.AC;
+    val |= cpu.SR.C << 8;
+    cpu.AC = val >> 1;
+
+    cpu.SR.SetNZ(cpu.AC);
+    cpu.SR.C = GET_BIT(val, 0);
+}
+
+template <addr_func_t ADDR> ALWAYS_INLINE void INST_ROR(CPU& cpu, uint8_t) {
+    uint16_t address = ADDR(cpu);
+
+    ADD_CYCLE(cpu);
+    uint16_t val = cpu.read(address);
+    val |= cpu.SR.C << 8;
+    cpu.write(address, val >> 1);
+
+    cpu.SR.SetNZ(val >> 1);
+    cpu.SR.C = GET_BIT(val, 0);
+}
+
+ALWAYS_INLINE void INST_RTI(CPU& cpu, uint8_t) {
+    cpu.SR.Set(cpu.POP());
+    uint8_t low = cpu.POP();
+    uint8_t high = cpu.POP();
+    cpu.PC = address_from_bytes(low, high);
+    ADD_CYCLE(cpu);
+    ADD_CYCLE(cpu);
+}
+
+ALWAYS_INLINE void INST_RTS(CPU& cpu, uint8_t) {
+    uint8_t low = cpu.POP();
+    uint8_t high = cpu.POP();
+    cpu.PC = address_from_bytes(low, high) + 1;
+    ADD_CYCLE(cpu);
+    ADD_CYCLE(cpu);
+    ADD_CYCLE(cpu);
+}
+
+template <addr_func_t ADDR> ALWAYS_INLINE void INST_SBC(CPU& cpu, uint8_t) {
+    uint16_t address = ADDR(cpu);
+
+    uint8_t operand = cpu.read(address);
+    if (UNLIKELY(cpu.SR.D)) {
+        apply_decimal(cpu, decimal_sbc[cpu.SR.C][cpu.AC][operand]);
+        return;
+    }
+
+    uint8_t ac = cpu.AC;
+    uint16_t val = cpu.AC - operand - (1 - cpu.SR.C);
+    cpu.AC = (val & 0xFF);
+
+    cpu.SR.SetNZ(cpu.AC);
+    // No borrow leaves the carry set. Overflow needs operands of
+    // different signs and a result whose sign differs from AC.
+    uint8_t overflow = (ac ^ operand) & (ac ^ cpu.AC) & 0x80;
+    cpu.SR.SetVC(overflow >> 1 | !GET_BIT(val, 8));
+}
+
+template <addr_func_t ADDR> ALWAYS_INLINE void INST_STA(CPU& cpu, uint8_t) {
+    uint16_t address = ADDR(cpu);
+
+    cpu.write(address, cpu.AC);
+}
+
+template <addr_func_t ADDR> ALWAYS_INLINE void INST_STX(CPU& cpu, uint8_t) {
+    uint16_t address = ADDR(cpu);
+
+    cpu.write(address, cpu.X);
+}
+
+template <addr_func_t ADDR> ALWAYS_INLINE void INST_STY(CPU& cpu, uint8_t) {
+    uint16_t address = ADDR(cpu);
+
+    cpu.write(address, cpu.Y);
+}
+
+template <Instruction OP> ALWAYS_INLINE void INST_TRANSFER(CPU& cpu, uint8_t) {
+    if constexpr (OP == Instruction::TAX) {
+        cpu.X = cpu.AC;
+        ADD_CYCLE(cpu);
+    } else if constexpr (OP == Instruction::TAY) {
+        ADD_CYCLE(cpu);
+        cpu.Y = cpu.AC;
+    } else if constexpr (OP == Instruction::TSX) {
+        cpu.X = cpu.read(cpu.SP);
+    } else if constexpr (OP == Instruction::TXA) {
+        cpu.AC = cpu.X;
+        ADD_CYCLE(cpu);
+    } else if constexpr (OP == Instruction::TXS) {
+        cpu.write(cpu.SP, cpu.X);
+    } else if constexpr (OP == Instruction::TYA) {
+        cpu.AC = cpu.X;
+        ADD_CYCLE(cpu);
+    }
+}
+
+template <bool DECODED>
+constexpr void initialize_map(dispatch_table_t& inst_map) {
+    inst_map[Instruction::ADC_IMM] = INST_ADC<ADDR_IMM<DECODED>>;
+    inst_map[Instruction::ADC_ZP] = INST_ADC<ADDR_ZP<DECODED>>;
+    inst_map[Instruction::ADC_ZPX] = INST_ADC<ADDR_ZPX<DECODED>>;
+    inst_map[Instruction::ADC_ABS] = INST_ADC<ADDR_ABS<DECODED>>;
+    inst_map[Instruction::ADC_ABSX] = INST_ADC<ADDR_ABSX<false, DECODED>>;
+    inst_map[Instruction::ADC_ABSY] = INST_ADC<ADDR_ABSY<false, DECODED>>;
+    inst_map[Instruction::ADC_INDX] = INST_ADC<ADDR_INDX<DECODED>>;
+    inst_map[Instruction::ADC_INDY] = INST_ADC<ADDR_INDY<false, DECODED>>;
+
+    inst_map[Instruction::AND_IMM] = INST_AND<ADDR_IMM<DECODED>>;
+    inst_map[Instruction::AND_ZP] = INST_AND<ADDR_ZP<DECODED>>;
+    inst_map[Instruction::AND_ZPX] = INST_AND<ADDR_ZPX<DECODED>>;
+    inst_map[Instruction::AND_ABS] = INST_AND<ADDR_ABS<DECODED>>;
+    inst_map[Instruction::AND_ABSX] = INST_AND<ADDR_ABSX<false, DECODED>>;
+    inst_map[Instruction::AND_ABSY] = INST_AND<ADDR_ABSY<false, DECODED>>;
+    inst_map[Instruction::AND_INDX] = INST_AND<ADDR_INDX<DECODED>>;
+    inst_map[Instruction::AND_INDY] = INST_AND<ADDR_INDY<false, DECODED>>;
+
+    inst_map[Instruction::ASL_ACC] = INST_ASL_ACC;
+    inst_map[Instruction::ASL_ZP] = INST_ASL<ADDR_ZP<DECODED>>;
+    inst_map[Instruction::ASL_ZPX] = INST_ASL<ADDR_ZPX<DECODED>>;
+    inst_map[Instruction::ASL_ABS] = INST_ASL<ADDR_ABS<DECODED>>;
+    inst_map[Instruction::ASL_ABSX] = INST_ASL<ADDR_ABSX<true, DECODED>>;
+
+    inst_map[Instruction::BCC] = INST_BRANCH<Instruction::BCC>;
+    inst_map[Instruction::BCS] = INST_BRANCH<Instruction::BCS>;
+    inst_map[Instruction::BEQ] = INST_BRANCH<Instruction::BEQ>;
+    inst_map[Instruction::BMI] = INST_BRANCH<Instruction::BMI>;
+    inst_map[Instruction::BNE] = INST_BRANCH<Instruction::BNE>;
+    inst_map[Instruction::BPL] = INST_BRANCH<Instruction::BPL>;
+    inst_map[Instruction::BVC] = INST_BRANCH<Instruction::BVC>;
+    inst_map[Instruction::BVS] = INST_BRANCH<Instruction::BVS>;
+
+    inst_map[Instruction::BIT_ZP] = INST_BIT<ADDR_ZP<DECODED>>;
+    inst_map[Instruction::BIT_ABS] = INST_BIT<ADDR_ABS<DECODED>>;
+
+    inst_map[Instruction::CLC] = INST_STATUS<Instruction::CLC>;
+    inst_map[Instruction::CLD] = INST_STATUS<Instruction::CLD>;
+    inst_map[Instruction::CLI] = INST_STATUS<Instruction::CLI>;
+    inst_map[Instruction::CLV] = INST_STATUS<Instruction::CLV>;
+    inst_map[Instruction::SEC] = INST_STATUS<Instruction::SEC>;
+    inst_map[Instruction::SED] = INST_STATUS<Instruction::SED>;
+    inst_map[Instruction::SEI] = INST_STATUS<Instruction::SEI>;
+
+    inst_map[Instruction::BRK] = INST_BRK;
+
+    inst_map[Instruction::CMP_IMM] = INST_CMP<ADDR_IMM<DECODED>>;
+    inst_map[Instruction::CMP_ZP] = INST_CMP<ADDR_ZP<DECODED>>;
+    inst_map[Instruction::CMP_ZPX] = INST_CMP<ADDR_ZPX<DECODED>>;
+    inst_map[Instruction::CMP_ABS] = INST_CMP<ADDR_ABS<DECODED>>;
+    inst_map[Instruction::CMP_ABSX] = INST_CMP<ADDR_ABSX<false, DECODED>>;
+    inst_map[Instruction::CMP_ABSY] = INST_CMP<ADDR_ABSY<false, DECODED>>;
+    inst_map[Instruction::CMP_INDX] = INST_CMP<ADDR_INDX<DECODED>>;
+    inst_map[Instruction::CMP_INDY] = INST_CMP<ADDR_INDY<false, DECODED>>;
+
+    inst_map[Instruction::CMX_IMM] = INST_CMX<ADDR_IMM<DECODED>>;
+    inst_map[Instruction::CMX_ZP] = INST_CMX<ADDR_ZP<DECODED>>;
+    inst_map[Instruction::CMX_ABS] = INST_CMX<ADDR_ABS<DECODED>>;
+
+    inst_map[Instruction::CMY_IMM] = INST_CMY<ADDR_IMM<DECODED>>;
+    inst_map[Instruction::CMY_ZP] = INST_CMY<ADDR_ZP<DECODED>>;
+    inst_map[Instruction::CMY_ABS] = INST_CMY<ADDR_ABS<DECODED>>;
+
+    inst_map[Instruction::DEC_ZP] = INST_DEC<ADDR_ZP<DECODED>>;
+    inst_map[Instruction::DEC_ZPX] = INST_DEC<ADDR_ZPX<DECODED>>;
+    inst_map[Instruction::DEC_ABS] = INST_DEC<ADDR_ABS<DECODED>>;
+    inst_map[Instruction::DEC_ABSX] = INST_DEC<ADDR_ABSX<true, DECODED>>;
+
+    inst_map[Instruction::DEX] = INST_DEX;
+    inst_map[Instruction::DEY] = INST_DEY;
+
+    inst_map[Instruction::EOR_IMM] = INST_EOR<ADDR_IMM<DECODED>>;
+    inst_map[Instruction::EOR_ZP] = INST_EOR<ADDR_ZP<DECODED>>;
+    inst_map[Instruction::EOR_ZPX] = INST_EOR<ADDR_ZPX<DECODED>>;
+    inst_map[Instruction::EOR_ABS] = INST_EOR<ADDR_ABS<DECODED>>;
+    inst_map[Instruction::EOR_ABSX] = INST_EOR<ADDR_ABSX<false, DECODED>>;
+    inst_map[Instruction::EOR_ABSY] = INST_EOR<ADDR_ABSY<false, DECODED>>;
+    inst_map[Instruction::EOR_INDX] = INST_EOR<ADDR_INDX<DECODED>>;
+    inst_map[Instruction::EOR_INDY] = INST_EOR<ADDR_INDY<false, DECODED>>;
+
+    inst_map[Instruction::INC_ZP] = INST_INC<ADDR_ZP<DECODED>>;
+    inst_map[Instruction::INC_ZPX] = INST_INC<ADDR_ZPX<DECODED>>;
+    inst_map[Instruction::INC_ABS] = INST_INC<ADDR_ABS<DECODED>>;
+    inst_map[Instruction::INC_ABSX] = INST_INC<ADDR_ABSX<true, DECODED>>;
+
+    inst_map[Instruction::INX] = INST_INX;
+    inst_map[Instruction::INY] = INST_INY;
+
+    inst_map[Instruction::JMP_ABS] = INST_JMP<ADDR_ABS<DECODED>>;
+    inst_map[Instruction::JMP_IND] = INST_JMP<ADDR_IND<DECODED>>;
+
+    inst_map[Instruction::JSR] = INST_JSR;
+
+    inst_map[Instruction::LDA_IMM] = INST_LDA<ADDR_IMM<DECODED>>;
+    inst_map[Instruction::LDA_ZP] = INST_LDA<ADDR_ZP<DECODED>>;
+    inst_map[Instruction::LDA_ZPX] = INST_LDA<ADDR_ZPX<DECODED>>;
+    inst_map[Instruction::LDA_ABS] = INST_LDA<ADDR_ABS<DECODED>>;
+    inst_map[Instruction::LDA_ABSX] = INST_LDA<ADDR_ABSX<false, DECODED>>;
+    inst_map[Instruction::LDA_ABSY] = INST_LDA<ADDR_ABSY<false, DECODED>>;
+    inst_map[Instruction::LDA_INDX] = INST_LDA<ADDR_INDX<DECODED>>;
+    inst_map[Instruction::LDA_INDY] = INST_LDA<ADDR_INDY<false, DECODED>>;
+
+    inst_map[Instruction::LDX_IMM] = INST_LDX<ADDR_IMM<DECODED>>;
+    inst_map[Instruction::LDX_ZP] = INST_LDX<ADDR_ZP<DECODED>>;
+    inst_map[Instruction::LDX_ZPY] = INST_LDX<ADDR_ZPY<DECODED>>;
+    inst_map[Instruction::LDX_ABS] = INST_LDX<ADDR_ABS<DECODED>>;
+    inst_map[Instruction::LDX_ABSY] = INST_LDX<ADDR_ABSY<false, DECODED>>;
+
+    inst_map[Instruction::LDY_IMM] = INST_LDY<ADDR_IMM<DECODED>>;
+    inst_map[Instruction::LDY_ZP] = INST_LDY<ADDR_ZP<DECODED>>;
+    inst_map[Instruction::LDY_ZPX] = INST_LDY<ADDR_ZPX<DECODED>>;
+    inst_map[Instruction::LDY_ABS] = INST_LDY<ADDR_ABS<DECODED>>;
+    inst_map[Instruction::LDY_ABSX] = INST_LDY<ADDR_ABSX<false, DECODED>>;
+
+    inst_map[Instruction::LSR_ACC] = INST_LSR_ACC;
+    inst_map[Instruction::LSR_ZP] = INST_LSR<ADDR_ZP<DECODED>>;
+    inst_map[Instruction::LSR_ZPX] = INST_LSR<ADDR_ZPX<DECODED>>;
+    inst_map[Instruction::LSR_ABS] = INST_LSR<ADDR_ABS<DECODED>>;
+    inst_map[Instruction::LSR_ABSX] = INST_LSR<ADDR_ABSX<false, DECODED>>;
+
+    inst_map[Instruction::NOP] = INST_NOP;
+
+    inst_map[Instruction::ORA_IMM] = INST_ORA<ADDR_IMM<DECODED>>;
+    inst_map[Instruction::ORA_ZP] = INST_ORA<ADDR_ZP<DECODED>>;
+    inst_map[Instruction::ORA_ZPX] = INST_ORA<ADDR_ZPX<DECODED>>;
+    inst_map[Instruction::ORA_ABS] = INST_ORA<ADDR_ABS<DECODED>>;
+    inst_map[Instruction::ORA_ABSX] = INST_ORA<ADDR_ABSX<false, DECODED>>;
+    inst_map[Instruction::ORA_ABSY] = INST_ORA<ADDR_ABSY<false, DECODED>>;
+    inst_map[Instruction::ORA_INDX] = INST_ORA<ADDR_INDX<DECODED>>;
+    inst_map[Instruction::ORA_INDY] = INST_ORA<ADDR_INDY<false, DECODED>>;
+
+    inst_map[Instruction::PHA] = INST_PUSH<Instruction::PHA>;
+    inst_map[Instruction::PHP] = INST_PUSH<Instruction::PHP>;
+    inst_map[Instruction::PLA] = INST_PULL<Instruction::PLA>;
+    inst_map[Instruction::PLP] = INST_PULL<Instruction::PLP>;
+
+    inst_map[Instruction::ROL_ACC] = INST_ROL_ACC;
+    inst_map[Instruction::ROL_ZP] = INST_ROL<ADDR_ZP<DECODED>>;
+    inst_map[Instruction::ROL_ZPX] = INST_ROL<ADDR_ZPX<DECODED>>;
+    inst_map[Instruction::ROL_ABS] = INST_ROL<ADDR_ABS<DECODED>>;
+    inst_map[Instruction::ROL_ABSX] = INST_ROL<ADDR_ABSX<false, DECODED>>;
+
+    inst_map[Instruction::ROR_ACC] = INST_ROR_ACC;
+    inst_map[Instruction::ROR_ZP] = INST_ROR<ADDR_ZP<DECODED>>;
+    inst_map[Instruction::ROR_ZPX] = INST_ROR<ADDR_ZPX<DECODED>>;
+    inst_map[Instruction::ROR_ABS] = INST_ROR<ADDR_ABS<DECODED>>;
+    inst_map[Instruction::ROR_ABSX] = INST_ROR<ADDR_ABSX<false, DECODED>>;
+
+    inst_map[Instruction::RTI] = INST_RTI;
+    inst_map[Instruction::RTS] = INST_RTS;
+
+    inst_map[Instruction::SBC_IMM] = INST_SBC<ADDR_IMM<DECODED>>;
+    inst_map[Instruction::SBC_ZP] = INST_SBC<ADDR_ZP<DECODED>>;
+    inst_map[Instruction::SBC_ZPX] = INST_SBC<ADDR_ZPX<DECODED>>;
+    inst_map[Instruction::SBC_ABS] = INST_SBC<ADDR_ABS<DECODED>>;
+    inst_map[Instruction::SBC_ABSX] = INST_SBC<ADDR_ABSX<false, DECODED>>;
+    inst_map[Instruction::SBC_ABSY] = INST_SBC<ADDR_ABSY<false, DECODED>>;
+    inst_map[Instruction::SBC_INDX] = INST_SBC<ADDR_INDX<DECODED>>;
+    inst_map[Instruction::SBC_INDY] = INST_SBC<ADDR_INDY<false, DECODED>>;
+
+    inst_map[Instruction::STA_ZP] = INST_STA<ADDR_ZP<DECODED>>;
+    inst_map[Instruction::STA_ZPX] = INST_STA<ADDR_ZPX<DECODED>>;
+    inst_map[Instruction::STA_ABS] = INST_STA<ADDR_ABS<DECODED>>;
+    inst_map[Instruction::STA_ABSX] = INST_STA<ADDR_ABSX<true, DECODED>>;
+    inst_map[Instruction::STA_ABSY] = INST_STA<ADDR_ABSY<true, DECODED>>;
+    inst_map[Instruction::STA_INDX] = INST_STA<ADDR_INDX<DECODED>>;
+    inst_map[Instruction::STA_INDY] = INST_STA<ADDR_INDY<true, DECODED>>;
+
+    inst_map[Instruction::STX_ZP] = INST_STX<ADDR_ZP<DECODED>>;
+    inst_map[Instruction::STX_ZPY] = INST_STX<ADDR_ZPY<DECODED>>;
+    inst_map[Instruction::STX_ABS] = INST_STX<ADDR_ABS<DECODED>>;
+
+    inst_map[Instruction::STY_ZP] = INST_STY<ADDR_ZP<DECODED>>;
+    inst_map[Instruction::STY_ZPX] = INST_STY<ADDR_ZPX<DECODED>>;
+    inst_map[Instruction::STY_ABS] = INST_STY<ADDR_ABS<DECODED>>;
+
+    inst_map[Instruction::TAX] = INST_TRANSFER<Instruction::TAX>;
+    inst_map[Instruction::TAY] = INST_TRANSFER<Instruction::TAY>;
+    inst_map[Instruction::TSX] = INST_TRANSFER<Instruction::TSX>;
+    inst_map[Instruction::TXA] = INST_TRANSFER<Instruction::TXA>;
+    inst_map[Instruction::TXS] = INST_TRANSFER<Instruction::TXS>;
+    inst_map[Instruction::TYA] = INST_TRANSFER<Instruction::TYA>;
+}
+
+/**
+ * @brief Build the dispatch table: every op_code traps unless initialize_map
+ * assigns it a handler. The DECODED table holds the handlers of the
+ * predecoded engine, see make_decode_table.
+ * */
+template <bool DECODED = false> constexpr dispatch_table_t make_isa_table() {
+    dispatch_table_t table{};
+    for (auto& handler : table) {
+        handler = INST_TRAP;
+    }
+    initialize_map<DECODED>(table);
+    return table;
+}
+
+/**
+ * @brief How the predecoded engine runs an op_code: PC advances by length
+ * and the cycles of the fetches are counted before handler runs.
+ * */
+struct DecodeInfo {
+    inst_func_t handler;
+    uint8_t length;
+    uint8_t cycles;
+};
+
+/**
+ * @brief Op_codes whose handler takes an addressing mode get the DECODED
+ * handler, which finds its operand in CPU::GetOperand. The others keep their
+ * handler with a length of 1, as they fetch their own operands (branches,
+ * JSR, BRK) or have none.
+ *
+ * The operand size follows from the op_code layout aaabbbcc: bbb 011 and
+ * 111 are absolute modes, and so is 110 (absolute,Y) when cc is 01. All
+ * other modes that take an operand have one byte. The handler reads the
+ * immediate byte itself, so its fetch isn't part of cycles.
+ * */
+constexpr std::array<DecodeInfo, 256> make_decode_table() {
+    constexpr dispatch_table_t handlers = make_isa_table<false>();
+    constexpr dispatch_table_t decoded = make_isa_table<true>();
+
+    std::array<DecodeInfo, 256> table{};
+    for (int op_code = 0; op_code < 256; op_code++) {
+        if (decoded[op_code] == handlers[op_code]) {
+            table[op_code] = {handlers[op_code], 1, 1};
+            continue;
+        }
+
+        uint8_t mode = (op_code >> 2) & 0x7;
+        uint8_t group = op_code & 0x3;
+        bool absolute =
+            mode == 0x3 || mode == 0x7 || (group == 1 && mode == 0x6);
+        bool immediate = group == 1 ? mode == 0x2 : mode == 0x0;
+        uint8_t length = absolute ? 3 : 2;
+        table[op_code] = {decoded[op_code], length,
+                          uint8_t(immediate ? 1 : length)};
+    }
+    return table;
+}
+
+/**
+ * @brief Whether the instruction after op_code always runs next, i.e.
+ * op_code doesn't branch, jump, return or break.
+ * */
+constexpr bool falls_through(uint8_t op_code) {
+    switch (op_code) {
+    case Instruction::BRK:
+    case Instruction::JSR:
+    case Instruction::RTS:
+    case Instruction::RTI:
+    case Instruction::JMP_ABS:
+    case Instruction::JMP_IND:
+    case Instruction::BCC:
+    case Instruction::BCS:
+    case Instruction::BEQ:
+    case Instruction::BMI:
+    case Instruction::BNE:
+    case Instruction::BPL:
+    case Instruction::BVC:
+    case Instruction::BVS:
+        return false;
+    default:
+        return true;
+    }
+}
@@ -261,5 +261,11 @@ enum Instruction : uint8_t {
     TYA = 0x98,
 };
 
-void initialize_map(std::unordered_map<uint8_t, inst_func_t>&);
+/**
+ * @brief Handler of every op_code, indexed by the op_code itself. Op_codes that
+ * are not part of the instruction set map to INST_TRAP.
+ * */
+extern const dispatch_table_t isa_table;
+
+void INST_TRAP(CPU& cpu, uint8_t op_code);
 std::string ToString(Instruction);
\ No newline at end of file
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <CPU.h>
+#include <Profiler.h>
+#include <instructions.h>
+#include <atomic>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Receives the CPU state before every instruction of CPU::Execute.
+ * */
+class TraceSink {
+  public:
+    virtual ~TraceSink() = default;
+
+    /**
+     * @brief Called with PC on the op_code that is about to run.
+     * */
+    virtual void Trace(CPU& cpu) = 0;
+
+    /**
+     * @brief Called once when Execute returns.
+     * */
+    virtual void Flush() {}
+};
+
+/**
+ * @brief CPU state before one instruction, as stored in binary traces.
+ * */
+struct TraceRecord {
+    uint64_t cycle;
+    uint16_t pc;
+    uint8_t op_code;
+    uint8_t ac;
+    uint8_t x;
+    uint8_t y;
+    uint8_t sp;
+    uint8_t sr; // NV1BDIZC
+};
+
+static_assert(sizeof(TraceRecord) == 16, "TraceRecord is a file format");
+
+/**
+ * @brief A binary trace file is this header followed by TraceRecords in
+ * execution order, both in host byte order.
+ * */
+struct TraceFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+};
+
+// BinaryTraceSink hands records to its writer thread in batches of this size.
+#define TRACE_PUBLISH_MASK 0xFF
+
+#define TRACE_FILE_MAGIC "6502TRC"
+#define TRACE_FILE_VERSION 1
+
+TraceRecord MakeTraceRecord(CPU& cpu);
+
+/**
+ * @brief Write one human readable line per record:
+ * 0x8000: 0xA9 LDA_IMM  [A: 0x0 , X: 0x0 , ...] 0
+ * */
+void FormatTraceRecord(std::ostream& out, const TraceRecord& record);
+
+class TextTraceSink : public TraceSink {
+  public:
+    explicit TextTraceSink(std::ostream& out) : m_out(out) {}
+
+    void Trace(CPU& cpu) override;
+
+    void Flush() override { m_out.flush(); }
+
+  private:
+    std::ostream& m_out;
+};
+
+/**
+ * @brief Appends TraceRecords to a single-producer/single-consumer ring
+ * buffer that a background thread drains to a binary trace file, so the CPU
+ * thread never formats or blocks on I/O unless the ring is full.
+ * */
+class BinaryTraceSink : public TraceSink {
+  public:
+    /**
+     * @brief capacity is the ring size in records, rounded up to a power of
+     * two that is at least one publish batch.
+     * */
+    explicit BinaryTraceSink(const std::string& path,
+                             size_t capacity = 1 << 16);
+
+    ~BinaryTraceSink() override;
+
+    bool IsOpen() { return m_file != nullptr; }
+
+    void Trace(CPU& cpu) override;
+
+    /**
+     * @brief Wait until every record so far is in the file.
+     * */
+    void Flush() override;
+
+  private:
+    void Publish();
+    void Drain();
+
+    std::vector<TraceRecord> m_ring;
+    size_t m_mask;
+    size_t m_local_head; // producer's next slot, published to m_head in batches
+    size_t m_tail_cache; // producer's last view of m_tail
+    alignas(64) std::atomic<size_t> m_head; // next slot the CPU writes
+    alignas(64) std::atomic<size_t> m_tail; // next slot the writer reads
+    std::atomic<bool> m_stop;
+    FILE* m_file;
+    std::thread m_writer;
+};
+
+ALWAYS_INLINE bool CPU::stops_in_front() {
+    // The fetch at a breakpoint is a miss when it is the one continued from.
+    return ((m_memory->GetWatch(PC) & WATCH_EXECUTE) &&
+            m_cycles + 1 != m_resume_cycle) ||
+           (m_halt_on_brk && m_memory->peek(PC) == Instruction::BRK);
+}
+
+ALWAYS_INLINE void CPU::trace_instruction() {
+    if (UNLIKELY(stops_in_front())) {
+        return;
+    }
+    if (--m_instructions_left == 0) {
+        m_next_stop = 0;
+    }
+    if (m_profiler != nullptr) {
+        m_profiler->Record(PC, m_memory->peek(PC), SP, m_cycles);
+    }
+    if (m_trace_sink != nullptr) {
+        m_trace_sink->Trace(*this);
+    }
+}
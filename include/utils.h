@@ -2,11 +2,29 @@
 
 #include <iostream>
 
+#if defined(__GNUC__)
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#define LIKELY(condition) __builtin_expect(!!(condition), 1)
+#define UNLIKELY(condition) __builtin_expect(!!(condition), 0)
+#else
+#define ALWAYS_INLINE inline
+#define LIKELY(condition) (condition)
+#define UNLIKELY(condition) (condition)
+#endif
+
+/**
+ * Read value from memory even if the compiler holds a copy, for state the
+ * Memory slow path may change behind an asm statement that doesn't say so.
+ * */
+template <typename T> ALWAYS_INLINE T load_fresh(const T& value) {
+    return *static_cast<const volatile T*>(&value);
+}
+
 #define GET_BIT(value, bit) (((value) >> (bit)) & 0x1)
 #define SIGN_BIT(value) GET_BIT((value), 7)
 
 #define ASSERT(expr, msg)                                                      \
-    if (!expr) {                                                               \
+    if (!(expr)) {                                                             \
         std::cout << "Assertion Error in " << __FILE__ << ":" << __LINE__      \
                   << " in function " << __func__ << "\n\t" << msg              \
                   << std::endl;                                                \
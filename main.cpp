@@ -1,29 +1,143 @@
 #include <CPU.h>
+#include <Profiler.h>
+#include <RomImage.h>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
-#include <iterator>
+#include <memory>
+#include <trace.h>
+#include <utility>
 #include <vector>
 
 int main(int argc, char** argv) {
-    if (argc != 2) {
-        ASSERT(0, "The emulator expects 1 bin file")
+    bool trace = false;
+    bool dump = false;
+    const char* trace_file = nullptr;
+    const char* profile_file = nullptr;
+    const char* call_graph_file = nullptr;
+    const char* path = nullptr;
+    std::vector<std::pair<uint16_t, uint8_t>> watches;
+    // Like Execute, unless limited further.
+    HaltConditions halt;
+    halt.brk = true;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--trace") == 0) {
+            trace = true;
+        } else if (strcmp(argv[i], "--dump") == 0) {
+            dump = true;
+        } else if (strcmp(argv[i], "--trace-bin") == 0 && i + 1 < argc) {
+            trace_file = argv[++i];
+        } else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            profile_file = argv[++i];
+        } else if (strcmp(argv[i], "--call-graph") == 0 && i + 1 < argc) {
+            call_graph_file = argv[++i];
+        } else if (strcmp(argv[i], "--break") == 0 && i + 1 < argc) {
+            watches.push_back({strtoul(argv[++i], nullptr, 16), WATCH_EXECUTE});
+        } else if (strcmp(argv[i], "--watch") == 0 && i + 1 < argc) {
+            watches.push_back(
+                {strtoul(argv[++i], nullptr, 16), WATCH_READ | WATCH_WRITE});
+        } else if (strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+            halt.cycles = strtoull(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--halt-pc") == 0 && i + 1 < argc) {
+            halt.pc = strtoul(argv[++i], nullptr, 16) & 0xFFFF;
+        } else {
+            path = argv[i];
+        }
+    }
+
+    if (path == nullptr) {
+        ASSERT(0, "The emulator expects 1 bin file "
+                  "[--dump] [--trace] [--trace-bin file] "
+                  "[--profile flame graph file] "
+                  "[--call-graph flame graph file] "
+                  "[--break hex address] [--watch hex address] "
+                  "[--cycles budget] [--halt-pc hex address]")
     }
 
-    std::ifstream input(argv[1], std::ios::binary);
+    RomImage rom(path);
+    ASSERT(rom.IsOpen(), "Couldn't map " << path)
+
+    if (dump) {
+        std::cout << std::hex << std::uppercase;
+        for (size_t i = 0; i < rom.GetSize(); i++) {
+            std::cout << int(rom.GetData()[i]) << " ";
+            if ((i + 1) % 16 == 0)
+                std::cout << "\n";
+        }
+        std::cout << "\n" << std::nouppercase << std::dec;
+    }
 
-    std::vector<unsigned char> buffer(std::istreambuf_iterator<char>(input),
-                                      {});
+    CPU cpu(rom);
+
+    TextTraceSink sink(std::cout);
+    std::unique_ptr<BinaryTraceSink> binary_sink;
+    if (trace_file != nullptr) {
+        binary_sink = std::make_unique<BinaryTraceSink>(trace_file);
+        ASSERT(binary_sink->IsOpen(), "Couldn't open " << trace_file)
+        cpu.SetTraceSink(binary_sink.get());
+    } else if (trace) {
+        cpu.SetTraceSink(&sink);
+    }
+
+    std::unique_ptr<Profiler> profiler;
+    if (profile_file != nullptr || call_graph_file != nullptr) {
+        profiler = std::make_unique<Profiler>();
+        cpu.SetProfiler(profiler.get());
+    }
 
-    std::cout << std::hex << std::uppercase;
-    int i = 0;
-    for (auto b : buffer) {
-        i++;
-        std::cout << int(b) << " ";
-        if (i % 16 == 0)
-            std::cout << "\n";
+    for (auto [address, kinds] : watches) {
+        if (kinds == WATCH_EXECUTE) {
+            cpu.SetBreakpoint(address);
+        } else {
+            cpu.SetWatchpoint(address, kinds);
+        }
     }
-    std::cout << "\n" << std::nouppercase << std::dec;
 
-    CPU cpu(&buffer[0], buffer.size());
-    cpu.Execute();
+    // Every hit is reported with the CPU state, then the run goes on with
+    // what is left of the budget.
+    uint64_t budget = halt.cycles;
+    HaltReason reason = cpu.Run(halt);
+    while (reason == HaltReason::Watch) {
+        const char* kind = cpu.GetWatchKind() == WATCH_EXECUTE ? "Breakpoint"
+                           : cpu.GetWatchKind() == WATCH_READ  ? "Read"
+                                                               : "Write";
+        std::cout << kind << " at 0x" << std::hex << cpu.GetWatchAddress()
+                  << std::dec << ": ";
+        TextTraceSink(std::cout).Trace(cpu);
+        if (budget != UINT64_MAX) {
+            halt.cycles = budget - std::min(budget, cpu.GetCycles());
+        }
+        reason = cpu.Run(halt);
+    }
+
+    if (reason == HaltReason::Trap && cpu.GetTrapOpCode() == 0x00) {
+        std::cout << "Halted on BRK at 0x" << std::hex << int(cpu.PC)
+                  << std::dec << std::endl;
+    } else if (reason == HaltReason::Trap) {
+        std::cout << "Trapped on unknown op_code 0x" << std::hex
+                  << int(cpu.GetTrapOpCode()) << " at 0x" << int(cpu.PC)
+                  << std::dec << std::endl;
+    } else if (reason == HaltReason::PC) {
+        std::cout << "Halted at 0x" << std::hex << int(cpu.PC) << std::dec
+                  << std::endl;
+    }
+
+    std::cout << cpu.GetCycles() << " cycles were concumed." << std::endl;
+
+    if (profile_file != nullptr) {
+        profiler->WriteHotspots(std::cout);
+        profiler->WriteOpCodes(std::cout);
+        std::ofstream flame_graph(profile_file);
+        ASSERT(flame_graph, "Couldn't open " << profile_file)
+        profiler->WriteFlameGraph(flame_graph);
+    }
+
+    if (call_graph_file != nullptr) {
+        profiler->WriteRoutines(std::cout);
+        std::ofstream flame_graph(call_graph_file);
+        ASSERT(flame_graph, "Couldn't open " << call_graph_file)
+        profiler->WriteCallStacks(flame_graph);
+    }
     return 0;
 }
@@ -0,0 +1,301 @@
+#include <BatchRunner.h>
+#include <Checkpoint.h>
+#include <RomImage.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/**
+ * @brief The jobs a worker hasn't claimed, and its CPUs. Aligned so the
+ * slices of different workers never share a cache line.
+ * */
+struct alignas(64) BatchRunner::Worker {
+    // Unclaimed jobs [first, last) as first << 32 | last.
+    std::atomic<uint64_t> slice;
+
+    struct Arena {
+        std::unique_ptr<CPU> cpu;
+        CPU::State boot;
+        std::vector<std::string> checkpoints; // loaded into initial
+        CPU::State initial;
+    };
+    std::map<std::string, Arena> arenas; // by ROM path
+};
+
+static uint64_t make_slice(uint32_t first, uint32_t last) {
+    return uint64_t(first) << 32 | last;
+}
+
+/**
+ * @brief Pin the calling thread to the index-th core it may run on.
+ * */
+static void pin_thread(size_t index) {
+#ifdef __linux__
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        return;
+    }
+    size_t target = index % CPU_COUNT(&allowed);
+    for (int core = 0; core < CPU_SETSIZE; core++) {
+        if (CPU_ISSET(core, &allowed) && target-- == 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(core, &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+            return;
+        }
+    }
+#else
+    (void)index;
+#endif
+}
+
+BatchRunner::BatchRunner(size_t workers, bool pin, Engine engine)
+    : m_pin(pin), m_engine(engine), m_steals(0) {
+    if (workers == 0) {
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < workers; i++) {
+        m_workers.emplace_back(new Worker());
+    }
+}
+
+BatchRunner::~BatchRunner() = default;
+
+std::vector<BatchResult> BatchRunner::Run(const std::vector<BatchJob>& jobs) {
+    ASSERT(jobs.size() < UINT32_MAX, "Too many jobs in one batch")
+
+    // Mapped once and kept, since the workers' CPUs keep using them.
+    for (const BatchJob& job : jobs) {
+        if (m_roms.count(job.rom) == 0) {
+            m_roms[job.rom] = std::make_shared<RomImage>(job.rom);
+        }
+    }
+
+    size_t count = m_workers.size();
+    for (size_t i = 0; i < count; i++) {
+        m_workers[i]->slice.store(make_slice(jobs.size() * i / count,
+                                             jobs.size() * (i + 1) / count));
+    }
+
+    std::vector<BatchResult> results(jobs.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < count; i++) {
+        threads.emplace_back(&BatchRunner::work, this, i, std::cref(jobs),
+                             std::ref(results));
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    return results;
+}
+
+void BatchRunner::work(size_t index, const std::vector<BatchJob>& jobs,
+                       std::vector<BatchResult>& results) {
+    if (m_pin) {
+        pin_thread(index);
+    }
+
+    Worker& worker = *m_workers[index];
+    uint32_t job_index;
+    while (take(index, job_index) || (steal(index) && take(index, job_index))) {
+        const BatchJob& job = jobs[job_index];
+        BatchResult& result = results[job_index];
+        result = {};
+        result.worker = index;
+        auto start = std::chrono::steady_clock::now();
+
+        RomImage& rom = *m_roms.at(job.rom);
+        if (!rom.IsOpen()) {
+            result.status = BatchStatus::Failed;
+            result.error = "Couldn't map " + job.rom;
+        } else if (!rom.Fits(0x8000)) {
+            // Map would end the process from this worker.
+            result.status = BatchStatus::Failed;
+            result.error = job.rom + " doesn't fit above 0x8000";
+        } else {
+            Worker::Arena& arena = worker.arenas[job.rom];
+            if (arena.cpu == nullptr) {
+                arena.cpu = std::make_unique<CPU>(rom, m_engine);
+                arena.boot = arena.cpu->Snapshot();
+                arena.initial = arena.boot;
+            }
+            CPU& cpu = *arena.cpu;
+            if (arena.checkpoints != job.checkpoints) {
+                cpu.Restore(arena.boot);
+                arena.checkpoints.clear();
+                arena.initial = arena.boot;
+                if (!job.checkpoints.empty() &&
+                    LoadCheckpoint(cpu, job.checkpoints)) {
+                    arena.checkpoints = job.checkpoints;
+                    arena.initial = cpu.Snapshot();
+                } else if (!job.checkpoints.empty()) {
+                    result.status = BatchStatus::Failed;
+                    result.error = "Couldn't load the checkpoints of " +
+                                   job.checkpoints[0];
+                }
+            }
+
+            if (result.status != BatchStatus::Failed) {
+                // Only the pages the previous job dirtied are restored.
+                cpu.Restore(arena.initial);
+                cpu.Run(job.cycle_budget);
+                result.status = cpu.IsTrapped() ? BatchStatus::Trapped
+                                                : BatchStatus::Finished;
+                result.cycles = cpu.GetCycles() - arena.initial.cycles;
+                result.PC = cpu.PC;
+                result.AC = cpu.AC;
+                result.X = cpu.X;
+                result.Y = cpu.Y;
+                result.SP = cpu.SP;
+                result.SR = cpu.SR.Value();
+                result.trap_op_code = cpu.GetTrapOpCode();
+            }
+        }
+
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        result.nanoseconds =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+                .count();
+    }
+}
+
+/**
+ * @brief Claim the first unclaimed job of the worker's own slice.
+ * */
+bool BatchRunner::take(size_t index, uint32_t& job) {
+    std::atomic<uint64_t>& slice = m_workers[index]->slice;
+    uint64_t range = slice.load(std::memory_order_relaxed);
+    while (true) {
+        uint32_t first = range >> 32, last = uint32_t(range);
+        if (first >= last) {
+            return false;
+        }
+        if (slice.compare_exchange_weak(range, make_slice(first + 1, last),
+                                        std::memory_order_acq_rel)) {
+            job = first;
+            return true;
+        }
+    }
+}
+
+/**
+ * @brief Move the back half of the first other worker's slice that has
+ * jobs left to the worker's own, empty, slice. Thieves skip empty slices,
+ * and a job index is never unclaimed twice, so the owner's plain store
+ * can't race with a thief's compare and swap.
+ * */
+bool BatchRunner::steal(size_t index) {
+    size_t count = m_workers.size();
+    for (size_t n = 1; n < count; n++) {
+        std::atomic<uint64_t>& victim = m_workers[(index + n) % count]->slice;
+        uint64_t range = victim.load(std::memory_order_relaxed);
+        while (true) {
+            uint32_t first = range >> 32, last = uint32_t(range);
+            if (first >= last) {
+                break;
+            }
+            uint32_t middle = first + (last - first) / 2;
+            if (victim.compare_exchange_weak(range, make_slice(first, middle),
+                                             std::memory_order_acq_rel)) {
+                m_workers[index]->slice.store(make_slice(middle, last));
+                m_steals += last - middle;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief A decimal number taking the whole token.
+ * */
+static bool parse_count(const std::string& token, uint64_t& value) {
+    if (token.empty() || token[0] < '0' || token[0] > '9') {
+        return false;
+    }
+    char* end;
+    errno = 0;
+    value = strtoull(token.c_str(), &end, 10);
+    return *end == '\0' && errno == 0;
+}
+
+bool ParseManifest(std::istream& input, const std::string& directory,
+                   std::vector<BatchJob>& jobs, std::string& error) {
+    auto resolve = [&](const std::string& path) {
+        return path[0] == '/' || directory.empty() ? path
+                                                   : directory + "/" + path;
+    };
+
+    std::string line;
+    for (size_t number = 1; std::getline(input, line); number++) {
+        std::istringstream tokens(line);
+        std::string rom, budget, checkpoint;
+        if (!(tokens >> rom) || rom[0] == '#') {
+            continue;
+        }
+
+        BatchJob job;
+        job.rom = resolve(rom);
+        if (!(tokens >> budget) || !parse_count(budget, job.cycle_budget)) {
+            error = "Line " + std::to_string(number) +
+                    ": expected <rom> <cycle budget> [<checkpoint> ...]";
+            return false;
+        }
+        while (tokens >> checkpoint && checkpoint[0] != '#') {
+            job.checkpoints.push_back(resolve(checkpoint));
+        }
+        jobs.push_back(std::move(job));
+    }
+    return true;
+}
+
+static void write_string(std::ostream& output, const std::string& text) {
+    output << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            output << '\\' << c;
+        } else if (uint8_t(c) < 0x20) {
+            static const char digits[] = "0123456789abcdef";
+            output << "\\u00" << digits[c >> 4] << digits[c & 0xF];
+        } else {
+            output << c;
+        }
+    }
+    output << '"';
+}
+
+void WriteResults(std::ostream& output, const std::vector<BatchJob>& jobs,
+                  const std::vector<BatchResult>& results) {
+    static const char* const statuses[] = {"finished", "trapped", "failed"};
+    for (size_t i = 0; i < results.size(); i++) {
+        const BatchResult& result = results[i];
+        output << "{\"job\":" << i << ",\"rom\":";
+        write_string(output, jobs[i].rom);
+        output << ",\"status\":\"" << statuses[int(result.status)] << '"';
+        if (result.status == BatchStatus::Failed) {
+            output << ",\"error\":";
+            write_string(output, result.error);
+        } else {
+            output << ",\"cycles\":" << result.cycles
+                   << ",\"pc\":" << result.PC << ",\"ac\":" << int(result.AC)
+                   << ",\"x\":" << int(result.X) << ",\"y\":" << int(result.Y)
+                   << ",\"sp\":" << int(result.SP)
+                   << ",\"sr\":" << int(result.SR);
+            if (result.status == BatchStatus::Trapped) {
+                output << ",\"trap_op_code\":" << int(result.trap_op_code);
+            }
+        }
+        output << ",\"worker\":" << result.worker
+               << ",\"ns\":" << result.nanoseconds << "}\n";
+    }
+}
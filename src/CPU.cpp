@@ -1,56 +1,290 @@
 #include <CPU.h>
-#include <assert.h>
+#include <DecodeCache.h>
+#include <JitCache.h>
+#include <Mapper.h>
+#include <RomImage.h>
 #include <instructions.h>
-#include <iomanip>
-#include <iostream>
+#include <trace.h>
 
 /* CPU */
-CPU::CPU(uint8_t* program, uint16_t size)
-    : PC(0), AC(0), X(0), Y(0), SR({0, 0, 0, 0, 0, 0, 0, 0}), SP(0xFF),
-      m_program_size(size), m_cycles(0) {
-    initialize_map(isa_map);
+Engine CPU::s_default_engine = Engine::Table;
+
+CPU::CPU(uint8_t* program, uint16_t size, Engine engine)
+    : CPU(std::make_shared<Memory>(), engine) {
     uint16_t start_address = 0x8000;
-    m_memory.write(start_address, program, m_program_size);
-    m_memory.write(0xFFFC, 0x00);
-    m_memory.write(0xFFFE, 0x80);
-    PC = m_memory.read(0xFFFE);
-    PC = (PC << 8) | m_memory.read(0xFFFC);
+    m_memory->write(start_address, program, size);
+    m_memory->write(0xFFFC, 0x00);
+    m_memory->write(0xFFFD, 0x80);
+    PC = address_from_bytes(m_memory->peek(0xFFFC), m_memory->peek(0xFFFD));
 }
 
-void CPU::dump() {
-    using namespace std;
-    auto op_code = m_memory.read(PC);
+CPU::CPU(RomImage& rom, Engine engine) : CPU(nullptr, 0, engine) {
+    // PC already holds the load address from the reset vector, which the
+    // image may cover once mapped.
+    rom.Map(*m_memory, PC);
+}
 
-    ASSERT(isa_map.count(op_code) > 0,
-           "Couldn't find op_code " << std::hex << int(op_code) << std::dec);
+CPU::CPU(std::shared_ptr<Memory> memory, Engine engine)
+    : PC(0), AC(0), X(0), Y(0), SR(), SP(0xFF),
+      m_memory(std::move(memory)), m_cycles(0), m_cycle_limit(UINT64_MAX),
+      m_next_stop(0), m_trapped(false), m_trap_op_code(0),
+      m_watch_hit(false), m_watching(false), m_watch_address(0),
+      m_watch_kind(WATCH_EXECUTE), m_resume_cycle(UINT64_MAX),
+      m_instructions_left(UINT64_MAX), m_halt_pc(-1), m_halt_pc_owned(false),
+      m_halt_on_brk(false), m_halt_requested(false), m_halt_event(0),
+      m_halt_reason(HaltReason::None), m_nmi_pending(false), m_irq_lines(0),
+      m_engine(engine), m_trace_sink(nullptr), m_profiler(nullptr),
+      m_operand(0) {
+    PC = address_from_bytes(m_memory->peek(0xFFFC), m_memory->peek(0xFFFD));
+}
 
-    cout << left << hex << uppercase;
-    cout << "0x" << setw(4) << int(PC) << ": 0x" << setw(2) << int(op_code);
-    cout << " " << setw(9) << ToString(static_cast<Instruction>(op_code));
+CPU::~CPU() {
+    if (m_halt_pc_owned) {
+        m_memory->ClearWatch(m_halt_pc, WATCH_EXECUTE);
+    }
+    if (m_watching) {
+        m_memory->SetWatchHandler(nullptr);
+    }
+}
 
-    cout << "[A: 0x" << setw(2) << int(AC);
-    cout << ", X: 0x" << setw(2) << int(X);
-    cout << ", Y: 0x" << setw(2) << int(Y);
-    cout << ", SP: 0x" << setw(2) << int(SP);
-    cout << ", SR(NV_BDIZC): 0b" << int(SR.N) << int(SR.V) << 1 << int(SR.B)
-         << int(SR.D) << int(SR.I) << int(SR.Z) << int(SR.C) << "]";
-    cout << nouppercase << dec << internal;
+CPU::CPU(Mapper& cartridge, Engine engine) : CPU(nullptr, 0, engine) {
+    cartridge.Attach(*m_memory);
+    PC = address_from_bytes(m_memory->peek(0xFFFC), m_memory->peek(0xFFFD));
+}
 
-    cout << " " << m_cycles << endl;
+CPU::State CPU::Snapshot() {
+    return {PC,       AC,        X,
+            Y,        SR,        SP,
+            m_cycles, m_trapped, m_trap_op_code,
+            m_memory->Clone()};
 }
 
-void CPU::Execute() {
-    auto first_pc = PC;
-    while (PC >= first_pc && (PC - first_pc) < m_program_size) {
-        dump();
+void CPU::Restore(const State& state) {
+    PC = state.PC;
+    AC = state.AC;
+    X = state.X;
+    Y = state.Y;
+    SR = state.SR;
+    SP = state.SP;
+    m_cycles = state.cycles;
+    m_trapped = state.trapped;
+    m_trap_op_code = state.trap_op_code;
+    m_watch_hit = false;
+    m_halt_reason = HaltReason::None;
+    m_next_stop = 0;
+    m_memory->Restore(*state.memory);
+}
+
+void CPU::watch(uint16_t address, uint8_t kinds) {
+    if (!m_watching) {
+        m_memory->SetWatchHandler([this](uint16_t address, Watch kind) {
+            return on_watch(address, kind);
+        });
+        m_watching = true;
+    }
+    m_memory->SetWatch(address, kinds);
+}
+
+bool CPU::on_watch(uint16_t address, Watch kind) {
+    if (kind == WATCH_EXECUTE && m_cycles == m_resume_cycle) {
+        return false;
+    }
+    if (!m_watch_hit) {
+        m_watch_hit = true;
+        m_watch_address = address;
+        m_watch_kind = kind;
+    }
+    m_next_stop = 0;
+    return true;
+}
+
+void CPU::Interrupt(uint16_t vector, bool brk) {
+    if (m_profiler != nullptr) {
+        m_profiler->Interrupt(PC, SP);
+    }
+    auto [low, high] = bytes_from_address(PC);
+    PUSH(high);
+    PUSH(low);
+    PUSH(brk ? SR.Value() | 0x10 : SR.Value() & ~0x10);
+    SR.I = 1;
+    PC = address_from_bytes(read(vector), read(vector + 1));
+}
 
-        uint8_t op_code = this->Fetch();
-        ASSERT(isa_map.count(op_code) > 0, "Couldn't find op_code "
-                                               << std::hex << int(op_code)
-                                               << std::dec);
+void CPU::Reset() {
+    // The interrupt sequence with its three stack writes turned into reads.
+    m_cycles += 5;
+    SP -= 3;
+    SR.I = 1;
+    PC = address_from_bytes(read(0xFFFC), read(0xFFFD));
+    m_trapped = false;
+    m_nmi_pending = false;
+    m_next_stop = 0;
+}
+
+bool CPU::Service() {
+    if (halting()) {
+        return false;
+    }
 
-        isa_map[op_code](*this, op_code);
+    event_func_t event;
+    while (m_scheduler.PopDue(m_cycles, event)) {
+        event(*this);
     }
 
-    std::cout << m_cycles << " cycles were concumed." << std::endl;
+    // Taking an interrupt costs two internal cycles before the pushes.
+    if (m_nmi_pending) {
+        m_nmi_pending = false;
+        Tick();
+        Tick();
+        Interrupt(0xFFFA, false);
+    } else if (m_irq_lines != 0 && !SR.I) {
+        Tick();
+        Tick();
+        Interrupt(0xFFFE, false);
+    }
+
+    // The pushes of an interrupt may have hit a watchpoint.
+    if (halting() || m_cycles >= m_cycle_limit) {
+        return false;
+    }
+
+    // While IRQ is asserted but masked, SR.I is polled at every boundary.
+    m_next_stop = m_irq_lines != 0 ? 0
+                                   : std::min(m_scheduler.GetNextCycle(),
+                                              m_cycle_limit);
+    return true;
+}
+
+template <bool TRACE> void CPU::ExecuteTable() {
+    while (Running()) {
+        if constexpr (TRACE) {
+            trace_instruction();
+        }
+
+        uint8_t op_code = this->FetchOpCode();
+        isa_table[op_code](*this, op_code);
+    }
+}
+
+void CPU::Dispatch() {
+    bool trace = m_trace_sink != nullptr || m_profiler != nullptr ||
+                 m_instructions_left != UINT64_MAX;
+    if (m_profiler != nullptr) {
+        m_profiler->Begin(m_cycles);
+    }
+
+    switch (m_engine) {
+    case Engine::Table:
+        trace ? ExecuteTable<true>() : ExecuteTable<false>();
+        break;
+    case Engine::Threaded:
+        trace ? ExecuteThreaded<true>() : ExecuteThreaded<false>();
+        break;
+    case Engine::Predecoded:
+        trace ? ExecutePredecoded<true>() : ExecutePredecoded<false>();
+        break;
+    case Engine::Jit:
+        trace ? ExecuteJit<true>() : ExecuteJit<false>();
+        break;
+    }
+
+    if (m_trace_sink != nullptr) {
+        m_trace_sink->Flush();
+    }
+    if (m_profiler != nullptr) {
+        m_profiler->End(m_cycles);
+    }
+}
+
+void CPU::start(const HaltConditions& conditions) {
+    // Continuing from a breakpoint or the sentinel runs the instruction it
+    // stopped at, whose op_code fetch ends the first cycle.
+    bool resume = (m_watch_hit || m_halt_reason == HaltReason::PC) &&
+                  m_watch_kind == WATCH_EXECUTE && m_watch_address == PC;
+    m_resume_cycle = resume ? m_cycles + 1 : UINT64_MAX;
+    m_watch_hit = false;
+    m_halt_reason = HaltReason::None;
+
+    // The sentinel stays set while it doesn't change, so the decode caches
+    // of its page survive repeated runs.
+    if (conditions.pc != m_halt_pc) {
+        if (m_halt_pc_owned) {
+            m_memory->ClearWatch(m_halt_pc, WATCH_EXECUTE);
+        }
+        m_halt_pc = conditions.pc;
+        m_halt_pc_owned = false;
+        if (m_halt_pc >= 0) {
+            m_halt_pc_owned = !(m_memory->GetWatch(m_halt_pc) & WATCH_EXECUTE);
+            watch(m_halt_pc, WATCH_EXECUTE);
+        }
+    }
+
+    m_instructions_left = conditions.instructions;
+    m_halt_on_brk = conditions.brk;
+    m_halt_requested = false;
+    if (conditions.callback != nullptr) {
+        ASSERT(conditions.callback_interval > 0,
+               "A halt callback needs an interval")
+        m_halt_callback = conditions.callback;
+        schedule_halt_callback(m_cycles + conditions.callback_interval,
+                               conditions.callback_interval);
+    }
+
+    m_cycle_limit = conditions.cycles > UINT64_MAX - m_cycles
+                        ? UINT64_MAX
+                        : m_cycles + conditions.cycles;
+    m_next_stop = 0;
+}
+
+void CPU::schedule_halt_callback(uint64_t cycle, uint64_t interval) {
+    m_halt_event = ScheduleEvent(cycle, [this, cycle, interval](CPU&) {
+        if (m_halt_callback(*this)) {
+            schedule_halt_callback(cycle + interval, interval);
+        } else {
+            m_halt_requested = true;
+        }
+    });
+}
+
+HaltReason CPU::finish() {
+    if (m_halt_callback != nullptr) {
+        CancelEvent(m_halt_event);
+        m_halt_callback = nullptr;
+    }
+
+    if (m_watch_hit && m_watch_kind == WATCH_EXECUTE &&
+        m_watch_address == m_halt_pc) {
+        m_watch_hit = false;
+        m_halt_reason = HaltReason::PC;
+    } else if (m_watch_hit) {
+        m_halt_reason = HaltReason::Watch;
+    } else if (m_trapped) {
+        m_halt_reason = HaltReason::Trap;
+    } else if (m_halt_requested) {
+        m_halt_reason = HaltReason::Callback;
+    } else if (m_instructions_left == 0) {
+        m_halt_reason = HaltReason::Instructions;
+    } else {
+        m_halt_reason = HaltReason::Cycles;
+    }
+    return m_halt_reason;
+}
+
+HaltReason CPU::Run(const HaltConditions& conditions) {
+    start(conditions);
+    Dispatch();
+    return finish();
+}
+
+void CPU::Execute() {
+    HaltConditions conditions;
+    conditions.brk = true;
+    Run(conditions);
+}
+
+uint64_t CPU::Run(uint64_t cycle_budget) {
+    HaltConditions conditions;
+    conditions.cycles = cycle_budget;
+    Run(conditions);
+    return m_cycles > m_cycle_limit ? m_cycles - m_cycle_limit : 0;
 }
@@ -0,0 +1,185 @@
+#include <Checkpoint.h>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <random>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* CheckpointWriter */
+CheckpointWriter::CheckpointWriter() { Reset(); }
+
+void CheckpointWriter::Reset() {
+    m_chain = std::random_device()();
+    m_chain = m_chain << 32 | std::random_device()();
+    m_sequence = 0;
+    m_previous = {};
+}
+
+bool CheckpointWriter::Write(CPU& cpu, const std::string& path) {
+    CPU::State state = cpu.Snapshot();
+    const Memory& memory = *state.memory;
+    bool full = m_previous.memory == nullptr;
+
+    CheckpointHeader header = {};
+    memcpy(header.magic, CHECKPOINT_FILE_MAGIC, sizeof(CHECKPOINT_FILE_MAGIC));
+    header.version = CHECKPOINT_FILE_VERSION;
+    header.data_offset = CHECKPOINT_DATA_OFFSET;
+    header.chain = m_chain;
+    header.sequence = m_sequence;
+    header.cycles = state.cycles;
+    header.pc = state.PC;
+    header.ac = state.AC;
+    header.x = state.X;
+    header.y = state.Y;
+    header.sp = state.SP;
+    header.sr = state.SR.Value();
+    header.trapped = state.trapped;
+    header.trap_op_code = state.trap_op_code;
+
+    std::vector<const uint8_t*> pages;
+    for (int page = 0; page < MEM_PAGE_COUNT; page++) {
+        const uint8_t* data = memory.GetPageData(page);
+        header.slots[page] = CHECKPOINT_NO_SLOT;
+        if (data == nullptr) {
+            header.kinds[page] = CHECKPOINT_KIND_SKIPPED;
+            continue;
+        }
+
+        header.kinds[page] = static_cast<uint8_t>(memory.GetPageKind(page));
+        bool unchanged = full ? memory.IsZeroPage(page)
+                              : memory.SamePage(*m_previous.memory, page);
+        if (!unchanged) {
+            header.slots[page] = pages.size();
+            pages.push_back(data);
+        }
+    }
+    header.page_count = pages.size();
+
+    std::string temporary = path + ".tmp";
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    static const uint8_t padding[CHECKPOINT_DATA_OFFSET] = {0};
+    bool written =
+        fwrite(&header, sizeof(header), 1, file) == 1 &&
+        fwrite(padding, CHECKPOINT_DATA_OFFSET - sizeof(header), 1, file) == 1;
+    for (auto data : pages) {
+        written = written && fwrite(data, MEM_PAGE_SIZE, 1, file) == 1;
+    }
+    written = fflush(file) == 0 && written && fsync(fileno(file)) == 0;
+    fclose(file);
+
+    if (!written || rename(temporary.c_str(), path.c_str()) != 0) {
+        remove(temporary.c_str());
+        return false;
+    }
+
+    m_previous = std::move(state);
+    m_sequence++;
+    return true;
+}
+
+/* LoadCheckpoint */
+static std::shared_ptr<const void> map_file(const std::string& path,
+                                            size_t& size) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    std::shared_ptr<const void> mapping;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size >= CHECKPOINT_DATA_OFFSET) {
+        size = info.st_size;
+        void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            mapping.reset(data, [size](const void* data) {
+                munmap(const_cast<void*>(data), size);
+            });
+        }
+    }
+
+    close(fd);
+    return mapping;
+}
+
+static bool valid_header(const CheckpointHeader& header, size_t size) {
+    return memcmp(header.magic, CHECKPOINT_FILE_MAGIC,
+                  sizeof(CHECKPOINT_FILE_MAGIC)) == 0 &&
+           header.version == CHECKPOINT_FILE_VERSION &&
+           header.data_offset == CHECKPOINT_DATA_OFFSET &&
+           header.page_count <= MEM_PAGE_COUNT &&
+           size >= header.data_offset +
+                       (size_t)header.page_count * MEM_PAGE_SIZE;
+}
+
+bool LoadCheckpoint(CPU& cpu, const std::vector<std::string>& chain) {
+    if (chain.empty()) {
+        return false;
+    }
+
+    auto memory = cpu.GetMemory().Clone();
+    const CheckpointHeader* header = nullptr;
+    std::shared_ptr<const void> last_mapping;
+    uint64_t chain_id = 0;
+
+    for (uint32_t sequence = 0; sequence < chain.size(); sequence++) {
+        size_t size = 0;
+        auto mapping = map_file(chain[sequence], size);
+        if (mapping == nullptr) {
+            return false;
+        }
+
+        auto base = static_cast<const uint8_t*>(mapping.get());
+        header = reinterpret_cast<const CheckpointHeader*>(base);
+        if (!valid_header(*header, size) || header->sequence != sequence ||
+            (sequence > 0 && header->chain != chain_id)) {
+            return false;
+        }
+        chain_id = header->chain;
+
+        for (int page = 0; page < MEM_PAGE_COUNT; page++) {
+            uint8_t kind = header->kinds[page];
+            uint16_t slot = header->slots[page];
+            if (kind == CHECKPOINT_KIND_SKIPPED) {
+                continue;
+            }
+            if (kind != (uint8_t)PageKind::RAM &&
+                kind != (uint8_t)PageKind::ROM) {
+                return false;
+            }
+
+            if (slot != CHECKPOINT_NO_SLOT) {
+                if (slot >= header->page_count) {
+                    return false;
+                }
+                memory->MapCopyOnWrite(
+                    page, (PageKind)kind,
+                    base + header->data_offset + slot * MEM_PAGE_SIZE,
+                    mapping);
+            } else if (sequence == 0) {
+                memory->MapCopyOnWrite(page, (PageKind)kind, nullptr,
+                                       nullptr);
+            } else if (kind == (uint8_t)PageKind::RAM) {
+                memory->MapRAM(page, 1);
+            } else {
+                memory->MapROM(page, 1);
+            }
+        }
+        last_mapping = mapping;
+    }
+
+    CPU::StatusRegister sr;
+    sr.Set(header->sr);
+    CPU::State state = {header->pc,      header->ac,
+                        header->x,       header->y,
+                        sr,              header->sp,
+                        header->cycles,  header->trapped != 0,
+                        header->trap_op_code, memory};
+    cpu.Restore(state);
+    return true;
+}
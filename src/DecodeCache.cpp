@@ -0,0 +1,209 @@
+#include <DecodeCache.h>
+#include <dispatch.h>
+#include <fusion_profile.h>
+#include <handlers.h>
+#include <trace.h>
+
+static constexpr std::array<DecodeInfo, 256> decode_table = make_decode_table();
+
+struct FusedPair {
+    uint8_t first;
+    uint8_t second;
+};
+
+#define FUSED_PAIR(first, second) {Instruction::first, Instruction::second},
+
+static constexpr FusedPair fused_pairs[] = {FUSION_PROFILE(FUSED_PAIR)};
+
+#undef FUSED_PAIR
+
+static int find_fused_pair(uint8_t first, uint8_t second) {
+    for (size_t i = 0; i < sizeof(fused_pairs) / sizeof(fused_pairs[0]); i++) {
+        if (fused_pairs[i].first == first && fused_pairs[i].second == second) {
+            return int(i);
+        }
+    }
+    return -1;
+}
+
+const DecodedInstruction& DecodeCache::decode(Memory& memory, uint16_t pc) {
+    uint8_t page = PAGE_OF(pc);
+    auto& entries = m_pages[page];
+    if (entries == nullptr) {
+        entries.reset(new DecodedInstruction[MEM_PAGE_SIZE]());
+    }
+
+    // Marked before the version is read, so any later write invalidates.
+    memory.MarkCode(page);
+    DecodedInstruction& entry = entries[PAGE_OFFSET(pc)];
+    entry.version = memory.GetCodeVersion(page);
+
+    if (memory.GetPageKind(page) == PageKind::DEVICE) {
+        entry = {entry.version, 0, DECODE_LABEL_FETCH};
+        return entry;
+    }
+
+    uint8_t op_code = memory.peek(pc);
+    uint8_t length = decode_table[op_code].length;
+    if (PAGE_OFFSET(pc) + length > MEM_PAGE_SIZE) {
+        entry = {entry.version, 0, DECODE_LABEL_FETCH};
+        return entry;
+    }
+
+    if (memory.WatchesInstruction(pc, length)) {
+        entry = {entry.version, 0, DECODE_LABEL_FETCH};
+        return entry;
+    }
+
+    uint16_t operand = length > 1 ? memory.peek(pc + 1) : 0;
+    if (length == 3) {
+        operand = address_from_bytes(operand, memory.peek(pc + 2));
+    }
+    entry = {entry.version, operand, op_code};
+
+    // The second instruction of a pair is decoded along, as the fused label
+    // runs it from the entry behind this one.
+    if (PAGE_OFFSET(pc) + length < MEM_PAGE_SIZE) {
+        int pair = find_fused_pair(op_code, memory.peek(pc + length));
+        if (pair >= 0 &&
+            decode(memory, pc + length).label != DECODE_LABEL_FETCH) {
+            entry.label = DECODE_LABEL_FUSED + pair;
+        }
+    }
+    return entry;
+}
+
+#if defined(__GNUC__)
+
+/**
+ * Predecoded interpreter: threaded like threaded.cpp, but dispatching on the
+ * decoded instruction at PC. The length and fetch cycles of every label are
+ * constants, so running an instruction costs a cache lookup instead of the
+ * op_code and operand fetches.
+ *
+ * A fused label runs both instructions of a FUSION_PROFILE pair with one
+ * dispatch. Events and the stop conditions are still checked between the
+ * two, and the second instruction is only run from the cache when neither
+ * the first instruction nor an event moved PC or wrote the page.
+ * */
+
+#define DISPATCH()                                                             \
+    if (!Running()) {                                                          \
+        return;                                                                \
+    }                                                                          \
+    if constexpr (TRACE) {                                                     \
+        trace_instruction();                                                   \
+    }                                                                          \
+    instruction = &cache.Lookup(*m_memory, PC);                                \
+    goto* labels[instruction->label]
+
+#define RUN(op)                                                                \
+    {                                                                          \
+        constexpr DecodeInfo info = decode_table[op];                          \
+        PC += info.length;                                                     \
+        m_cycles += info.cycles;                                               \
+        m_operand = instruction->operand;                                      \
+        info.handler(*this, op);                                               \
+    }
+
+#define HANDLER(op)                                                            \
+    op_##op : RUN(op)                                                          \
+    DISPATCH();
+
+#define FUSED_ADDRESS(first, second) &&fused_##first##_##second,
+
+#define FUSED(first, second)                                                   \
+    fused_##first##_##second : {                                               \
+        static_assert(falls_through(Instruction::first),                       \
+                      "A fused pair must run its second instruction");         \
+        RUN(Instruction::first)                                                \
+        fused_pc = PC;                                                         \
+        if (!Running()) {                                                      \
+            return;                                                            \
+        }                                                                      \
+        if constexpr (TRACE) {                                                 \
+            trace_instruction();                                               \
+        }                                                                      \
+        if (UNLIKELY(PC != fused_pc ||                                         \
+                     instruction->version !=                                   \
+                         m_memory->GetCodeVersion(PAGE_OF(PC)))) {             \
+            goto lookup;                                                       \
+        }                                                                      \
+        instruction += decode_table[Instruction::first].length;                \
+        RUN(Instruction::second)                                               \
+    }                                                                          \
+    DISPATCH();
+
+template <bool TRACE> void CPU::ExecutePredecoded() {
+    static const void* const labels[] = {
+        OP_ALL(LABEL_ADDRESS) &&fetch, FUSION_PROFILE(FUSED_ADDRESS)};
+    static_assert(sizeof(labels) / sizeof(labels[0]) ==
+                      DECODE_LABEL_FUSED +
+                          sizeof(fused_pairs) / sizeof(fused_pairs[0]),
+                  "A label for every op_code, fetch and fused pair");
+
+    if (m_decode_cache == nullptr) {
+        m_decode_cache.reset(new DecodeCache());
+    }
+    DecodeCache& cache = *m_decode_cache;
+    const DecodedInstruction* instruction;
+    uint16_t fused_pc;
+
+    DISPATCH();
+    OP_ALL(HANDLER)
+    FUSION_PROFILE(FUSED)
+
+fetch : {
+    uint8_t op_code = FetchOpCode();
+    isa_table[op_code](*this, op_code);
+}
+    DISPATCH();
+
+lookup:
+    instruction = &cache.Lookup(*m_memory, PC);
+    goto* labels[instruction->label];
+}
+
+#undef FUSED
+#undef FUSED_ADDRESS
+#undef HANDLER
+#undef RUN
+#undef DISPATCH
+
+#else
+
+template <bool TRACE> void CPU::ExecutePredecoded() {
+    if (m_decode_cache == nullptr) {
+        m_decode_cache.reset(new DecodeCache());
+    }
+
+    while (Running()) {
+        if constexpr (TRACE) {
+            trace_instruction();
+        }
+
+        const DecodedInstruction& instruction =
+            m_decode_cache->Lookup(*m_memory, PC);
+        if (instruction.label == DECODE_LABEL_FETCH) {
+            uint8_t op_code = FetchOpCode();
+            isa_table[op_code](*this, op_code);
+            continue;
+        }
+
+        // Fused pairs run one instruction at a time here.
+        uint8_t op_code =
+            instruction.label < DECODE_LABEL_FETCH
+                ? instruction.label
+                : fused_pairs[instruction.label - DECODE_LABEL_FUSED].first;
+        const DecodeInfo& info = decode_table[op_code];
+        PC += info.length;
+        m_cycles += info.cycles;
+        m_operand = instruction.operand;
+        info.handler(*this, op_code);
+    }
+}
+
+#endif
+
+template void CPU::ExecutePredecoded<true>();
+template void CPU::ExecutePredecoded<false>();
@@ -0,0 +1,1066 @@
+#include <JitCache.h>
+#include <instructions.h>
+
+#if JIT_AVAILABLE
+
+#include <cstddef>
+#include <sys/mman.h>
+#include <vector>
+
+/**
+ * What the compiler knows of an op_code: the operation and its addressing
+ * mode. Op_codes left at NONE end a block and are interpreted.
+ * */
+enum class JitOp : uint8_t {
+    NONE, LDA, LDX, LDY, STA, STX, STY, ADC, SBC, AND, ORA, EOR, CMP, CPX, CPY,
+    BIT, INC, DEC, ASL, LSR, ROL, ROR, INX, INY, DEX, DEY, TAX, TAY, TXA, CLC,
+    SEC, CLD, SED, CLI, SEI, CLV, NOP, BCC, BCS, BEQ, BNE, BMI, BPL, BVC, BVS,
+    JMP,
+};
+
+enum class JitMode : uint8_t {
+    IMPLIED, ACC, IMM, ZP, ZPX, ZPY, ABS, ABSX, ABSY, INDX, INDY, REL,
+};
+
+struct JitInfo {
+    JitOp op;
+    JitMode mode;
+};
+
+/**
+ * @brief The op_codes the compiler translates. The ones whose interpreter
+ * handler is known to be wrong (TYA, TSX, TXS) are left out, since compiled
+ * code must match the interpreter exactly, and so are JSR and RTS, and
+ * read-modify-write instructions on absolute,X, which disagree on the
+ * forced cycle.
+ * */
+static constexpr std::array<JitInfo, 256> make_jit_table() {
+    std::array<JitInfo, 256> table{};
+    using I = Instruction;
+    using M = JitMode;
+
+    auto alu = [&](JitOp op, I imm, I zp, I zpx, I abs, I absx, I absy,
+                   I indx, I indy) {
+        table[imm] = {op, M::IMM};
+        table[zp] = {op, M::ZP};
+        table[zpx] = {op, M::ZPX};
+        table[abs] = {op, M::ABS};
+        table[absx] = {op, M::ABSX};
+        table[absy] = {op, M::ABSY};
+        table[indx] = {op, M::INDX};
+        table[indy] = {op, M::INDY};
+    };
+    alu(JitOp::ADC, I::ADC_IMM, I::ADC_ZP, I::ADC_ZPX, I::ADC_ABS, I::ADC_ABSX,
+        I::ADC_ABSY, I::ADC_INDX, I::ADC_INDY);
+    alu(JitOp::AND, I::AND_IMM, I::AND_ZP, I::AND_ZPX, I::AND_ABS, I::AND_ABSX,
+        I::AND_ABSY, I::AND_INDX, I::AND_INDY);
+    alu(JitOp::CMP, I::CMP_IMM, I::CMP_ZP, I::CMP_ZPX, I::CMP_ABS, I::CMP_ABSX,
+        I::CMP_ABSY, I::CMP_INDX, I::CMP_INDY);
+    alu(JitOp::EOR, I::EOR_IMM, I::EOR_ZP, I::EOR_ZPX, I::EOR_ABS, I::EOR_ABSX,
+        I::EOR_ABSY, I::EOR_INDX, I::EOR_INDY);
+    alu(JitOp::LDA, I::LDA_IMM, I::LDA_ZP, I::LDA_ZPX, I::LDA_ABS, I::LDA_ABSX,
+        I::LDA_ABSY, I::LDA_INDX, I::LDA_INDY);
+    alu(JitOp::ORA, I::ORA_IMM, I::ORA_ZP, I::ORA_ZPX, I::ORA_ABS, I::ORA_ABSX,
+        I::ORA_ABSY, I::ORA_INDX, I::ORA_INDY);
+    alu(JitOp::SBC, I::SBC_IMM, I::SBC_ZP, I::SBC_ZPX, I::SBC_ABS, I::SBC_ABSX,
+        I::SBC_ABSY, I::SBC_INDX, I::SBC_INDY);
+
+    table[I::STA_ZP] = {JitOp::STA, M::ZP};
+    table[I::STA_ZPX] = {JitOp::STA, M::ZPX};
+    table[I::STA_ABS] = {JitOp::STA, M::ABS};
+    table[I::STA_ABSX] = {JitOp::STA, M::ABSX};
+    table[I::STA_ABSY] = {JitOp::STA, M::ABSY};
+    table[I::STA_INDX] = {JitOp::STA, M::INDX};
+    table[I::STA_INDY] = {JitOp::STA, M::INDY};
+
+    table[I::LDX_IMM] = {JitOp::LDX, M::IMM};
+    table[I::LDX_ZP] = {JitOp::LDX, M::ZP};
+    table[I::LDX_ZPY] = {JitOp::LDX, M::ZPY};
+    table[I::LDX_ABS] = {JitOp::LDX, M::ABS};
+    table[I::LDX_ABSY] = {JitOp::LDX, M::ABSY};
+    table[I::LDY_IMM] = {JitOp::LDY, M::IMM};
+    table[I::LDY_ZP] = {JitOp::LDY, M::ZP};
+    table[I::LDY_ZPX] = {JitOp::LDY, M::ZPX};
+    table[I::LDY_ABS] = {JitOp::LDY, M::ABS};
+    table[I::LDY_ABSX] = {JitOp::LDY, M::ABSX};
+    table[I::STX_ZP] = {JitOp::STX, M::ZP};
+    table[I::STX_ZPY] = {JitOp::STX, M::ZPY};
+    table[I::STX_ABS] = {JitOp::STX, M::ABS};
+    table[I::STY_ZP] = {JitOp::STY, M::ZP};
+    table[I::STY_ZPX] = {JitOp::STY, M::ZPX};
+    table[I::STY_ABS] = {JitOp::STY, M::ABS};
+
+    table[I::CMX_IMM] = {JitOp::CPX, M::IMM};
+    table[I::CMX_ZP] = {JitOp::CPX, M::ZP};
+    table[I::CMX_ABS] = {JitOp::CPX, M::ABS};
+    table[I::CMY_IMM] = {JitOp::CPY, M::IMM};
+    table[I::CMY_ZP] = {JitOp::CPY, M::ZP};
+    table[I::CMY_ABS] = {JitOp::CPY, M::ABS};
+    table[I::BIT_ZP] = {JitOp::BIT, M::ZP};
+    table[I::BIT_ABS] = {JitOp::BIT, M::ABS};
+
+    auto rmw = [&](JitOp op, I zp, I zpx, I abs) {
+        table[zp] = {op, M::ZP};
+        table[zpx] = {op, M::ZPX};
+        table[abs] = {op, M::ABS};
+    };
+    rmw(JitOp::ASL, I::ASL_ZP, I::ASL_ZPX, I::ASL_ABS);
+    rmw(JitOp::LSR, I::LSR_ZP, I::LSR_ZPX, I::LSR_ABS);
+    rmw(JitOp::ROL, I::ROL_ZP, I::ROL_ZPX, I::ROL_ABS);
+    rmw(JitOp::ROR, I::ROR_ZP, I::ROR_ZPX, I::ROR_ABS);
+    rmw(JitOp::INC, I::INC_ZP, I::INC_ZPX, I::INC_ABS);
+    rmw(JitOp::DEC, I::DEC_ZP, I::DEC_ZPX, I::DEC_ABS);
+    table[I::ASL_ACC] = {JitOp::ASL, M::ACC};
+    table[I::LSR_ACC] = {JitOp::LSR, M::ACC};
+    table[I::ROL_ACC] = {JitOp::ROL, M::ACC};
+    table[I::ROR_ACC] = {JitOp::ROR, M::ACC};
+
+    table[I::INX] = {JitOp::INX, M::IMPLIED};
+    table[I::INY] = {JitOp::INY, M::IMPLIED};
+    table[I::DEX] = {JitOp::DEX, M::IMPLIED};
+    table[I::DEY] = {JitOp::DEY, M::IMPLIED};
+    table[I::TAX] = {JitOp::TAX, M::IMPLIED};
+    table[I::TAY] = {JitOp::TAY, M::IMPLIED};
+    table[I::TXA] = {JitOp::TXA, M::IMPLIED};
+    table[I::CLC] = {JitOp::CLC, M::IMPLIED};
+    table[I::SEC] = {JitOp::SEC, M::IMPLIED};
+    table[I::CLD] = {JitOp::CLD, M::IMPLIED};
+    table[I::SED] = {JitOp::SED, M::IMPLIED};
+    table[I::CLI] = {JitOp::CLI, M::IMPLIED};
+    table[I::SEI] = {JitOp::SEI, M::IMPLIED};
+    table[I::CLV] = {JitOp::CLV, M::IMPLIED};
+    table[I::NOP] = {JitOp::NOP, M::IMPLIED};
+
+    table[I::BCC] = {JitOp::BCC, M::REL};
+    table[I::BCS] = {JitOp::BCS, M::REL};
+    table[I::BEQ] = {JitOp::BEQ, M::REL};
+    table[I::BNE] = {JitOp::BNE, M::REL};
+    table[I::BMI] = {JitOp::BMI, M::REL};
+    table[I::BPL] = {JitOp::BPL, M::REL};
+    table[I::BVC] = {JitOp::BVC, M::REL};
+    table[I::BVS] = {JitOp::BVS, M::REL};
+    table[I::JMP_ABS] = {JitOp::JMP, M::ABS};
+    return table;
+}
+
+static constexpr std::array<JitInfo, 256> jit_table = make_jit_table();
+
+static uint8_t length_of(JitMode mode) {
+    switch (mode) {
+    case JitMode::IMPLIED:
+    case JitMode::ACC:
+        return 1;
+    case JitMode::ABS:
+    case JitMode::ABSX:
+    case JitMode::ABSY:
+        return 3;
+    default:
+        return 2;
+    }
+}
+
+/**
+ * @brief Cycles the interpreter counts for the reads of an addressing mode,
+ * op_code fetch included, without the page crossing cycle.
+ * */
+static uint8_t read_cycles(JitMode mode) {
+    switch (mode) {
+    case JitMode::IMM:
+        return 2;
+    case JitMode::ZP:
+        return 3;
+    case JitMode::INDX:
+        return 6;
+    case JitMode::INDY:
+        return 5;
+    default:
+        return 4;
+    }
+}
+
+/* Assembler */
+enum Reg : uint8_t {
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15,
+    NO_INDEX = 0xFF,
+};
+
+enum Cond : uint8_t { ABOVE_EQUAL = 0x3, ZERO = 0x4, NOT_ZERO = 0x5 };
+
+// Opcodes of the "op r/m32, r32" forms and the /digit of "op r/m32, imm32".
+enum Alu : uint8_t {
+    ADD = 0x01, OR = 0x09, AND = 0x21, SUB = 0x29, XOR = 0x31, CMP = 0x39,
+    MOV = 0x89,
+};
+
+static uint8_t alu_digit(Alu op) { return op == MOV ? 0 : op >> 3; }
+
+/**
+ * @brief Just the x86-64 instructions the compiler needs, all with 32 bit
+ * operands unless named otherwise. Memory operands are [base + index * 2^scale
+ * + disp32].
+ * */
+class Assembler {
+  public:
+    size_t Position() { return m_code.size(); }
+
+    const std::vector<uint8_t>& GetCode() { return m_code; }
+
+    void Byte(uint8_t value) { m_code.push_back(value); }
+
+    void Dword(uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            Byte(value >> (i * 8));
+        }
+    }
+
+    void Rex(bool wide, uint8_t reg, uint8_t index, uint8_t base,
+             bool byte_reg = false) {
+        uint8_t rex = 0x40 | wide << 3 | (reg >> 3 & 1) << 2 |
+                      (index != NO_INDEX ? (index >> 3 & 1) << 1 : 0) |
+                      (base >> 3 & 1);
+        // SPL to DIL need a REX prefix to be addressed as bytes.
+        if (rex != 0x40 || (byte_reg && reg >= RSP && reg <= RDI)) {
+            Byte(rex);
+        }
+    }
+
+    void Operand(uint8_t reg, uint8_t base, uint8_t index, uint8_t scale,
+                int32_t disp) {
+        if (index == NO_INDEX && (base & 7) != RSP) {
+            Byte(0x80 | (reg & 7) << 3 | (base & 7));
+        } else {
+            uint8_t sib_index = index == NO_INDEX ? RSP : index & 7;
+            Byte(0x84 | (reg & 7) << 3);
+            Byte(scale << 6 | sib_index << 3 | (base & 7));
+        }
+        Dword(disp);
+    }
+
+    void AluRR(Alu op, Reg dst, Reg src, bool wide = false) {
+        Rex(wide, src, NO_INDEX, dst);
+        Byte(op);
+        Byte(0xC0 | (src & 7) << 3 | (dst & 7));
+    }
+
+    void AluRI(Alu op, Reg dst, int32_t imm, bool wide = false) {
+        if (op == MOV && !wide) {
+            Rex(false, 0, NO_INDEX, dst);
+            Byte(0xB8 | (dst & 7));
+        } else {
+            Rex(wide, 0, NO_INDEX, dst);
+            Byte(op == MOV ? 0xC7 : 0x81);
+            Byte(0xC0 | alu_digit(op) << 3 | (dst & 7));
+        }
+        Dword(imm);
+    }
+
+    void Shl(Reg dst, uint8_t count) { Shift(4, dst, count); }
+
+    void Shr(Reg dst, uint8_t count) { Shift(5, dst, count); }
+
+    void Test(Reg dst, int32_t imm) {
+        Rex(false, 0, NO_INDEX, dst);
+        Byte(0xF7);
+        Byte(0xC0 | (dst & 7));
+        Dword(imm);
+    }
+
+    void TestQ(Reg dst, Reg src) {
+        Rex(true, src, NO_INDEX, dst);
+        Byte(0x85);
+        Byte(0xC0 | (src & 7) << 3 | (dst & 7));
+    }
+
+    // dst = zero extended low byte of src
+    void MovzxRR8(Reg dst, Reg src) {
+        Rex(false, dst, NO_INDEX, src, true);
+        Byte(0x0F);
+        Byte(0xB6);
+        Byte(0xC0 | (dst & 7) << 3 | (src & 7));
+    }
+
+    void MovzxLoad8(Reg dst, Reg base, uint8_t index, int32_t disp) {
+        Rex(false, dst, index, base);
+        Byte(0x0F);
+        Byte(0xB6);
+        Operand(dst, base, index, 0, disp);
+    }
+
+    void MovzxLoad16(Reg dst, Reg base, int32_t disp) {
+        Rex(false, dst, NO_INDEX, base);
+        Byte(0x0F);
+        Byte(0xB7);
+        Operand(dst, base, NO_INDEX, 0, disp);
+    }
+
+    void Store8(Reg base, uint8_t index, int32_t disp, Reg src) {
+        Rex(false, src, index, base, true);
+        Byte(0x88);
+        Operand(src, base, index, 0, disp);
+    }
+
+    void Store16(Reg base, int32_t disp, Reg src) {
+        Byte(0x66);
+        Rex(false, src, NO_INDEX, base);
+        Byte(0x89);
+        Operand(src, base, NO_INDEX, 0, disp);
+    }
+
+    void Load64(Reg dst, Reg base, uint8_t index, uint8_t scale,
+                int32_t disp) {
+        Rex(true, dst, index, base);
+        Byte(0x8B);
+        Operand(dst, base, index, scale, disp);
+    }
+
+    void Store64(Reg base, int32_t disp, Reg src) {
+        Rex(true, src, NO_INDEX, base);
+        Byte(0x89);
+        Operand(src, base, NO_INDEX, 0, disp);
+    }
+
+    void Cmp64(Reg dst, Reg base, int32_t disp) {
+        Rex(true, dst, NO_INDEX, base);
+        Byte(0x3B);
+        Operand(dst, base, NO_INDEX, 0, disp);
+    }
+
+    void Lea64(Reg dst, Reg base, int32_t disp) {
+        Rex(true, dst, NO_INDEX, base);
+        Byte(0x8D);
+        Operand(dst, base, NO_INDEX, 0, disp);
+    }
+
+    void Push(Reg reg) {
+        Rex(false, 0, NO_INDEX, reg);
+        Byte(0x50 | (reg & 7));
+    }
+
+    void Pop(Reg reg) {
+        Rex(false, 0, NO_INDEX, reg);
+        Byte(0x58 | (reg & 7));
+    }
+
+    void Ret() { Byte(0xC3); }
+
+    /**
+     * @brief Jumps return the position of their displacement for Bind.
+     * */
+    size_t Jcc(Cond cond) {
+        Byte(0x0F);
+        Byte(0x80 | cond);
+        Dword(0);
+        return Position() - 4;
+    }
+
+    size_t Jmp() {
+        Byte(0xE9);
+        Dword(0);
+        return Position() - 4;
+    }
+
+    void Bind(size_t jump, size_t target) {
+        int32_t rel = int32_t(target - (jump + 4));
+        for (int i = 0; i < 4; i++) {
+            m_code[jump + i] = uint32_t(rel) >> (i * 8);
+        }
+    }
+
+  private:
+    std::vector<uint8_t> m_code;
+
+    void Shift(uint8_t digit, Reg dst, uint8_t count) {
+        Rex(false, 0, NO_INDEX, dst);
+        Byte(0xC1);
+        Byte(0xC0 | digit << 3 | (dst & 7));
+        Byte(count);
+    }
+};
+
+/* Compiler */
+
+// Guest registers while a block runs, all callee-saved but CTX.
+static constexpr Reg CTX = RDI, READ = RSI, WRITE = RDX, AC = R12, XR = R13,
+                     YR = R14, NZ = R15, BITS = RBX, CYCLES = RBP;
+// Scratch. RCX holds the page of the access and RAX its offset.
+static constexpr Reg PAGE = RCX, OFFSET = RAX, VALUE = R8, TEMP = R9;
+
+static constexpr Reg saved_registers[] = {RBX, RBP, R12, R13, R14, R15};
+
+#define CONTEXT(field) int32_t(offsetof(JitContext, field))
+
+/**
+ * @brief Translates one block. Every instruction may leave the block before
+ * it changes any state, through an exit that stores the PC and the cycles
+ * counted up to it. Cycles known at compile time are added only by the
+ * exits; CYCLES holds the cycles at entry plus the page crossings.
+ * */
+class BlockCompiler {
+  public:
+    BlockCompiler(Memory& memory, uint16_t pc)
+        : m_memory(memory), m_start(pc), m_pc(pc), m_top(0), m_cycles(0),
+          m_max_cycles(0), m_last(0) {}
+
+    /**
+     * @brief Returns false if not even the first instruction compiles.
+     * */
+    bool Compile() {
+        prologue();
+        m_top = m_asm.Position();
+
+        int count = 0;
+        bool ended = false;
+        while (!ended && count < JIT_MAX_BLOCK) {
+            uint8_t offset = PAGE_OFFSET(m_pc);
+            JitInfo info = jit_table[m_memory.peek(m_pc)];
+            uint8_t length = length_of(info.mode);
+            if (info.op == JitOp::NONE || offset + length > MEM_PAGE_SIZE ||
+                m_memory.WatchesInstruction(m_pc, length)) {
+                break;
+            }
+
+            uint16_t operand = 0;
+            if (length > 1) {
+                operand = m_memory.peek(m_pc + 1);
+            }
+            if (length > 2) {
+                operand = address_from_bytes(operand, m_memory.peek(m_pc + 2));
+            }
+
+            m_last = offset - PAGE_OFFSET(m_start);
+            ended = instruction(info, operand);
+            count++;
+        }
+
+        if (count == 0) {
+            return false;
+        }
+        if (!ended) {
+            add_exit(m_asm.Jmp(), m_pc, m_cycles);
+        }
+
+        size_t epilogue_position = epilogue();
+        for (auto& pending : m_exits) {
+            m_asm.Bind(pending.jump, m_asm.Position());
+            if (pending.cycles != 0) {
+                m_asm.AluRI(ADD, CYCLES, pending.cycles, true);
+            }
+            m_asm.AluRI(MOV, RAX, pending.pc);
+            m_asm.Bind(m_asm.Jmp(), epilogue_position);
+        }
+        return true;
+    }
+
+    const std::vector<uint8_t>& GetCode() { return m_asm.GetCode(); }
+
+    uint16_t GetMaxCycles() { return m_max_cycles; }
+
+    uint8_t GetLast() { return m_last; }
+
+  private:
+    struct Exit {
+        size_t jump;
+        uint16_t pc;
+        uint32_t cycles;
+    };
+
+    Memory& m_memory;
+    Assembler m_asm;
+    std::vector<Exit> m_exits;
+    uint16_t m_start, m_pc;
+    size_t m_top; // first instruction, after the prologue
+    uint32_t m_cycles, m_max_cycles;
+    uint8_t m_last;
+
+    void add_exit(size_t jump, uint16_t pc, uint32_t cycles) {
+        m_exits.push_back({jump, pc, cycles});
+    }
+
+    // Leave before the current instruction when cond holds.
+    void exit_if(Cond cond) { add_exit(m_asm.Jcc(cond), m_pc, m_cycles); }
+
+    void prologue() {
+        for (Reg reg : saved_registers) {
+            m_asm.Push(reg);
+        }
+        m_asm.Load64(READ, CTX, NO_INDEX, 0, CONTEXT(read));
+        m_asm.Load64(WRITE, CTX, NO_INDEX, 0, CONTEXT(write));
+        m_asm.Load64(CYCLES, CTX, NO_INDEX, 0, CONTEXT(cycles));
+        m_asm.MovzxLoad16(NZ, CTX, CONTEXT(nz));
+        m_asm.MovzxLoad8(AC, CTX, NO_INDEX, CONTEXT(ac));
+        m_asm.MovzxLoad8(XR, CTX, NO_INDEX, CONTEXT(x));
+        m_asm.MovzxLoad8(YR, CTX, NO_INDEX, CONTEXT(y));
+        m_asm.MovzxLoad8(BITS, CTX, NO_INDEX, CONTEXT(bits));
+    }
+
+    // Expects the next PC in RAX.
+    size_t epilogue() {
+        size_t position = m_asm.Position();
+        m_asm.Store16(CTX, CONTEXT(pc), RAX);
+        m_asm.Store64(CTX, CONTEXT(cycles), CYCLES);
+        m_asm.Store16(CTX, CONTEXT(nz), NZ);
+        m_asm.Store8(CTX, NO_INDEX, CONTEXT(ac), AC);
+        m_asm.Store8(CTX, NO_INDEX, CONTEXT(x), XR);
+        m_asm.Store8(CTX, NO_INDEX, CONTEXT(y), YR);
+        m_asm.Store8(CTX, NO_INDEX, CONTEXT(bits), BITS);
+        for (int i = 5; i >= 0; i--) {
+            m_asm.Pop(saved_registers[i]);
+        }
+        m_asm.Ret();
+        return position;
+    }
+
+    // PAGE = table[page of the 16 bit address in OFFSET], OFFSET = its low
+    // byte, leaving if the pointer is null.
+    void dynamic_page(Reg table) {
+        m_asm.AluRR(MOV, PAGE, OFFSET);
+        m_asm.Shr(PAGE, 8);
+        m_asm.Load64(PAGE, table, PAGE, 3, 0);
+        m_asm.TestQ(PAGE, PAGE);
+        exit_if(ZERO);
+        m_asm.MovzxRR8(OFFSET, OFFSET);
+    }
+
+    void static_page(Reg table, uint8_t page) {
+        m_asm.Load64(PAGE, table, NO_INDEX, 0, page * 8);
+        m_asm.TestQ(PAGE, PAGE);
+        exit_if(ZERO);
+    }
+
+    // Adds the page crossing cycle of low + index, clobbering low.
+    void crossing_cycle(Reg low, Reg index) {
+        m_asm.AluRR(ADD, low, index);
+        m_asm.Shr(low, 8);
+        m_asm.AluRR(ADD, CYCLES, low, true);
+    }
+
+    /**
+     * @brief Resolve the effective address into PAGE and the returned
+     * displacement, with OFFSET as index when the address isn't constant.
+     * penalty counts the page crossing cycle of indexed reads.
+     * */
+    std::pair<uint8_t, int32_t> address(JitMode mode, uint16_t operand,
+                                        Reg table, bool penalty) {
+        switch (mode) {
+        case JitMode::ZP:
+        case JitMode::ABS:
+            static_page(table, PAGE_OF(operand));
+            return {NO_INDEX, PAGE_OFFSET(operand)};
+        case JitMode::ZPX:
+        case JitMode::ZPY:
+            static_page(table, 0);
+            m_asm.AluRR(MOV, OFFSET, mode == JitMode::ZPX ? XR : YR);
+            m_asm.AluRI(ADD, OFFSET, operand);
+            m_asm.AluRI(AND, OFFSET, 0xFF);
+            return {OFFSET, 0};
+        case JitMode::ABSX:
+        case JitMode::ABSY: {
+            Reg index = mode == JitMode::ABSX ? XR : YR;
+            m_asm.AluRR(MOV, OFFSET, index);
+            m_asm.AluRI(ADD, OFFSET, operand);
+            m_asm.AluRI(AND, OFFSET, 0xFFFF);
+            dynamic_page(table);
+            if (penalty) {
+                m_asm.AluRI(MOV, TEMP, PAGE_OFFSET(operand));
+                crossing_cycle(TEMP, index);
+            }
+            return {OFFSET, 0};
+        }
+        case JitMode::INDX:
+            static_page(READ, 0);
+            m_asm.AluRR(MOV, OFFSET, XR);
+            m_asm.AluRI(ADD, OFFSET, operand);
+            m_asm.AluRI(AND, OFFSET, 0xFF);
+            m_asm.MovzxLoad8(TEMP, PAGE, OFFSET, 0);
+            m_asm.AluRI(ADD, OFFSET, 1);
+            m_asm.AluRI(AND, OFFSET, 0xFF);
+            m_asm.MovzxLoad8(OFFSET, PAGE, OFFSET, 0);
+            m_asm.Shl(OFFSET, 8);
+            m_asm.AluRR(OR, OFFSET, TEMP);
+            dynamic_page(table);
+            return {OFFSET, 0};
+        case JitMode::INDY:
+            static_page(READ, 0);
+            m_asm.MovzxLoad8(TEMP, PAGE, NO_INDEX, operand);
+            m_asm.MovzxLoad8(OFFSET, PAGE, NO_INDEX, (operand + 1) & 0xFF);
+            m_asm.Shl(OFFSET, 8);
+            m_asm.AluRR(OR, OFFSET, TEMP);
+            m_asm.AluRR(ADD, OFFSET, YR);
+            m_asm.AluRI(AND, OFFSET, 0xFFFF);
+            dynamic_page(table);
+            if (penalty) {
+                crossing_cycle(TEMP, YR);
+            }
+            return {OFFSET, 0};
+        default:
+            return {NO_INDEX, 0};
+        }
+    }
+
+    // VALUE = the operand of a read instruction.
+    void load_operand(JitMode mode, uint16_t operand) {
+        if (mode == JitMode::IMM) {
+            m_asm.AluRI(MOV, VALUE, operand);
+            return;
+        }
+        auto [index, disp] = address(mode, operand, READ, true);
+        m_asm.MovzxLoad8(VALUE, PAGE, index, disp);
+    }
+
+    void set_carry(Reg carry) {
+        m_asm.AluRI(AND, BITS, ~0x01);
+        m_asm.AluRR(OR, BITS, carry);
+    }
+
+    // BITS.C = bit 8 of VALUE, VALUE = its low byte
+    void carry_from_bit_8() {
+        m_asm.AluRR(MOV, TEMP, VALUE);
+        m_asm.Shr(TEMP, 8);
+        set_carry(TEMP);
+        m_asm.MovzxRR8(VALUE, VALUE);
+    }
+
+    // The shift or rotation of op on VALUE, as the interpreter does it.
+    void shift(JitOp op) {
+        switch (op) {
+        case JitOp::ASL:
+            m_asm.Shl(VALUE, 1);
+            carry_from_bit_8();
+            break;
+        case JitOp::ROL:
+            m_asm.AluRR(MOV, TEMP, BITS);
+            m_asm.AluRI(AND, TEMP, 0x01);
+            m_asm.Shl(VALUE, 1);
+            m_asm.AluRR(OR, VALUE, TEMP);
+            carry_from_bit_8();
+            break;
+        case JitOp::LSR:
+        case JitOp::ROR:
+            if (op == JitOp::ROR) {
+                m_asm.AluRR(MOV, TEMP, BITS);
+                m_asm.AluRI(AND, TEMP, 0x01);
+                m_asm.Shl(TEMP, 8);
+                m_asm.AluRR(OR, VALUE, TEMP);
+            }
+            m_asm.AluRR(MOV, TEMP, VALUE);
+            m_asm.AluRI(AND, TEMP, 0x01);
+            set_carry(TEMP);
+            m_asm.Shr(VALUE, 1);
+            break;
+        case JitOp::INC:
+            m_asm.AluRI(ADD, VALUE, 1);
+            m_asm.MovzxRR8(VALUE, VALUE);
+            break;
+        default: // DEC
+            m_asm.AluRI(SUB, VALUE, 1);
+            m_asm.MovzxRR8(VALUE, VALUE);
+            break;
+        }
+        m_asm.AluRR(MOV, NZ, VALUE);
+    }
+
+    // ADC and SBC in binary mode; decimal mode is left to the interpreter.
+    void add(bool subtract) {
+        m_asm.AluRR(MOV, RAX, BITS);
+        m_asm.AluRI(AND, RAX, 0x01);
+        m_asm.AluRR(ADD, RAX, AC);
+        m_asm.AluRR(MOV, RCX, AC);
+        if (subtract) {
+            // AC - VALUE - (1 - C), overflow from (AC ^ VALUE) & (AC ^ res)
+            m_asm.AluRR(SUB, RAX, VALUE);
+            m_asm.AluRI(SUB, RAX, 1);
+            m_asm.AluRR(XOR, RCX, VALUE);
+            m_asm.AluRR(MOV, VALUE, AC);
+            m_asm.AluRR(XOR, VALUE, RAX);
+        } else {
+            // overflow from (AC ^ res) & (VALUE ^ res)
+            m_asm.AluRR(ADD, RAX, VALUE);
+            m_asm.AluRR(XOR, RCX, RAX);
+            m_asm.AluRR(XOR, VALUE, RAX);
+        }
+        m_asm.AluRR(AND, RCX, VALUE);
+        m_asm.AluRI(AND, RCX, 0x80);
+        m_asm.Shr(RCX, 1);
+
+        // Bit 8 is the carry of ADC and the borrow of SBC.
+        m_asm.AluRR(MOV, VALUE, RAX);
+        m_asm.Shr(VALUE, 8);
+        m_asm.AluRI(AND, VALUE, 0x01);
+        if (subtract) {
+            m_asm.AluRI(XOR, VALUE, 0x01);
+        }
+        m_asm.AluRR(OR, RCX, VALUE);
+        m_asm.AluRI(AND, BITS, ~0x41);
+        m_asm.AluRR(OR, BITS, RCX);
+
+        m_asm.MovzxRR8(AC, RAX);
+        m_asm.AluRR(MOV, NZ, AC);
+    }
+
+    void compare(Reg reg) {
+        m_asm.AluRR(MOV, RAX, reg);
+        m_asm.AluRR(SUB, RAX, VALUE);
+        m_asm.MovzxRR8(NZ, RAX);
+        m_asm.Shr(RAX, 31);
+        m_asm.AluRI(XOR, RAX, 0x01);
+        set_carry(RAX);
+    }
+
+    void bit() {
+        // N from bit 7 of the operand, Z from AC & operand
+        m_asm.AluRR(MOV, RAX, AC);
+        m_asm.AluRR(AND, RAX, VALUE);
+        m_asm.AluRI(ADD, RAX, 0xFF);
+        m_asm.Shr(RAX, 8);
+        m_asm.AluRR(MOV, NZ, VALUE);
+        m_asm.AluRI(AND, NZ, 0x80);
+        m_asm.Shl(NZ, 1);
+        m_asm.AluRR(OR, NZ, RAX);
+        m_asm.AluRI(AND, VALUE, 0x40);
+        m_asm.AluRI(AND, BITS, ~0x40);
+        m_asm.AluRR(OR, BITS, VALUE);
+    }
+
+    /**
+     * @brief Ends the block at target, or loops back to its start while
+     * another full run of the block stays below the context's limit. Only
+     * the last instruction jumps, so max_cycles is the block's worst case.
+     * */
+    void jump(uint16_t target, uint32_t cycles, uint32_t max_cycles) {
+        if (target == m_start) {
+            m_asm.Lea64(RAX, CYCLES, cycles + max_cycles);
+            m_asm.Cmp64(RAX, CTX, CONTEXT(limit));
+            add_exit(m_asm.Jcc(ABOVE_EQUAL), target, cycles);
+            if (cycles != 0) {
+                m_asm.AluRI(ADD, CYCLES, cycles, true);
+            }
+            m_asm.Bind(m_asm.Jmp(), m_top);
+        } else {
+            add_exit(m_asm.Jmp(), target, cycles);
+        }
+    }
+
+    // Returns true when the instruction ends the block.
+    bool instruction(JitInfo info, uint16_t operand) {
+        JitOp op = info.op;
+        JitMode mode = info.mode;
+        uint16_t next = m_pc + length_of(mode);
+        uint32_t cycles = 2;
+        uint32_t max_cycles = 2;
+        bool ended = false;
+
+        switch (op) {
+        case JitOp::LDA:
+        case JitOp::LDX:
+        case JitOp::LDY: {
+            Reg reg = op == JitOp::LDA ? AC : op == JitOp::LDX ? XR : YR;
+            load_operand(mode, operand);
+            m_asm.AluRR(MOV, reg, VALUE);
+            m_asm.AluRR(MOV, NZ, VALUE);
+            break;
+        }
+        case JitOp::AND:
+        case JitOp::ORA:
+        case JitOp::EOR:
+            load_operand(mode, operand);
+            m_asm.AluRR(op == JitOp::AND ? AND : op == JitOp::ORA ? OR : XOR, AC,
+                    VALUE);
+            m_asm.AluRR(MOV, NZ, AC);
+            break;
+        case JitOp::ADC:
+        case JitOp::SBC:
+            m_asm.Test(BITS, 0x08);
+            exit_if(NOT_ZERO);
+            load_operand(mode, operand);
+            add(op == JitOp::SBC);
+            break;
+        case JitOp::CMP:
+        case JitOp::CPX:
+        case JitOp::CPY:
+            load_operand(mode, operand);
+            compare(op == JitOp::CMP ? AC : op == JitOp::CPX ? XR : YR);
+            break;
+        case JitOp::BIT:
+            load_operand(mode, operand);
+            bit();
+            break;
+        case JitOp::STA:
+        case JitOp::STX:
+        case JitOp::STY: {
+            Reg reg = op == JitOp::STA ? AC : op == JitOp::STX ? XR : YR;
+            auto [index, disp] = address(mode, operand, WRITE, false);
+            m_asm.Store8(PAGE, index, disp, reg);
+            break;
+        }
+        case JitOp::ASL:
+        case JitOp::LSR:
+        case JitOp::ROL:
+        case JitOp::ROR:
+        case JitOp::INC:
+        case JitOp::DEC:
+            if (mode == JitMode::ACC) {
+                m_asm.AluRR(MOV, VALUE, AC);
+                shift(op);
+                m_asm.AluRR(MOV, AC, VALUE);
+            } else {
+                // The direct write pointer also reads the page.
+                auto [index, disp] = address(mode, operand, WRITE, false);
+                m_asm.MovzxLoad8(VALUE, PAGE, index, disp);
+                shift(op);
+                m_asm.Store8(PAGE, index, disp, VALUE);
+            }
+            break;
+        case JitOp::INX:
+        case JitOp::INY:
+        case JitOp::DEX:
+        case JitOp::DEY: {
+            Reg reg = op == JitOp::INX || op == JitOp::DEX ? XR : YR;
+            bool increment = op == JitOp::INX || op == JitOp::INY;
+            m_asm.AluRI(increment ? ADD : SUB, reg, 1);
+            m_asm.MovzxRR8(reg, reg);
+            m_asm.AluRR(MOV, NZ, reg);
+            break;
+        }
+        case JitOp::TAX:
+            m_asm.AluRR(MOV, XR, AC);
+            break;
+        case JitOp::TAY:
+            m_asm.AluRR(MOV, YR, AC);
+            break;
+        case JitOp::TXA:
+            m_asm.AluRR(MOV, AC, XR);
+            break;
+        case JitOp::CLC:
+        case JitOp::CLD:
+        case JitOp::CLI:
+        case JitOp::CLV: {
+            uint8_t flag = op == JitOp::CLC   ? 0x01
+                           : op == JitOp::CLD ? 0x08
+                           : op == JitOp::CLI ? 0x04
+                                              : 0x40;
+            m_asm.AluRI(AND, BITS, ~flag);
+            break;
+        }
+        case JitOp::SEC:
+        case JitOp::SED:
+        case JitOp::SEI: {
+            uint8_t flag = op == JitOp::SEC   ? 0x01
+                           : op == JitOp::SED ? 0x08
+                                              : 0x04;
+            m_asm.AluRI(OR, BITS, flag);
+            break;
+        }
+        case JitOp::NOP:
+            break;
+        case JitOp::JMP:
+            cycles = max_cycles = 3;
+            jump(operand, m_cycles + cycles, m_max_cycles + max_cycles);
+            ended = true;
+            break;
+        default: {
+            // Branches: 2 cycles, one more when taken and another one when
+            // the target is on another page than the next instruction.
+            uint16_t target = next + int8_t(operand);
+            uint32_t taken = PAGE_OF(target) != PAGE_OF(next) ? 4 : 3;
+            max_cycles = taken;
+            if (op == JitOp::BEQ || op == JitOp::BNE) {
+                m_asm.Test(NZ, 0xFF); // non zero when Z is clear
+            } else if (op == JitOp::BMI || op == JitOp::BPL) {
+                m_asm.Test(NZ, 0x180);
+            } else if (op == JitOp::BCS || op == JitOp::BCC) {
+                m_asm.Test(BITS, 0x01);
+            } else {
+                m_asm.Test(BITS, 0x40);
+            }
+            bool taken_if_set = op == JitOp::BNE || op == JitOp::BMI ||
+                                op == JitOp::BCS || op == JitOp::BVS;
+            // Skip the taken path when the condition fails.
+            size_t not_taken = m_asm.Jcc(taken_if_set ? ZERO : NOT_ZERO);
+            jump(target, m_cycles + taken, m_max_cycles + max_cycles);
+            m_asm.Bind(not_taken, m_asm.Position());
+            add_exit(m_asm.Jmp(), next, m_cycles + cycles);
+            ended = true;
+            break;
+        }
+        }
+
+        if (!ended) {
+            cycles = instruction_cycles(op, mode);
+            max_cycles = cycles + has_crossing_cycle(op, mode);
+        }
+        m_cycles += cycles;
+        m_max_cycles += max_cycles;
+        m_pc = next;
+        return ended;
+    }
+
+    static uint32_t instruction_cycles(JitOp op, JitMode mode) {
+        switch (op) {
+        case JitOp::STA:
+        case JitOp::STX:
+        case JitOp::STY:
+            // Indexed stores always pay the page crossing cycle.
+            return read_cycles(mode) +
+                   (mode == JitMode::ABSX || mode == JitMode::ABSY ||
+                    mode == JitMode::INDY);
+        case JitOp::ASL:
+        case JitOp::LSR:
+        case JitOp::ROL:
+        case JitOp::ROR:
+        case JitOp::INC:
+        case JitOp::DEC:
+            return mode == JitMode::ACC ? 2 : read_cycles(mode) + 2;
+        default:
+            return mode == JitMode::IMPLIED ? 2 : read_cycles(mode);
+        }
+    }
+
+    static bool has_crossing_cycle(JitOp op, JitMode mode) {
+        bool indexed = mode == JitMode::ABSX || mode == JitMode::ABSY ||
+                       mode == JitMode::INDY;
+        return indexed && op != JitOp::STA;
+    }
+};
+
+#undef CONTEXT
+
+/* JitCache */
+JitCache::JitCache() : m_code(nullptr), m_code_used(0), m_compiled(0) {
+    void* code = mmap(nullptr, JIT_CODE_SIZE, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code != MAP_FAILED) {
+        m_code = static_cast<uint8_t*>(code);
+    }
+}
+
+JitCache::~JitCache() {
+    if (m_code != nullptr) {
+        munmap(m_code, JIT_CODE_SIZE);
+    }
+}
+
+void JitCache::flush() {
+    for (auto& page : m_pages) {
+        page.reset();
+    }
+    m_code_used = 0;
+}
+
+jit_code_t JitCache::install(const uint8_t* code, size_t size) {
+    if (m_code == nullptr || size > JIT_CODE_SIZE) {
+        return nullptr;
+    }
+
+    // The arena is only writable while a block is copied in.
+    if (mprotect(m_code, JIT_CODE_SIZE, PROT_READ | PROT_WRITE) != 0) {
+        return nullptr;
+    }
+    uint8_t* target = m_code + m_code_used;
+    memcpy(target, code, size);
+    m_code_used += (size + 15) & ~size_t(15);
+    if (mprotect(m_code, JIT_CODE_SIZE, PROT_READ | PROT_EXEC) != 0) {
+        return nullptr;
+    }
+    return reinterpret_cast<jit_code_t>(target);
+}
+
+const JitBlock* JitCache::count(Memory& memory, uint16_t pc) {
+    uint8_t page = PAGE_OF(pc);
+    auto& blocks = m_pages[page];
+    if (blocks == nullptr) {
+        blocks.reset(new JitBlock[MEM_PAGE_SIZE]());
+    }
+
+    JitBlock& block = blocks[PAGE_OFFSET(pc)];
+    uint32_t version = memory.GetCodeVersion(page);
+    if (block.version != version) {
+        block = {nullptr, version, 0, 0, 0};
+    }
+    if (++block.hits < JIT_HOT_THRESHOLD ||
+        memory.GetPageKind(page) == PageKind::DEVICE) {
+        return nullptr;
+    }
+
+    // Marked before compiling, so any later write invalidates the block.
+    memory.MarkCode(page);
+    BlockCompiler compiler(memory, pc);
+    if (!compiler.Compile()) {
+        return nullptr;
+    }
+
+    const auto& code = compiler.GetCode();
+    if (m_code_used + code.size() > JIT_CODE_SIZE) {
+        // Starts over; hot blocks are compiled again as they run.
+        flush();
+        return nullptr;
+    }
+
+    block.code = install(code.data(), code.size());
+    block.max_cycles = compiler.GetMaxCycles();
+    block.last = compiler.GetLast();
+    m_compiled += block.code != nullptr;
+    return block.code != nullptr ? &block : nullptr;
+}
+
+#else
+
+JitCache::JitCache() : m_code(nullptr), m_code_used(0), m_compiled(0) {}
+
+JitCache::~JitCache() = default;
+
+const JitBlock* JitCache::count(Memory&, uint16_t) { return nullptr; }
+
+#endif
+
+/**
+ * Without tracing, runs compiled blocks where they exist and may run whole,
+ * i.e. no stop check would have failed before any instruction of the block.
+ * Everything else runs in the table interpreter.
+ * */
+template <bool TRACE> void CPU::ExecuteJit() {
+    if constexpr (TRACE || !JIT_AVAILABLE) {
+        ExecutePredecoded<TRACE>();
+    } else {
+        if (m_jit_cache == nullptr) {
+            m_jit_cache.reset(new JitCache());
+        }
+        JitCache& cache = *m_jit_cache;
+
+        while (Running()) {
+            const JitBlock* block = cache.Lookup(*m_memory, PC);
+            if (block != nullptr &&
+                m_cycles + block->max_cycles < m_next_stop) {
+                JitContext context = {m_memory->GetReadPointers(),
+                                      m_memory->GetWritePointers(),
+                                      m_cycles,
+                                      m_next_stop,
+                                      PC,
+                                      SR.raw.nz,
+                                      AC,
+                                      X,
+                                      Y,
+                                      SR.raw.bits};
+                uint64_t context_start = m_cycles;
+                block->code(&context);
+                PC = context.pc;
+                m_cycles = context.cycles;
+                SR.raw.nz = context.nz;
+                SR.raw.bits = context.bits;
+                AC = context.ac;
+                X = context.x;
+                Y = context.y;
+                if (m_cycles != context_start) {
+                    continue;
+                }
+                // The first instruction left at once, e.g. for a device.
+            }
+
+            uint8_t op_code = FetchOpCode();
+            isa_table[op_code](*this, op_code);
+        }
+    }
+}
+
+template void CPU::ExecuteJit<true>();
+template void CPU::ExecuteJit<false>();
@@ -0,0 +1,614 @@
+#include <Lockstep.h>
+#include <algorithm>
+#include <instructions.h>
+
+/**
+ * What the vector kernels know of an op_code: the operation and its
+ * addressing mode. Op_codes left at NONE run on each lane's CPU.
+ * */
+enum class LaneOp : uint8_t {
+    NONE, LDA, LDX, LDY, STA, STX, STY, ADC, SBC, AND, ORA, EOR, CMP, CPX, CPY,
+    INX, INY, DEX, DEY, TAX, TAY, TXA, CLC, SEC, CLD, SED, CLI, SEI, CLV, NOP,
+    ASL, LSR, ROL, ROR, BCC, BCS, BEQ, BNE, BMI, BPL, BVC, BVS, JMP,
+};
+
+enum class LaneMode : uint8_t {
+    IMPLIED, IMM, ZP, ZPX, ZPY, ABS, ABSX, ABSY, REL,
+};
+
+struct LaneInfo {
+    LaneOp op;
+    LaneMode mode;
+};
+
+/**
+ * @brief The op_codes the kernels run. Like the JIT they leave out the ones
+ * whose interpreter handler is known to be wrong (TYA, TSX, TXS), as well as
+ * the stack, indirect and read-modify-write instructions.
+ * */
+static constexpr std::array<LaneInfo, 256> make_lane_table() {
+    std::array<LaneInfo, 256> table{};
+    using I = Instruction;
+    using M = LaneMode;
+
+    auto alu = [&](LaneOp op, I imm, I zp, I zpx, I abs, I absx, I absy) {
+        table[imm] = {op, M::IMM};
+        table[zp] = {op, M::ZP};
+        table[zpx] = {op, M::ZPX};
+        table[abs] = {op, M::ABS};
+        table[absx] = {op, M::ABSX};
+        table[absy] = {op, M::ABSY};
+    };
+    alu(LaneOp::ADC, I::ADC_IMM, I::ADC_ZP, I::ADC_ZPX, I::ADC_ABS, I::ADC_ABSX,
+        I::ADC_ABSY);
+    alu(LaneOp::AND, I::AND_IMM, I::AND_ZP, I::AND_ZPX, I::AND_ABS, I::AND_ABSX,
+        I::AND_ABSY);
+    alu(LaneOp::CMP, I::CMP_IMM, I::CMP_ZP, I::CMP_ZPX, I::CMP_ABS, I::CMP_ABSX,
+        I::CMP_ABSY);
+    alu(LaneOp::EOR, I::EOR_IMM, I::EOR_ZP, I::EOR_ZPX, I::EOR_ABS, I::EOR_ABSX,
+        I::EOR_ABSY);
+    alu(LaneOp::LDA, I::LDA_IMM, I::LDA_ZP, I::LDA_ZPX, I::LDA_ABS, I::LDA_ABSX,
+        I::LDA_ABSY);
+    alu(LaneOp::ORA, I::ORA_IMM, I::ORA_ZP, I::ORA_ZPX, I::ORA_ABS, I::ORA_ABSX,
+        I::ORA_ABSY);
+    alu(LaneOp::SBC, I::SBC_IMM, I::SBC_ZP, I::SBC_ZPX, I::SBC_ABS, I::SBC_ABSX,
+        I::SBC_ABSY);
+
+    table[I::STA_ZP] = {LaneOp::STA, M::ZP};
+    table[I::STA_ZPX] = {LaneOp::STA, M::ZPX};
+    table[I::STA_ABS] = {LaneOp::STA, M::ABS};
+    table[I::STA_ABSX] = {LaneOp::STA, M::ABSX};
+    table[I::STA_ABSY] = {LaneOp::STA, M::ABSY};
+
+    table[I::LDX_IMM] = {LaneOp::LDX, M::IMM};
+    table[I::LDX_ZP] = {LaneOp::LDX, M::ZP};
+    table[I::LDX_ZPY] = {LaneOp::LDX, M::ZPY};
+    table[I::LDX_ABS] = {LaneOp::LDX, M::ABS};
+    table[I::LDX_ABSY] = {LaneOp::LDX, M::ABSY};
+    table[I::LDY_IMM] = {LaneOp::LDY, M::IMM};
+    table[I::LDY_ZP] = {LaneOp::LDY, M::ZP};
+    table[I::LDY_ZPX] = {LaneOp::LDY, M::ZPX};
+    table[I::LDY_ABS] = {LaneOp::LDY, M::ABS};
+    table[I::LDY_ABSX] = {LaneOp::LDY, M::ABSX};
+    table[I::STX_ZP] = {LaneOp::STX, M::ZP};
+    table[I::STX_ZPY] = {LaneOp::STX, M::ZPY};
+    table[I::STX_ABS] = {LaneOp::STX, M::ABS};
+    table[I::STY_ZP] = {LaneOp::STY, M::ZP};
+    table[I::STY_ZPX] = {LaneOp::STY, M::ZPX};
+    table[I::STY_ABS] = {LaneOp::STY, M::ABS};
+
+    table[I::CMX_IMM] = {LaneOp::CPX, M::IMM};
+    table[I::CMX_ZP] = {LaneOp::CPX, M::ZP};
+    table[I::CMX_ABS] = {LaneOp::CPX, M::ABS};
+    table[I::CMY_IMM] = {LaneOp::CPY, M::IMM};
+    table[I::CMY_ZP] = {LaneOp::CPY, M::ZP};
+    table[I::CMY_ABS] = {LaneOp::CPY, M::ABS};
+
+    table[I::ASL_ACC] = {LaneOp::ASL, M::IMPLIED};
+    table[I::LSR_ACC] = {LaneOp::LSR, M::IMPLIED};
+    table[I::ROL_ACC] = {LaneOp::ROL, M::IMPLIED};
+    table[I::ROR_ACC] = {LaneOp::ROR, M::IMPLIED};
+    table[I::INX] = {LaneOp::INX, M::IMPLIED};
+    table[I::INY] = {LaneOp::INY, M::IMPLIED};
+    table[I::DEX] = {LaneOp::DEX, M::IMPLIED};
+    table[I::DEY] = {LaneOp::DEY, M::IMPLIED};
+    table[I::TAX] = {LaneOp::TAX, M::IMPLIED};
+    table[I::TAY] = {LaneOp::TAY, M::IMPLIED};
+    table[I::TXA] = {LaneOp::TXA, M::IMPLIED};
+    table[I::CLC] = {LaneOp::CLC, M::IMPLIED};
+    table[I::SEC] = {LaneOp::SEC, M::IMPLIED};
+    table[I::CLD] = {LaneOp::CLD, M::IMPLIED};
+    table[I::SED] = {LaneOp::SED, M::IMPLIED};
+    table[I::CLI] = {LaneOp::CLI, M::IMPLIED};
+    table[I::SEI] = {LaneOp::SEI, M::IMPLIED};
+    table[I::CLV] = {LaneOp::CLV, M::IMPLIED};
+    table[I::NOP] = {LaneOp::NOP, M::IMPLIED};
+
+    table[I::BCC] = {LaneOp::BCC, M::REL};
+    table[I::BCS] = {LaneOp::BCS, M::REL};
+    table[I::BEQ] = {LaneOp::BEQ, M::REL};
+    table[I::BNE] = {LaneOp::BNE, M::REL};
+    table[I::BMI] = {LaneOp::BMI, M::REL};
+    table[I::BPL] = {LaneOp::BPL, M::REL};
+    table[I::BVC] = {LaneOp::BVC, M::REL};
+    table[I::BVS] = {LaneOp::BVS, M::REL};
+    table[I::JMP_ABS] = {LaneOp::JMP, M::ABS};
+    return table;
+}
+
+static constexpr std::array<LaneInfo, 256> lane_table = make_lane_table();
+
+// Instruction length and cycles before any page crossing, per LaneMode.
+static constexpr uint8_t mode_length[] = {1, 2, 2, 2, 2, 3, 3, 3, 2};
+static constexpr uint8_t mode_cycles[] = {2, 2, 3, 4, 4, 4, 4, 4, 2};
+
+/**
+ * @brief a where mask is 1, else b, without a branch.
+ * */
+template <typename T> ALWAYS_INLINE T select(uint8_t mask, T a, T b) {
+    T bits = T(-T(mask));
+    return (a & bits) | (b & ~bits);
+}
+
+/**
+ * @brief Call f(chunk, i, mask) for every lane of the chunks holding the
+ * group. The arrays of a chunk are members of one object with a constant
+ * length, so the compiler vectorizes these loops without alias checks, and
+ * the kernels only write through select, so the loops have no branches.
+ * */
+template <typename Chunk, typename F>
+ALWAYS_INLINE void for_lanes(std::vector<Chunk*>& chunks, F f) {
+    for (Chunk* chunk : chunks) {
+        for (size_t i = 0; i < LOCKSTEP_CHUNK; i++) {
+            f(*chunk, i, chunk->mask[i]);
+        }
+    }
+}
+
+Lockstep::Lockstep(CPU& prototype, size_t lanes)
+    : m_chunks((lanes + LOCKSTEP_CHUNK - 1) / LOCKSTEP_CHUNK),
+      m_vector_instructions(0), m_scalar_instructions(0) {
+    CPU::State state = prototype.Snapshot();
+    for (size_t lane = 0; lane < lanes; lane++) {
+        m_lanes.emplace_back(new CPU(prototype.ShareMemory()->Clone(),
+                                     Engine::Table));
+        m_lanes[lane]->Restore(state);
+    }
+    // Padding lanes stay out of every mask.
+    for (LaneChunk& chunk : m_chunks) {
+        chunk = {};
+    }
+}
+
+Lockstep::~Lockstep() = default;
+
+Lockstep::LaneChunk& Lockstep::chunk_of(size_t lane) {
+    return m_chunks[lane / LOCKSTEP_CHUNK];
+}
+
+void Lockstep::load(size_t lane) {
+    CPU& cpu = *m_lanes[lane];
+    LaneChunk& chunk = chunk_of(lane);
+    size_t i = lane % LOCKSTEP_CHUNK;
+    chunk.pc[i] = cpu.PC;
+    chunk.nz[i] = cpu.SR.raw.nz;
+    chunk.ac[i] = cpu.AC;
+    chunk.x[i] = cpu.X;
+    chunk.y[i] = cpu.Y;
+    chunk.bits[i] = cpu.SR.raw.bits;
+    chunk.cycles[i] = cpu.m_cycles;
+    chunk.next_stop[i] = cpu.m_next_stop;
+}
+
+void Lockstep::store(size_t lane) {
+    CPU& cpu = *m_lanes[lane];
+    LaneChunk& chunk = chunk_of(lane);
+    size_t i = lane % LOCKSTEP_CHUNK;
+    cpu.PC = chunk.pc[i];
+    cpu.SR.raw.nz = chunk.nz[i];
+    cpu.AC = chunk.ac[i];
+    cpu.X = chunk.x[i];
+    cpu.Y = chunk.y[i];
+    cpu.SR.raw.bits = chunk.bits[i];
+    cpu.m_cycles = chunk.cycles[i];
+}
+
+void Lockstep::Run(uint64_t cycle_budget) {
+    size_t count = m_lanes.size();
+    size_t running = count;
+    for (size_t lane = 0; lane < count; lane++) {
+        CPU& cpu = *m_lanes[lane];
+        HaltConditions conditions;
+        conditions.cycles = cycle_budget;
+        cpu.start(conditions);
+        load(lane);
+        chunk_of(lane).running[lane % LOCKSTEP_CHUNK] = 1;
+        chunk_of(lane).read[lane % LOCKSTEP_CHUNK] =
+            cpu.GetMemory().GetReadPointers();
+        chunk_of(lane).write[lane % LOCKSTEP_CHUNK] =
+            cpu.GetMemory().GetWritePointers();
+        chunk_of(lane).fetch[lane % LOCKSTEP_CHUNK] =
+            cpu.GetMemory().GetFetchPointers();
+    }
+
+    while (running > 0) {
+        // The loop condition of each lane's engine, then the lowest PC.
+        uint32_t pc = MEM_SIZE;
+        for (size_t lane = 0; lane < count; lane++) {
+            LaneChunk& chunk = chunk_of(lane);
+            size_t i = lane % LOCKSTEP_CHUNK;
+            if (!chunk.running[i]) {
+                continue;
+            }
+            if (UNLIKELY(chunk.cycles[i] >= chunk.next_stop[i])) {
+                store(lane);
+                bool serviced = m_lanes[lane]->Service();
+                load(lane);
+                if (!serviced) {
+                    chunk.running[i] = 0;
+                    running--;
+                    continue;
+                }
+            }
+            pc = std::min<uint32_t>(pc, chunk.pc[i]);
+        }
+        if (running > 0) {
+            run_group(pc);
+        }
+    }
+}
+
+void Lockstep::step_lane(size_t lane) {
+    store(lane);
+    CPU& cpu = *m_lanes[lane];
+    uint8_t op_code = cpu.FetchOpCode();
+    isa_table[op_code](cpu, op_code);
+    load(lane);
+    m_scalar_instructions++;
+}
+
+void Lockstep::run_group(uint16_t pc) {
+    size_t count = m_lanes.size();
+    size_t leader = 0;
+    while (!chunk_of(leader).running[leader % LOCKSTEP_CHUNK] ||
+           chunk_of(leader).pc[leader % LOCKSTEP_CHUNK] != pc) {
+        leader++;
+    }
+
+    // The leader's code decides what runs; lanes whose code page isn't the
+    // same storage run on their own.
+    // The kernels skip the chunks without any lane of the group.
+    const uint8_t* code =
+        chunk_of(leader).fetch[leader % LOCKSTEP_CHUNK][PAGE_OF(pc)];
+    m_group.clear();
+    for (size_t lane = 0; lane < count; lane++) {
+        LaneChunk& chunk = chunk_of(lane);
+        size_t i = lane % LOCKSTEP_CHUNK;
+        bool here = chunk.running[i] && chunk.pc[i] == pc;
+        chunk.mask[i] = here && chunk.fetch[i][PAGE_OF(pc)] == code;
+        if (here && !chunk.mask[i]) {
+            step_lane(lane);
+        }
+        if (chunk.mask[i] && (m_group.empty() || m_group.back() != &chunk)) {
+            m_group.push_back(&chunk);
+        }
+    }
+
+    // The group runs on while its lanes agree on PC and none is due for
+    // Service. Lanes waiting elsewhere join it at the next regrouping.
+    while (code != nullptr) {
+        uint8_t op_code = code[PAGE_OFFSET(pc)];
+        uint8_t length = mode_length[uint8_t(lane_table[op_code].mode)];
+        if (lane_table[op_code].op == LaneOp::NONE ||
+            PAGE_OFFSET(pc) + length > MEM_PAGE_SIZE) {
+            break;
+        }
+        uint16_t operand = length > 1 ? code[PAGE_OFFSET(pc) + 1] : 0;
+        if (length == 3) {
+            operand = address_from_bytes(operand, code[PAGE_OFFSET(pc) + 2]);
+        }
+
+        m_fallback.clear();
+        run_kernel(op_code, operand);
+        for (size_t lane : m_fallback) {
+            step_lane(lane);
+        }
+
+        uint16_t low = UINT16_MAX, high = 0;
+        uint8_t due = 0;
+        size_t members = 0;
+        for_lanes(m_group, [&](LaneChunk& c, size_t i, uint8_t mask) {
+            low = std::min(low, select<uint16_t>(mask, c.pc[i], UINT16_MAX));
+            high = std::max(high, select<uint16_t>(mask, c.pc[i], 0));
+            due |= mask & (c.cycles[i] >= c.next_stop[i]);
+            members += mask;
+        });
+        m_vector_instructions += members;
+        if (members == 0 || low != high || due || PAGE_OF(low) != PAGE_OF(pc)) {
+            return;
+        }
+        pc = low;
+    }
+
+    for (size_t lane = 0; lane < count; lane++) {
+        if (chunk_of(lane).mask[lane % LOCKSTEP_CHUNK]) {
+            step_lane(lane);
+        }
+    }
+}
+
+void Lockstep::run_kernel(uint8_t op_code, uint16_t operand) {
+    LaneInfo info = lane_table[op_code];
+    LaneOp op = info.op;
+    LaneMode mode = info.mode;
+    bool store = op == LaneOp::STA || op == LaneOp::STX || op == LaneOp::STY;
+
+    for_lanes(m_group, [operand](LaneChunk& c, size_t i, uint8_t) {
+        c.value[i] = operand;
+        c.extra[i] = 0;
+    });
+
+    // Lanes whose access would take the slow path, and decimal mode lanes of
+    // ADC and SBC, leave the mask and run on their own.
+    bool decimal = op == LaneOp::ADC || op == LaneOp::SBC;
+    bool memory = mode >= LaneMode::ZP && mode <= LaneMode::ABSY &&
+                  op != LaneOp::JMP;
+    for (size_t k = 0; (decimal || memory) && k < m_group.size(); k++) {
+        LaneChunk& chunk = *m_group[k];
+        size_t n = &chunk - m_chunks.data();
+        for (size_t i = 0; i < LOCKSTEP_CHUNK; i++) {
+            if (!chunk.mask[i]) {
+                continue;
+            }
+            if (decimal && (chunk.bits[i] & 0x08)) {
+                chunk.mask[i] = 0;
+                m_fallback.push_back(n * LOCKSTEP_CHUNK + i);
+                continue;
+            }
+            if (!memory) {
+                continue;
+            }
+
+            // The operand read through the lane's own pointer tables.
+            uint16_t address = operand;
+            if (mode == LaneMode::ZPX) {
+                address = (operand + chunk.x[i]) & 0xFF;
+            } else if (mode == LaneMode::ZPY) {
+                address = (operand + chunk.y[i]) & 0xFF;
+            } else if (mode == LaneMode::ABSX || mode == LaneMode::ABSY) {
+                address += mode == LaneMode::ABSX ? chunk.x[i] : chunk.y[i];
+                chunk.extra[i] = store || PAGE_OF(address) != PAGE_OF(operand);
+            }
+            uint8_t* page =
+                store ? chunk.write[i][PAGE_OF(address)]
+                      : const_cast<uint8_t*>(chunk.read[i][PAGE_OF(address)]);
+            if (page == nullptr) {
+                chunk.mask[i] = 0;
+                m_fallback.push_back(n * LOCKSTEP_CHUNK + i);
+                continue;
+            }
+            chunk.pointer[i] = page + PAGE_OFFSET(address);
+            chunk.value[i] = store ? 0 : *chunk.pointer[i];
+        }
+    }
+
+    switch (op) {
+    case LaneOp::LDA:
+        for_lanes(m_group, [](LaneChunk& c, size_t i, uint8_t mask) {
+            c.ac[i] = select(mask, c.value[i], c.ac[i]);
+            c.nz[i] = select<uint16_t>(mask, c.value[i], c.nz[i]);
+        });
+        break;
+    case LaneOp::LDX:
+        for_lanes(m_group, [](LaneChunk& c, size_t i, uint8_t mask) {
+            c.x[i] = select(mask, c.value[i], c.x[i]);
+            c.nz[i] = select<uint16_t>(mask, c.value[i], c.nz[i]);
+        });
+        break;
+    case LaneOp::LDY:
+        for_lanes(m_group, [](LaneChunk& c, size_t i, uint8_t mask) {
+            c.y[i] = select(mask, c.value[i], c.y[i]);
+            c.nz[i] = select<uint16_t>(mask, c.value[i], c.nz[i]);
+        });
+        break;
+    // Stores scatter to a page per lane, which only AVX-512 could vectorize.
+    case LaneOp::STA:
+    case LaneOp::STX:
+    case LaneOp::STY:
+        for (LaneChunk* c : m_group) {
+            const uint8_t* source = op == LaneOp::STA   ? c->ac
+                                    : op == LaneOp::STX ? c->x
+                                                        : c->y;
+            for (size_t i = 0; i < LOCKSTEP_CHUNK; i++) {
+                if (c->mask[i]) {
+                    *c->pointer[i] = source[i];
+                }
+            }
+        }
+        break;
+    case LaneOp::ADC:
+        for_lanes(m_group, [](LaneChunk& c, size_t i, uint8_t mask) {
+            uint16_t sum = c.value[i] + c.ac[i] + (c.bits[i] & 0x01);
+            uint8_t result = sum & 0xFF;
+            uint8_t overflow =
+                (c.ac[i] ^ result) & (c.value[i] ^ result) & 0x80;
+            uint8_t flags = overflow >> 1 | GET_BIT(sum, 8);
+            c.ac[i] = select(mask, result, c.ac[i]);
+            c.nz[i] = select<uint16_t>(mask, result, c.nz[i]);
+            c.bits[i] = select<uint8_t>(mask, (c.bits[i] & ~0x41) | flags,
+                                        c.bits[i]);
+        });
+        break;
+    case LaneOp::SBC:
+        for_lanes(m_group, [](LaneChunk& c, size_t i, uint8_t mask) {
+            uint16_t difference =
+                c.ac[i] - c.value[i] - (1 - (c.bits[i] & 0x01));
+            uint8_t result = difference & 0xFF;
+            uint8_t overflow =
+                (c.ac[i] ^ c.value[i]) & (c.ac[i] ^ result) & 0x80;
+            uint8_t flags = overflow >> 1 | !GET_BIT(difference, 8);
+            c.ac[i] = select(mask, result, c.ac[i]);
+            c.nz[i] = select<uint16_t>(mask, result, c.nz[i]);
+            c.bits[i] = select<uint8_t>(mask, (c.bits[i] & ~0x41) | flags,
+                                        c.bits[i]);
+        });
+        break;
+    case LaneOp::AND:
+        for_lanes(m_group, [](LaneChunk& c, size_t i, uint8_t mask) {
+            uint8_t result = c.ac[i] & c.value[i];
+            c.ac[i] = select(mask, result, c.ac[i]);
+            c.nz[i] = select<uint16_t>(mask, result, c.nz[i]);
+        });
+        break;
+    case LaneOp::ORA:
+        for_lanes(m_group, [](LaneChunk& c, size_t i, uint8_t mask) {
+            uint8_t result = c.ac[i] | c.value[i];
+            c.ac[i] = select(mask, result, c.ac[i]);
+            c.nz[i] = select<uint16_t>(mask, result, c.nz[i]);
+        });
+        break;
+    case LaneOp::EOR:
+        for_lanes(m_group, [](LaneChunk& c, size_t i, uint8_t mask) {
+            uint8_t result = c.ac[i] ^ c.value[i];
+            c.ac[i] = select(mask, result, c.ac[i]);
+            c.nz[i] = select<uint16_t>(mask, result, c.nz[i]);
+        });
+        break;
+    case LaneOp::CMP:
+        compare(&LaneChunk::ac);
+        break;
+    case LaneOp::CPX:
+        compare(&LaneChunk::x);
+        break;
+    case LaneOp::CPY:
+        compare(&LaneChunk::y);
+        break;
+    case LaneOp::INX:
+        count(&LaneChunk::x, 1);
+        break;
+    case LaneOp::INY:
+        count(&LaneChunk::y, 1);
+        break;
+    case LaneOp::DEX:
+        count(&LaneChunk::x, 0xFF);
+        break;
+    case LaneOp::DEY:
+        count(&LaneChunk::y, 0xFF);
+        break;
+    // Transfers leave the flags alone, like their handlers.
+    case LaneOp::TAX:
+        for_lanes(m_group, [](LaneChunk& c, size_t i, uint8_t mask) {
+            c.x[i] = select(mask, c.ac[i], c.x[i]);
+        });
+        break;
+    case LaneOp::TAY:
+        for_lanes(m_group, [](LaneChunk& c, size_t i, uint8_t mask) {
+            c.y[i] = select(mask, c.ac[i], c.y[i]);
+        });
+        break;
+    case LaneOp::TXA:
+        for_lanes(m_group, [](LaneChunk& c, size_t i, uint8_t mask) {
+            c.ac[i] = select(mask, c.x[i], c.ac[i]);
+        });
+        break;
+    case LaneOp::CLC:
+        flag(0x01, false);
+        break;
+    case LaneOp::SEC:
+        flag(0x01, true);
+        break;
+    case LaneOp::CLD:
+        flag(0x08, false);
+        break;
+    case LaneOp::SED:
+        flag(0x08, true);
+        break;
+    case LaneOp::CLI:
+        flag(0x04, false);
+        break;
+    case LaneOp::SEI:
+        flag(0x04, true);
+        break;
+    case LaneOp::CLV:
+        flag(0x40, false);
+        break;
+    case LaneOp::ASL:
+    case LaneOp::ROL: {
+        uint8_t rotate = op == LaneOp::ROL;
+        for_lanes(m_group, [rotate](LaneChunk& c, size_t i, uint8_t mask) {
+            uint8_t result = c.ac[i] << 1 | (c.bits[i] & rotate);
+            c.bits[i] = select<uint8_t>(
+                mask, (c.bits[i] & ~0x01) | c.ac[i] >> 7, c.bits[i]);
+            c.ac[i] = select(mask, result, c.ac[i]);
+            c.nz[i] = select<uint16_t>(mask, result, c.nz[i]);
+        });
+        break;
+    }
+    case LaneOp::LSR:
+    case LaneOp::ROR: {
+        uint8_t rotate = op == LaneOp::ROR;
+        for_lanes(m_group, [rotate](LaneChunk& c, size_t i, uint8_t mask) {
+            uint8_t result = c.ac[i] >> 1 | (c.bits[i] & rotate) << 7;
+            c.bits[i] = select<uint8_t>(
+                mask, (c.bits[i] & ~0x01) | (c.ac[i] & 0x01), c.bits[i]);
+            c.ac[i] = select(mask, result, c.ac[i]);
+            c.nz[i] = select<uint16_t>(mask, result, c.nz[i]);
+        });
+        break;
+    }
+    case LaneOp::BCC:
+    case LaneOp::BCS:
+    case LaneOp::BEQ:
+    case LaneOp::BNE:
+    case LaneOp::BMI:
+    case LaneOp::BPL:
+    case LaneOp::BVC:
+    case LaneOp::BVS:
+        branch(op_code, operand);
+        break;
+    case LaneOp::JMP:
+        for_lanes(m_group, [operand](LaneChunk& c, size_t i, uint8_t mask) {
+            c.pc[i] = select(mask, operand, c.pc[i]);
+        });
+        break;
+    default:
+        break;
+    }
+
+    uint8_t length = mode_length[uint8_t(mode)];
+    uint8_t cycles = op == LaneOp::JMP ? 3 : mode_cycles[uint8_t(mode)];
+    bool jumps = mode == LaneMode::REL || op == LaneOp::JMP;
+    for_lanes(m_group, [&](LaneChunk& c, size_t i, uint8_t mask) {
+        c.pc[i] = select<uint16_t>(mask & !jumps, c.pc[i] + length, c.pc[i]);
+        c.cycles[i] += select<uint64_t>(mask, cycles + c.extra[i], 0);
+    });
+}
+
+void Lockstep::compare(uint8_t (LaneChunk::*reg)[LOCKSTEP_CHUNK]) {
+    for_lanes(m_group, [reg](LaneChunk& c, size_t i, uint8_t mask) {
+        uint8_t value = (c.*reg)[i];
+        uint8_t result = value - c.value[i];
+        uint8_t carry = value >= c.value[i];
+        c.nz[i] = select<uint16_t>(mask, result, c.nz[i]);
+        c.bits[i] = select<uint8_t>(mask, (c.bits[i] & ~0x01) | carry,
+                                    c.bits[i]);
+    });
+}
+
+void Lockstep::count(uint8_t (LaneChunk::*reg)[LOCKSTEP_CHUNK],
+                     uint8_t delta) {
+    for_lanes(m_group, [reg, delta](LaneChunk& c, size_t i, uint8_t mask) {
+        uint8_t result = (c.*reg)[i] + delta;
+        (c.*reg)[i] = select(mask, result, (c.*reg)[i]);
+        c.nz[i] = select<uint16_t>(mask, result, c.nz[i]);
+    });
+}
+
+void Lockstep::flag(uint8_t flag, bool set) {
+    uint8_t value = set ? flag : 0;
+    for_lanes(m_group, [flag, value](LaneChunk& c, size_t i, uint8_t mask) {
+        uint8_t result = (c.bits[i] & ~flag) | value;
+        c.bits[i] = select(mask, result, c.bits[i]);
+    });
+}
+
+void Lockstep::branch(uint8_t op_code, uint16_t operand) {
+    LaneOp op = lane_table[op_code].op;
+    // The tested flag in the NV1BDIZC layout, and whether it must be set.
+    uint8_t test = op == LaneOp::BCC || op == LaneOp::BCS   ? 0x01
+                   : op == LaneOp::BEQ || op == LaneOp::BNE ? 0x02
+                   : op == LaneOp::BMI || op == LaneOp::BPL ? 0x80
+                                                            : 0x40;
+    uint8_t expect = op == LaneOp::BCS || op == LaneOp::BEQ ||
+                     op == LaneOp::BMI || op == LaneOp::BVS;
+    for_lanes(m_group, [=](LaneChunk& c, size_t i, uint8_t mask) {
+        uint8_t flags = (c.bits[i] & 0x41) | ((c.nz[i] & 0xFF) == 0) << 1 |
+                        ((c.nz[i] & 0x180) != 0) << 7;
+        uint8_t taken = ((flags & test) != 0) == expect;
+        uint16_t fall = c.pc[i] + 2;
+        uint16_t target = fall + int8_t(operand);
+        uint8_t crossed = PAGE_OF(target) != PAGE_OF(fall);
+        c.extra[i] = select<uint8_t>(taken, 1 + crossed, 0);
+        c.pc[i] = select(mask, select(taken, target, fall), c.pc[i]);
+    });
+}
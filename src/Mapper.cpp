@@ -0,0 +1,77 @@
+#include <Mapper.h>
+#include <utils.h>
+
+#define CARTRIDGE_FIRST_PAGE 0x80
+#define CARTRIDGE_PAGE_COUNT 0x80
+
+/* Mapper */
+Mapper::Mapper(uint8_t* image, uint32_t image_size, uint32_t bank_size)
+    : m_memory(nullptr), m_image(image), m_bank_size(bank_size),
+      m_bank_count(bank_size ? image_size / bank_size : 0) {
+    ASSERT(image, "Mapper needs an image")
+    ASSERT(bank_size && bank_size % MEM_PAGE_SIZE == 0,
+           "Bank size must be a multiple of the page size")
+    ASSERT(image_size && image_size % bank_size == 0,
+           "Image size must be a multiple of the bank size")
+}
+
+void Mapper::SelectBank(uint8_t first_page, uint32_t bank) {
+    bank %= m_bank_count;
+    m_memory->MapBank(first_page, m_bank_size / MEM_PAGE_SIZE,
+                      m_image + bank * m_bank_size, PageKind::ROM, this);
+}
+
+/* UxROMMapper */
+UxROMMapper::UxROMMapper(uint8_t* image, uint32_t image_size)
+    : Mapper(image, image_size, 16 * 1024), m_bank(0) {}
+
+void UxROMMapper::Attach(Memory& memory) {
+    m_memory = &memory;
+    m_bank = 0;
+    SelectBank(CARTRIDGE_FIRST_PAGE, m_bank);
+    SelectBank(CARTRIDGE_FIRST_PAGE + CARTRIDGE_PAGE_COUNT / 2,
+               m_bank_count - 1);
+}
+
+// Only ROM pages are mapped to this device, so reads never get here.
+uint8_t UxROMMapper::Read(uint16_t address) { return m_memory->peek(address); }
+
+void UxROMMapper::Write(uint16_t, uint8_t data) {
+    m_bank = data % m_bank_count;
+    SelectBank(CARTRIDGE_FIRST_PAGE, m_bank);
+}
+
+/* WindowMapper */
+WindowMapper::WindowMapper(uint8_t* image, uint32_t image_size,
+                           uint8_t register_page)
+    : Mapper(image, image_size, 8 * 1024), m_register_page(register_page),
+      m_banks{0} {
+    ASSERT(register_page < CARTRIDGE_FIRST_PAGE,
+           "The register page would be covered by a window")
+}
+
+void WindowMapper::Attach(Memory& memory) {
+    m_memory = &memory;
+    m_memory->MapDevice(m_register_page, 1, this);
+    for (uint16_t window = 0; window < WINDOW_COUNT; window++) {
+        uint32_t bank = window + 1 < WINDOW_COUNT ? window : m_bank_count - 1;
+        Write(m_register_page * MEM_PAGE_SIZE + window, bank);
+    }
+}
+
+uint8_t WindowMapper::Read(uint16_t address) {
+    if (PAGE_OF(address) != m_register_page) {
+        return m_memory->peek(address);
+    }
+    return m_banks[address % WINDOW_COUNT];
+}
+
+void WindowMapper::Write(uint16_t address, uint8_t data) {
+    if (PAGE_OF(address) != m_register_page) {
+        return; // a write to one of the windows
+    }
+    uint16_t window = address % WINDOW_COUNT;
+    uint16_t window_pages = CARTRIDGE_PAGE_COUNT / WINDOW_COUNT;
+    m_banks[window] = data % m_bank_count;
+    SelectBank(CARTRIDGE_FIRST_PAGE + window * window_pages, m_banks[window]);
+}
@@ -0,0 +1,408 @@
+#include <Memory.h>
+#include <cstring>
+#include <utils.h>
+
+Memory::Storage Memory::s_zero_page{};
+std::atomic<uint64_t> Memory::s_next_id{1};
+// 0 is left for decoded instructions that were never filled.
+std::atomic<uint32_t> Memory::s_next_code_version{1};
+
+Memory::Memory()
+    : m_dirty_count(0), m_id(s_next_id.fetch_add(1)), m_baseline(0),
+      m_watch_pages() {
+    uint32_t version = s_next_code_version.fetch_add(1);
+    for (int page = 0; page < MEM_PAGE_COUNT; page++) {
+        m_pages[page] = {s_zero_page.data, &s_zero_page, nullptr,
+                         PageKind::RAM, false, false};
+        m_code_versions[page] = version;
+        refresh(page);
+    }
+}
+
+Memory::~Memory() {
+    for (auto& page : m_pages) {
+        release(page.storage);
+    }
+}
+
+std::shared_ptr<Memory> Memory::Clone() {
+    auto clone = std::make_shared<Memory>();
+    for (int page = 0; page < MEM_PAGE_COUNT; page++) {
+        clone->m_pages[page] = m_pages[page];
+        clone->m_pages[page].dirty = false;
+        clone->m_pages[page].code = false;
+        acquire(m_pages[page].storage);
+        // Both copies now share the storage, so neither may write it directly.
+        refresh(page);
+        clone->refresh(page);
+    }
+    reset_baseline(clone->m_id);
+    return clone;
+}
+
+void Memory::Restore(const Memory& snapshot) {
+    uint32_t version = s_next_code_version.fetch_add(1);
+    auto restore_page = [&](uint8_t page) {
+        Storage* storage = m_pages[page].storage;
+        m_pages[page] = snapshot.m_pages[page];
+        m_pages[page].dirty = false;
+        acquire(m_pages[page].storage);
+        release(storage);
+        renew_code_version(page, version);
+    };
+
+    if (snapshot.m_id == m_baseline) {
+        for (int i = 0; i < m_dirty_count; i++) {
+            restore_page(m_dirty_pages[i]);
+        }
+    } else {
+        for (int page = 0; page < MEM_PAGE_COUNT; page++) {
+            restore_page(page);
+        }
+    }
+    reset_baseline(snapshot.m_id);
+    m_id = s_next_id.fetch_add(1);
+}
+
+void Memory::write(uint16_t address, uint8_t* data, uint16_t size) {
+    uint32_t version = s_next_code_version.fetch_add(1);
+    for (int i = 0; i < size; i++) {
+        uint16_t target = address + i;
+        Page& page = m_pages[PAGE_OF(target)];
+        if (page.data == page.storage->data) {
+            own(PAGE_OF(target))[PAGE_OFFSET(target)] = data[i];
+        } else if (page.data != nullptr) {
+            page.data[PAGE_OFFSET(target)] = data[i];
+        }
+        renew_code_version(PAGE_OF(target), version);
+    }
+}
+
+uint8_t Memory::peek(uint16_t address) {
+    Page& page = m_pages[PAGE_OF(address)];
+    if (page.data != nullptr) {
+        return page.data[PAGE_OFFSET(address)];
+    }
+    return page.device->Peek(address);
+}
+
+void Memory::SetWatch(uint16_t address, uint8_t kinds) {
+    if (m_watch_bits == nullptr) {
+        m_watch_bits.reset(new uint64_t[WATCH_KINDS * MEM_SIZE / 64]());
+    }
+    for (int kind = 0; kind < WATCH_KINDS; kind++) {
+        if (GET_BIT(kinds, kind)) {
+            m_watch_bits[kind * (MEM_SIZE / 64) + address / 64] |=
+                uint64_t(1) << (address % 64);
+        }
+    }
+    update_watch(PAGE_OF(address));
+}
+
+void Memory::ClearWatch(uint16_t address, uint8_t kinds) {
+    if (m_watch_bits == nullptr) {
+        return;
+    }
+    for (int kind = 0; kind < WATCH_KINDS; kind++) {
+        if (GET_BIT(kinds, kind)) {
+            m_watch_bits[kind * (MEM_SIZE / 64) + address / 64] &=
+                ~(uint64_t(1) << (address % 64));
+        }
+    }
+    update_watch(PAGE_OF(address));
+}
+
+void Memory::MapRAM(uint8_t first_page, uint16_t page_count) {
+    map(first_page, page_count, PageKind::RAM, nullptr, nullptr);
+}
+
+void Memory::MapROM(uint8_t first_page, uint16_t page_count) {
+    map(first_page, page_count, PageKind::ROM, nullptr, nullptr);
+}
+
+void Memory::MapDevice(uint8_t first_page, uint16_t page_count,
+                       Device* device) {
+    ASSERT(device, "MapDevice needs a device")
+    map(first_page, page_count, PageKind::DEVICE, device, nullptr);
+}
+
+void Memory::MapBank(uint8_t first_page, uint16_t page_count, uint8_t* data,
+                     PageKind kind, Device* device) {
+    ASSERT(data, "MapBank needs backing storage")
+    ASSERT(kind != PageKind::DEVICE, "Banks are RAM or ROM")
+    ASSERT(kind == PageKind::ROM || !device, "Only ROM banks take a device")
+    map(first_page, page_count, kind, device, data);
+}
+
+void Memory::MapCopyOnWrite(uint8_t page, PageKind kind, const uint8_t* data,
+                            std::shared_ptr<const void> mapping) {
+    ASSERT(kind != PageKind::DEVICE, "Only RAM and ROM pages have storage")
+    Storage* storage = &s_zero_page;
+    if (data != nullptr) {
+        ASSERT(mapping, "MapCopyOnWrite needs the owner of data")
+        storage = new Storage;
+        // Never written through: is_private is false while mapping is set.
+        storage->data = const_cast<uint8_t*>(data);
+        storage->mapping = std::move(mapping);
+    }
+
+    release(m_pages[page].storage);
+    m_pages[page].storage = storage;
+    map(page, 1, kind, nullptr, nullptr);
+}
+
+const uint8_t* Memory::GetPageData(uint8_t page) const {
+    const Page& entry = m_pages[page];
+    return entry.data == entry.storage->data ? entry.data : nullptr;
+}
+
+bool Memory::SamePage(const Memory& other, uint8_t page) const {
+    const Page& mine = m_pages[page];
+    const Page& theirs = other.m_pages[page];
+    return mine.data == theirs.data && mine.storage == theirs.storage &&
+           mine.device == theirs.device && mine.kind == theirs.kind;
+}
+
+uint16_t Memory::CountPrivatePages() {
+    uint16_t count = 0;
+    for (int page = 0; page < MEM_PAGE_COUNT; page++) {
+        count += is_private(page);
+    }
+    return count;
+}
+
+Memory::Storage* Memory::acquire(Storage* storage) {
+    if (storage != &s_zero_page) {
+        storage->references.fetch_add(1, std::memory_order_relaxed);
+    }
+    return storage;
+}
+
+void Memory::release(Storage* storage) {
+    if (storage != &s_zero_page &&
+        storage->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete storage;
+    }
+}
+
+bool Memory::is_private(uint8_t page) {
+    Storage* storage = m_pages[page].storage;
+    return storage != &s_zero_page && storage->mapping == nullptr &&
+           storage->references.load(std::memory_order_acquire) == 1;
+}
+
+/**
+ * @brief Make the page's storage private, copying it if it is shared, and
+ * return it.
+ * */
+uint8_t* Memory::own(uint8_t page) {
+    Page& entry = m_pages[page];
+    mark_dirty(page);
+    m_id = s_next_id.fetch_add(1);
+    if (!is_private(page)) {
+        Storage* storage = new Storage;
+        memcpy(storage->data, entry.storage->data, MEM_PAGE_SIZE);
+
+        if (entry.data == entry.storage->data) {
+            entry.data = storage->data;
+        }
+        release(entry.storage);
+        entry.storage = storage;
+        refresh(page);
+    }
+    return entry.storage->data;
+}
+
+void Memory::mark_dirty(uint8_t page) {
+    if (!m_pages[page].dirty) {
+        m_pages[page].dirty = true;
+        m_dirty_pages[m_dirty_count++] = page;
+    }
+}
+
+void Memory::mark_code(uint8_t page) {
+    m_pages[page].code = true;
+    refresh(page);
+}
+
+void Memory::renew_code_version(uint8_t page, uint32_t version) {
+    m_code_versions[page] = version;
+    m_pages[page].code = false;
+    refresh(page);
+}
+
+void Memory::reset_baseline(uint64_t baseline) {
+    for (int i = 0; i < m_dirty_count; i++) {
+        m_pages[m_dirty_pages[i]].dirty = false;
+    }
+    m_dirty_count = 0;
+    m_baseline = baseline;
+}
+
+/**
+ * @brief Recompute page's Watch kinds from the bitmap and its pointers. The
+ * code versions of the page and the one before, whose last instruction may
+ * reach into it, are renewed so caches decode them with the watches.
+ * */
+void Memory::update_watch(uint8_t page) {
+    uint8_t kinds = 0;
+    for (int kind = 0; kind < WATCH_KINDS; kind++) {
+        for (int word = 0; word < MEM_PAGE_SIZE / 64; word++) {
+            if (watch_word(kind, page * MEM_PAGE_SIZE + word * 64) != 0) {
+                kinds |= 1 << kind;
+            }
+        }
+    }
+    m_watch_pages[page] = kinds;
+
+    uint32_t version = s_next_code_version.fetch_add(1);
+    renew_code_version(page, version);
+    renew_code_version(uint8_t(page - 1), version);
+}
+
+uint8_t Memory::slow_read(uint16_t address) {
+    Page& page = m_pages[PAGE_OF(address)];
+    if (UNLIKELY(watched(address, WATCH_READ))) {
+        m_watch_handler(address, WATCH_READ);
+    }
+    if (page.kind == PageKind::DEVICE) {
+        return page.device->Read(address);
+    }
+    return page.data[PAGE_OFFSET(address)];
+}
+
+uint8_t Memory::slow_fetch(uint16_t address) {
+    Page& page = m_pages[PAGE_OF(address)];
+    if (UNLIKELY(watched(address, WATCH_EXECUTE)) &&
+        m_watch_handler(address, WATCH_EXECUTE)) {
+        return WATCH_BREAK_OP_CODE;
+    }
+    if (page.kind == PageKind::DEVICE) {
+        return page.device->Read(address);
+    }
+    return page.data[PAGE_OFFSET(address)];
+}
+
+void Memory::slow_write(uint16_t address, uint8_t data) {
+    Page& page = m_pages[PAGE_OF(address)];
+    if (UNLIKELY(watched(address, WATCH_WRITE))) {
+        m_watch_handler(address, WATCH_WRITE);
+    }
+    if (page.code) {
+        renew_code_version(PAGE_OF(address), s_next_code_version.fetch_add(1));
+    }
+
+    if (page.kind == PageKind::RAM) {
+        // Shared pages are copied on their first write; external banks and
+        // code pages are written in place.
+        if (page.data == page.storage->data) {
+            own(PAGE_OF(address));
+        }
+        page.data[PAGE_OFFSET(address)] = data;
+    } else if (page.device != nullptr) {
+        page.device->Write(address, data);
+    }
+    // Other writes to ROM are dropped.
+}
+
+#if MEMORY_TRAMPOLINES
+
+uint8_t memory_slow_read(Memory* memory, uint16_t address) {
+    return memory->slow_read(address);
+}
+
+uint8_t memory_slow_fetch(Memory* memory, uint16_t address) {
+    return memory->slow_fetch(address);
+}
+
+void memory_slow_write(Memory* memory, uint16_t address, uint8_t data) {
+    memory->slow_write(address, data);
+}
+
+// Calls target with the arguments in place, saving the caller saved general
+// purpose registers other than rax and aligning the stack, which the caller
+// of name left anywhere below its red zone.
+#define TRAMPOLINE(name, target)                                               \
+    ".globl " #name "\n"                                                       \
+    ".hidden " #name "\n"                                                      \
+    ".type " #name ", @function\n"                                             \
+    ".p2align 4\n" #name ":\n"                                                 \
+    ".cfi_startproc\n"                                                         \
+    "push %rbp\n"                                                              \
+    ".cfi_def_cfa_offset 16\n"                                                 \
+    ".cfi_offset %rbp, -16\n"                                                  \
+    "mov %rsp, %rbp\n"                                                         \
+    ".cfi_def_cfa_register %rbp\n"                                             \
+    "push %rcx\n"                                                              \
+    "push %rdx\n"                                                              \
+    "push %rsi\n"                                                              \
+    "push %rdi\n"                                                              \
+    "push %r8\n"                                                               \
+    "push %r9\n"                                                               \
+    "push %r10\n"                                                              \
+    "push %r11\n"                                                              \
+    "and $-16, %rsp\n"                                                         \
+    "call " #target "\n"                                                       \
+    "lea -64(%rbp), %rsp\n"                                                    \
+    "pop %r11\n"                                                               \
+    "pop %r10\n"                                                               \
+    "pop %r9\n"                                                                \
+    "pop %r8\n"                                                                \
+    "pop %rdi\n"                                                               \
+    "pop %rsi\n"                                                               \
+    "pop %rdx\n"                                                               \
+    "pop %rcx\n"                                                               \
+    "pop %rbp\n"                                                               \
+    ".cfi_def_cfa %rsp, 8\n"                                                   \
+    "ret\n"                                                                    \
+    ".cfi_endproc\n"                                                           \
+    ".size " #name ", . - " #name "\n"
+
+asm(".text\n" TRAMPOLINE(memory_read_trampoline, memory_slow_read)
+        TRAMPOLINE(memory_fetch_trampoline, memory_slow_fetch)
+            TRAMPOLINE(memory_write_trampoline, memory_slow_write));
+
+#undef TRAMPOLINE
+
+#endif
+
+/**
+ * @brief data backs first_page, the following pages use the next
+ * MEM_PAGE_SIZE bytes each. With nullptr RAM and ROM pages map their own
+ * storage.
+ * */
+void Memory::map(uint8_t first_page, uint16_t page_count, PageKind kind,
+                 Device* device, uint8_t* data) {
+    ASSERT(first_page + page_count <= MEM_PAGE_COUNT,
+           "Mapping past the end of the address space")
+
+    m_id = s_next_id.fetch_add(1);
+    uint32_t version = s_next_code_version.fetch_add(1);
+    for (int page = first_page; page < first_page + page_count; page++) {
+        Page& entry = m_pages[page];
+        mark_dirty(page);
+        entry.kind = kind;
+        entry.device = device;
+        if (kind == PageKind::DEVICE) {
+            entry.data = nullptr;
+        } else if (data == nullptr) {
+            entry.data = entry.storage->data;
+        } else {
+            entry.data = data + (page - first_page) * MEM_PAGE_SIZE;
+        }
+        renew_code_version(page, version);
+    }
+}
+
+void Memory::refresh(uint8_t page) {
+    Page& entry = m_pages[page];
+    bool writable = entry.data != entry.storage->data || is_private(page);
+    uint8_t watch = m_watch_pages[page];
+    const uint8_t* data = entry.kind == PageKind::DEVICE ? nullptr : entry.data;
+    m_read[page] = watch & WATCH_READ ? nullptr : data;
+    m_fetch[page] = watch & (WATCH_READ | WATCH_EXECUTE) ? nullptr : data;
+    m_write[page] = entry.kind == PageKind::RAM && writable && !entry.code &&
+                            !(watch & WATCH_WRITE)
+                        ? entry.data
+                        : nullptr;
+}
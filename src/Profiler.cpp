@@ -0,0 +1,299 @@
+#include <Profiler.h>
+#include <algorithm>
+#include <instructions.h>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+
+/**
+ * @brief The op_code's name, or its hex value when it is not an instruction.
+ * */
+static std::string name_of(uint8_t op_code) {
+    std::string name = ToString(static_cast<Instruction>(op_code));
+    if (name.empty()) {
+        std::ostringstream hex;
+        hex << "OP_" << std::hex << std::uppercase << std::setw(2)
+            << std::setfill('0') << int(op_code);
+        name = hex.str();
+    }
+    return name;
+}
+
+/**
+ * @brief start_8000, sub_8123 or int_9000 for a key of routine_totals.
+ * */
+static std::string routine_name(uint32_t key) {
+    static const char* const prefixes[] = {"start_", "sub_", "int_"};
+    std::ostringstream name;
+    name << prefixes[key >> 16] << std::hex << std::uppercase
+         << std::setw(4) << std::setfill('0') << (key & 0xFFFF);
+    return name.str();
+}
+
+Profiler::Profiler()
+    : m_pc_cycles(MEM_SIZE + 1), m_op_codes(MEM_SIZE) {
+    std::fill(std::begin(m_moves_stack), std::end(m_moves_stack), false);
+    m_moves_stack[Instruction::JSR] = true;
+    m_moves_stack[Instruction::RTS] = true;
+    m_moves_stack[Instruction::RTI] = true;
+    m_moves_stack[Instruction::TXS] = true;
+    m_moves_stack[STACK_START] = true;
+    Reset();
+}
+
+void Profiler::Reset() {
+    std::fill(m_pc_cycles.begin(), m_pc_cycles.end(), 0);
+    std::fill(m_op_codes.begin(), m_op_codes.end(), 0);
+    std::fill(std::begin(m_op_cycles), std::end(m_op_cycles), 0);
+    std::fill(std::begin(m_op_counts), std::end(m_op_counts), 0);
+
+    // Until the first instruction names it, the outermost frame collects the
+    // time before it. Its SP is above the stack page, so nothing pops it.
+    m_stack_op = STACK_START;
+    m_interrupt_sp = -1;
+    m_nodes = {{NO_NODE, 0, FrameKind::START, 0, 0}};
+    m_children.clear();
+    m_frames = {{0, 0x100}};
+    Begin(0);
+}
+
+void Profiler::follow(uint16_t pc, uint8_t sp) {
+    switch (m_stack_op) {
+    case STACK_START:
+        m_nodes[0].routine = pc;
+        m_nodes[0].calls = 1;
+        m_children[uint64_t(NO_NODE) << 32 | pc] = 0;
+        break;
+    case Instruction::JSR:
+        push(pc, sp, FrameKind::CALL);
+        break;
+    case Instruction::RTS:
+    case Instruction::RTI:
+    case Instruction::TXS: {
+        size_t depth = m_frames.size();
+        while (m_frames.size() > 1 && sp > m_frames.back().sp) {
+            m_frames.pop_back();
+        }
+        if (m_stack_op != Instruction::TXS && m_frames.size() == depth) {
+            // Returned to an address pushed by the routine itself.
+            Frame& top = m_frames.back();
+            const CallNode& node = m_nodes[top.node];
+            top.node = node_of(node.parent, pc, node.kind);
+            m_nodes[top.node].calls++;
+        }
+        break;
+    }
+    }
+    m_stack_op = STACK_FOLLOWED;
+
+    if (m_interrupt_sp >= 0) {
+        push(pc, m_interrupt_sp, FrameKind::INTERRUPT);
+        m_interrupt_sp = -1;
+    }
+}
+
+uint32_t Profiler::node_of(uint32_t parent, uint16_t routine,
+                           FrameKind kind) {
+    uint64_t key = uint64_t(parent) << 32 | uint32_t(kind) << 16 | routine;
+    auto [it, added] = m_children.emplace(key, uint32_t(m_nodes.size()));
+    if (added) {
+        m_nodes.push_back({parent, routine, kind, 0, 0});
+    }
+    return it->second;
+}
+
+void Profiler::push(uint16_t routine, int sp, FrameKind kind) {
+    uint32_t node = node_of(m_frames.back().node, routine, kind);
+    m_nodes[node].calls++;
+    m_frames.push_back({node, sp});
+}
+
+std::map<uint32_t, Profiler::RoutineTotals> Profiler::routine_totals() {
+    auto key_of = [&](uint32_t node) {
+        return uint32_t(m_nodes[node].kind) << 16 | m_nodes[node].routine;
+    };
+
+    // Callees come after their callers, so a backward pass adds up every
+    // subtree.
+    std::vector<uint64_t> subtree(m_nodes.size());
+    for (size_t i = m_nodes.size(); i-- > 0;) {
+        subtree[i] += m_nodes[i].cycles;
+        if (m_nodes[i].parent != NO_NODE) {
+            subtree[m_nodes[i].parent] += subtree[i];
+        }
+    }
+
+    std::map<uint32_t, RoutineTotals> totals;
+    for (uint32_t i = 0; i < m_nodes.size(); i++) {
+        RoutineTotals& routine = totals[key_of(i)];
+        routine.exclusive += m_nodes[i].cycles;
+        routine.calls += m_nodes[i].calls;
+
+        // A recursive call is already part of its outer call.
+        bool outermost = true;
+        for (uint32_t caller = m_nodes[i].parent; caller != NO_NODE;
+             caller = m_nodes[caller].parent) {
+            outermost &= key_of(caller) != key_of(i);
+        }
+        if (outermost) {
+            routine.inclusive += subtree[i];
+        }
+    }
+    return totals;
+}
+
+uint64_t Profiler::GetInclusiveCycles(uint16_t routine) {
+    uint64_t cycles = 0;
+    for (auto& [key, totals] : routine_totals()) {
+        cycles += (key & 0xFFFF) == routine ? totals.inclusive : 0;
+    }
+    return cycles;
+}
+
+uint64_t Profiler::GetExclusiveCycles(uint16_t routine) {
+    uint64_t cycles = 0;
+    for (auto& [key, totals] : routine_totals()) {
+        cycles += (key & 0xFFFF) == routine ? totals.exclusive : 0;
+    }
+    return cycles;
+}
+
+uint64_t Profiler::GetCallCount(uint16_t routine) {
+    uint64_t calls = 0;
+    for (auto& [key, totals] : routine_totals()) {
+        calls += (key & 0xFFFF) == routine ? totals.calls : 0;
+    }
+    return calls;
+}
+
+std::vector<std::string> Profiler::GetCallStack() {
+    std::vector<std::string> names;
+    for (const Frame& frame : m_frames) {
+        const CallNode& node = m_nodes[frame.node];
+        names.push_back(
+            routine_name(uint32_t(node.kind) << 16 | node.routine));
+    }
+    return names;
+}
+
+uint64_t Profiler::GetTotalCycles() {
+    uint64_t total = 0;
+    for (int op_code = 0; op_code < 256; op_code++) {
+        total += m_op_cycles[op_code];
+    }
+    return total;
+}
+
+void Profiler::WriteHotspots(std::ostream& out, size_t top) {
+    std::vector<uint32_t> pcs;
+    for (uint32_t pc = 0; pc < MEM_SIZE; pc++) {
+        if (m_pc_cycles[pc] != 0) {
+            pcs.push_back(pc);
+        }
+    }
+    std::stable_sort(pcs.begin(), pcs.end(), [&](uint32_t a, uint32_t b) {
+        return m_pc_cycles[a] > m_pc_cycles[b];
+    });
+    pcs.resize(std::min(pcs.size(), top));
+
+    std::ios format(nullptr);
+    format.copyfmt(out);
+    double total = std::max<uint64_t>(GetTotalCycles(), 1);
+    out << "    pc         cycles   share  instruction\n";
+    out << std::uppercase << std::fixed << std::setprecision(2);
+    for (uint32_t pc : pcs) {
+        out << "0x" << std::hex << std::setw(4) << std::setfill('0') << pc
+            << std::dec << std::setfill(' ') << std::setw(15)
+            << m_pc_cycles[pc] << std::setw(7)
+            << 100 * m_pc_cycles[pc] / total << "%  "
+            << name_of(m_op_codes[pc]) << "\n";
+    }
+    out.copyfmt(format);
+}
+
+void Profiler::WriteOpCodes(std::ostream& out) {
+    std::vector<int> op_codes;
+    for (int op_code = 0; op_code < 256; op_code++) {
+        if (m_op_counts[op_code] != 0) {
+            op_codes.push_back(op_code);
+        }
+    }
+    std::stable_sort(op_codes.begin(), op_codes.end(), [&](int a, int b) {
+        return m_op_cycles[a] > m_op_cycles[b];
+    });
+
+    std::ios format(nullptr);
+    format.copyfmt(out);
+    double total = std::max<uint64_t>(GetTotalCycles(), 1);
+    out << "instruction         count         cycles  cycles/inst   share\n";
+    out << std::fixed << std::setprecision(2);
+    for (int op_code : op_codes) {
+        out << std::left << std::setw(10) << name_of(op_code) << std::right
+            << std::setw(12) << m_op_counts[op_code] << std::setw(15)
+            << m_op_cycles[op_code] << std::setw(13)
+            << double(m_op_cycles[op_code]) / m_op_counts[op_code]
+            << std::setw(7) << 100 * m_op_cycles[op_code] / total << "%\n";
+    }
+    out.copyfmt(format);
+}
+
+void Profiler::WriteFlameGraph(std::ostream& out) {
+    std::ios format(nullptr);
+    format.copyfmt(out);
+    out << std::uppercase << std::setfill('0');
+    for (uint32_t pc = 0; pc < MEM_SIZE; pc++) {
+        if (m_pc_cycles[pc] != 0) {
+            out << "page_" << std::hex << std::setw(2) << int(PAGE_OF(pc))
+                << ";" << std::setw(4) << pc << "_" << name_of(m_op_codes[pc])
+                << " " << std::dec << m_pc_cycles[pc] << "\n";
+        }
+    }
+    out.copyfmt(format);
+}
+
+void Profiler::WriteRoutines(std::ostream& out) {
+    auto totals = routine_totals();
+    std::vector<std::pair<uint32_t, RoutineTotals>> routines(totals.begin(),
+                                                             totals.end());
+    std::stable_sort(routines.begin(), routines.end(),
+                     [](const auto& a, const auto& b) {
+                         return a.second.inclusive > b.second.inclusive;
+                     });
+
+    std::ios format(nullptr);
+    format.copyfmt(out);
+    double total = std::max<uint64_t>(GetTotalCycles(), 1);
+    out << "routine         calls      inclusive   share      exclusive   "
+           "share\n";
+    out << std::fixed << std::setprecision(2);
+    for (auto& [key, routine] : routines) {
+        if (routine.calls == 0) {
+            continue;
+        }
+        out << std::left << std::setw(10) << routine_name(key) << std::right
+            << std::setw(11) << routine.calls << std::setw(15)
+            << routine.inclusive << std::setw(7)
+            << 100 * routine.inclusive / total << "%" << std::setw(15)
+            << routine.exclusive << std::setw(7)
+            << 100 * routine.exclusive / total << "%\n";
+    }
+    out.copyfmt(format);
+}
+
+void Profiler::WriteCallStacks(std::ostream& out) {
+    for (uint32_t i = 0; i < m_nodes.size(); i++) {
+        if (m_nodes[i].cycles == 0) {
+            continue;
+        }
+        std::vector<std::string> names;
+        for (uint32_t node = i; node != NO_NODE; node = m_nodes[node].parent) {
+            names.push_back(routine_name(uint32_t(m_nodes[node].kind) << 16 |
+                                         m_nodes[node].routine));
+        }
+        std::string stack;
+        for (size_t j = names.size(); j-- > 0;) {
+            stack += names[j] + (j > 0 ? ";" : "");
+        }
+        out << stack << " " << m_nodes[i].cycles << "\n";
+    }
+}
@@ -0,0 +1,43 @@
+#include <RomImage.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utils.h>
+
+RomImage::RomImage(const std::string& path) : m_data(nullptr), m_size(0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* data =
+            mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            m_data = static_cast<uint8_t*>(data);
+            m_size = info.st_size;
+        }
+    }
+
+    // The mapping keeps the file alive.
+    close(fd);
+}
+
+RomImage::~RomImage() {
+    if (m_data != nullptr) {
+        munmap(m_data, m_size);
+    }
+}
+
+void RomImage::Map(Memory& memory, uint16_t address) {
+    ASSERT(IsOpen(), "The image is not open")
+    ASSERT(PAGE_OFFSET(address) == 0, "ROM images are mapped on whole pages")
+    ASSERT(Fits(address), "The image doesn't fit in the address space")
+
+    // mmap zero fills the last OS page past the end of the file, and OS
+    // pages are a multiple of MEM_PAGE_SIZE, so the last page is readable.
+    uint16_t page_count = (m_size + MEM_PAGE_SIZE - 1) / MEM_PAGE_SIZE;
+    memory.MapBank(PAGE_OF(address), page_count, m_data, PageKind::ROM);
+}
@@ -0,0 +1,34 @@
+#include <Scheduler.h>
+#include <algorithm>
+
+uint64_t Scheduler::Schedule(uint64_t cycle, event_func_t callback) {
+    uint64_t id = m_next_id++;
+    m_heap.push_back({cycle, id, std::move(callback)});
+    std::push_heap(m_heap.begin(), m_heap.end());
+    return id;
+}
+
+bool Scheduler::Cancel(uint64_t id) {
+    auto event = std::find_if(m_heap.begin(), m_heap.end(),
+                              [id](const Event& e) { return e.id == id; });
+    if (event == m_heap.end()) {
+        return false;
+    }
+
+    // Cancelling is rare, so rebuilding the heap is fine.
+    std::iter_swap(event, m_heap.end() - 1);
+    m_heap.pop_back();
+    std::make_heap(m_heap.begin(), m_heap.end());
+    return true;
+}
+
+bool Scheduler::PopDue(uint64_t now, event_func_t& callback) {
+    if (m_heap.empty() || m_heap.front().cycle > now) {
+        return false;
+    }
+
+    std::pop_heap(m_heap.begin(), m_heap.end());
+    callback = std::move(m_heap.back().callback);
+    m_heap.pop_back();
+    return true;
+}
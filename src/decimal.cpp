@@ -0,0 +1,58 @@
+#include <decimal.h>
+#include <utils.h>
+
+DecimalResult decimal_adc[2][256][256];
+DecimalResult decimal_sbc[2][256][256];
+
+static uint8_t pack_flags(bool n, bool v, bool z, bool c) {
+    return n << 7 | v << 6 | z << 1 | c;
+}
+
+static DecimalResult adc(uint8_t a, uint8_t b, bool carry) {
+    int low = (a & 0x0F) + (b & 0x0F) + carry;
+    if (low >= 0x0A) {
+        low = ((low + 0x06) & 0x0F) + 0x10;
+    }
+
+    int sum = (a & 0xF0) + (b & 0xF0) + low;
+    int signed_sum = (int8_t)(a & 0xF0) + (int8_t)(b & 0xF0) + low;
+    bool n = SIGN_BIT(signed_sum);
+    bool v = signed_sum < -128 || signed_sum > 127;
+    bool z = ((a + b + carry) & 0xFF) == 0;
+
+    if (sum >= 0xA0) {
+        sum += 0x60;
+    }
+    return {(uint8_t)sum, pack_flags(n, v, z, sum >= 0x100)};
+}
+
+static DecimalResult sbc(uint8_t a, uint8_t b, bool carry) {
+    int low = (a & 0x0F) - (b & 0x0F) + carry - 1;
+    if (low < 0) {
+        low = ((low - 0x06) & 0x0F) - 0x10;
+    }
+
+    int difference = (a & 0xF0) - (b & 0xF0) + low;
+    if (difference < 0) {
+        difference -= 0x60;
+    }
+
+    int binary = a - b - !carry;
+    bool v = ((a ^ b) & (a ^ binary) & 0x80) != 0;
+    return {(uint8_t)difference, pack_flags(SIGN_BIT(binary), v,
+                                            (binary & 0xFF) == 0, binary >= 0)};
+}
+
+static bool build_tables() {
+    for (int carry = 0; carry < 2; carry++) {
+        for (int a = 0; a < 256; a++) {
+            for (int b = 0; b < 256; b++) {
+                decimal_adc[carry][a][b] = adc(a, b, carry);
+                decimal_sbc[carry][a][b] = sbc(a, b, carry);
+            }
+        }
+    }
+    return true;
+}
+
+static bool built = build_tables();
@@ -0,0 +1,57 @@
+#include <CPU.h>
+#include <dispatch.h>
+#include <handlers.h>
+#include <trace.h>
+
+#if defined(__GNUC__)
+
+/**
+ * Direct-threaded interpreter: every op_code gets its own label holding the
+ * inlined handler followed by its own copy of the dispatch code, so the
+ * indirect jump to the next handler is predicted per op_code instead of
+ * sharing one call site in a loop.
+ * */
+
+#define DISPATCH()                                                             \
+    if (!Running()) {                                                          \
+        return;                                                                \
+    }                                                                          \
+    if constexpr (TRACE) {                                                     \
+        trace_instruction();                                                   \
+    }                                                                          \
+    op_code = FetchOpCode();                                                   \
+    goto* labels[op_code]
+
+#define HANDLER(op)                                                            \
+    op_##op : {                                                                \
+        constexpr inst_func_t handler = handlers[op];                          \
+        handler(*this, op);                                                    \
+    }                                                                          \
+    DISPATCH();
+
+template <bool TRACE> void CPU::ExecuteThreaded() {
+    static constexpr dispatch_table_t handlers = make_isa_table();
+    static const void* const labels[256] = {OP_ALL(LABEL_ADDRESS)};
+
+    uint8_t op_code;
+
+    DISPATCH();
+    OP_ALL(HANDLER)
+}
+
+template void CPU::ExecuteThreaded<true>();
+template void CPU::ExecuteThreaded<false>();
+
+#undef HANDLER
+#undef DISPATCH
+
+#else
+
+template <bool TRACE> void CPU::ExecuteThreaded() {
+    ExecuteTable<TRACE>();
+}
+
+template void CPU::ExecuteThreaded<true>();
+template void CPU::ExecuteThreaded<false>();
+
+#endif
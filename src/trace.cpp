@@ -0,0 +1,144 @@
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <instructions.h>
+#include <trace.h>
+
+TraceRecord MakeTraceRecord(CPU& cpu) {
+    TraceRecord record;
+    record.cycle = cpu.GetCycles();
+    record.pc = cpu.PC;
+    record.op_code = cpu.Peek(cpu.PC);
+    record.ac = cpu.AC;
+    record.x = cpu.X;
+    record.y = cpu.Y;
+    record.sp = cpu.SP;
+    record.sr = cpu.SR.Value();
+    return record;
+}
+
+void FormatTraceRecord(std::ostream& out, const TraceRecord& record) {
+    using namespace std;
+
+    out << left << hex << uppercase;
+    out << "0x" << setw(4) << int(record.pc) << ": 0x" << setw(2)
+        << int(record.op_code);
+    out << " " << setw(9) << ToString(static_cast<Instruction>(record.op_code));
+
+    out << "[A: 0x" << setw(2) << int(record.ac);
+    out << ", X: 0x" << setw(2) << int(record.x);
+    out << ", Y: 0x" << setw(2) << int(record.y);
+    out << ", SP: 0x" << setw(2) << int(record.sp);
+    out << ", SR(NV_BDIZC): 0b";
+    for (int bit = 7; bit >= 0; bit--) {
+        out << GET_BIT(record.sr, bit);
+    }
+    out << "]";
+    out << nouppercase << dec << internal;
+
+    out << " " << record.cycle << "\n";
+}
+
+void TextTraceSink::Trace(CPU& cpu) {
+    FormatTraceRecord(m_out, MakeTraceRecord(cpu));
+}
+
+/* BinaryTraceSink */
+BinaryTraceSink::BinaryTraceSink(const std::string& path, size_t capacity)
+    : m_local_head(0), m_tail_cache(0), m_head(0), m_tail(0), m_stop(false),
+      m_file(fopen(path.c_str(), "wb")) {
+    size_t size = TRACE_PUBLISH_MASK + 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    m_ring.resize(size);
+    m_mask = size - 1;
+
+    if (m_file == nullptr) {
+        return;
+    }
+
+    TraceFileHeader header = {};
+    memcpy(header.magic, TRACE_FILE_MAGIC, sizeof(TRACE_FILE_MAGIC));
+    header.version = TRACE_FILE_VERSION;
+    header.record_size = sizeof(TraceRecord);
+    fwrite(&header, sizeof(header), 1, m_file);
+
+    m_writer = std::thread(&BinaryTraceSink::Drain, this);
+}
+
+BinaryTraceSink::~BinaryTraceSink() {
+    if (m_file == nullptr) {
+        return;
+    }
+
+    Publish();
+    m_stop.store(true, std::memory_order_release);
+    m_writer.join();
+    fclose(m_file);
+}
+
+void BinaryTraceSink::Trace(CPU& cpu) {
+    if (m_file == nullptr) {
+        return;
+    }
+
+    size_t head = m_local_head;
+    while (head - m_tail_cache > m_mask) {
+        Publish();
+        m_tail_cache = m_tail.load(std::memory_order_acquire);
+        if (head - m_tail_cache > m_mask) {
+            std::this_thread::yield();
+        }
+    }
+
+    m_ring[head & m_mask] = MakeTraceRecord(cpu);
+    m_local_head = head + 1;
+
+    // Publishing every record would bounce m_head's cache line between the
+    // CPU and writer threads on every instruction.
+    if ((m_local_head & TRACE_PUBLISH_MASK) == 0) {
+        Publish();
+    }
+}
+
+void BinaryTraceSink::Publish() {
+    m_head.store(m_local_head, std::memory_order_release);
+}
+
+void BinaryTraceSink::Flush() {
+    if (m_file == nullptr) {
+        return;
+    }
+
+    Publish();
+    while (m_tail.load(std::memory_order_acquire) != m_local_head) {
+        std::this_thread::yield();
+    }
+    fflush(m_file);
+}
+
+void BinaryTraceSink::Drain() {
+    for (;;) {
+        bool stop = m_stop.load(std::memory_order_acquire);
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t head = m_head.load(std::memory_order_acquire);
+
+        if (tail == head) {
+            if (stop) {
+                break;
+            }
+            fflush(m_file);
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            continue;
+        }
+
+        // Write up to the end of the ring, the wrapped part goes next round.
+        size_t begin = tail & m_mask;
+        size_t count = std::min(head - tail, m_ring.size() - begin);
+        fwrite(&m_ring[begin], sizeof(TraceRecord), count, m_file);
+        m_tail.store(tail + count, std::memory_order_release);
+    }
+
+    fflush(m_file);
+}
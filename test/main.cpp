@@ -1,6 +1,21 @@
+#include <CPU.h>
+#include <cstring>
 #include <gtest/gtest.h>
 
 int main(int argc, char** argv) {
     testing::InitGoogleTest(&argc, argv);
+
+    // --engine=threaded, --engine=predecoded or --engine=jit runs the whole
+    // suite on that engine.
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--engine=threaded") == 0) {
+            CPU::SetDefaultEngine(Engine::Threaded);
+        } else if (strcmp(argv[i], "--engine=predecoded") == 0) {
+            CPU::SetDefaultEngine(Engine::Predecoded);
+        } else if (strcmp(argv[i], "--engine=jit") == 0) {
+            CPU::SetDefaultEngine(Engine::Jit);
+        }
+    }
+
     return RUN_ALL_TESTS();
-}
\ No newline at end of file
+}
@@ -0,0 +1,178 @@
+#include <BatchRunner.h>
+#include <CPU.h>
+#include <Checkpoint.h>
+#include <RomImage.h>
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <instructions.h>
+#include <sstream>
+#include <unistd.h>
+
+// Unique per process and test, as ctest runs this binary once per engine at
+// the same time.
+static std::string temp_path(const char* name) {
+    const testing::TestInfo* test =
+        testing::UnitTest::GetInstance()->current_test_info();
+    return testing::TempDir() + std::to_string(getpid()) + "_" +
+           test->name() + "_" + name;
+}
+
+static std::string write_rom(const char* name, const uint8_t* data,
+                             size_t size) {
+    std::string path = temp_path(name);
+    FILE* file = fopen(path.c_str(), "wb");
+    fwrite(data, 1, size, file);
+    fclose(file);
+    return path;
+}
+
+// loop: INX; STX $0200; INC $0300,X; JMP loop
+static uint8_t counter[] = {Instruction::INX,      Instruction::STX_ABS,
+                            0x00,                  0x02,
+                            Instruction::INC_ABSX, 0x00,
+                            0x03,                  Instruction::JMP_ABS,
+                            0x00,                  0x80};
+
+// LDA #$42; ADC #$01; then an unknown op_code
+static uint8_t trapping[] = {Instruction::LDA_IMM, 0x42, Instruction::ADC_IMM,
+                             0x01, 0x02};
+
+/**
+ * @brief What a lone CPU ends with when it runs job.
+ * */
+static BatchResult run_alone(const BatchJob& job) {
+    RomImage rom(job.rom);
+    BatchResult result = {};
+    if (!rom.IsOpen()) {
+        result.status = BatchStatus::Failed;
+        return result;
+    }
+    CPU cpu(rom);
+    if (!job.checkpoints.empty() && !LoadCheckpoint(cpu, job.checkpoints)) {
+        result.status = BatchStatus::Failed;
+        return result;
+    }
+    uint64_t start = cpu.GetCycles();
+    cpu.Run(job.cycle_budget);
+    result.status =
+        cpu.IsTrapped() ? BatchStatus::Trapped : BatchStatus::Finished;
+    result.cycles = cpu.GetCycles() - start;
+    result.PC = cpu.PC;
+    result.AC = cpu.AC;
+    result.X = cpu.X;
+    result.Y = cpu.Y;
+    result.SP = cpu.SP;
+    result.SR = cpu.SR.Value();
+    return result;
+}
+
+TEST(BatchTestSuite, ParseManifest) {
+    std::istringstream manifest("# rom budget checkpoints\n"
+                                "\n"
+                                "a.bin 1000\n"
+                                "  /roms/b.bin 25 s0.ckp s1.ckp # note\n");
+    std::vector<BatchJob> jobs;
+    std::string error;
+    ASSERT_TRUE(ParseManifest(manifest, "dir", jobs, error)) << error;
+    ASSERT_EQ(jobs.size(), 2u);
+    EXPECT_EQ(jobs[0].rom, "dir/a.bin");
+    EXPECT_EQ(jobs[0].cycle_budget, 1000u);
+    EXPECT_TRUE(jobs[0].checkpoints.empty());
+    EXPECT_EQ(jobs[1].rom, "/roms/b.bin");
+    EXPECT_EQ(jobs[1].cycle_budget, 25u);
+    ASSERT_EQ(jobs[1].checkpoints.size(), 2u);
+    EXPECT_EQ(jobs[1].checkpoints[1], "dir/s1.ckp");
+
+    std::istringstream broken("a.bin 10\nb.bin -5\n");
+    EXPECT_FALSE(ParseManifest(broken, "", jobs, error));
+    EXPECT_NE(error.find("Line 2"), std::string::npos) << error;
+}
+
+TEST(BatchTestSuite, MatchesLoneCPUs) {
+    std::string counter_rom =
+        write_rom("batch_counter.bin", counter, sizeof(counter));
+    std::string trapping_rom =
+        write_rom("batch_trapping.bin", trapping, sizeof(trapping));
+    std::string checkpoint = temp_path("batch_counter.ckp");
+    {
+        RomImage rom(counter_rom);
+        CPU cpu(rom);
+        cpu.Run(777);
+        CheckpointWriter writer;
+        ASSERT_TRUE(writer.Write(cpu, checkpoint));
+    }
+
+    // Runs of the same state next to each other and apart, so workers both
+    // reuse and reload their CPUs.
+    std::vector<BatchJob> jobs;
+    for (uint64_t i = 0; i < 60; i++) {
+        switch (i % 7) {
+        case 0:
+        case 1:
+        case 2:
+            jobs.push_back({counter_rom, {}, 100 + i * 37});
+            break;
+        case 3:
+        case 4:
+            jobs.push_back({counter_rom, {checkpoint}, 50 + i * 11});
+            break;
+        case 5:
+            jobs.push_back({trapping_rom, {}, 1000});
+            break;
+        default:
+            jobs.push_back({i % 2 ? temp_path("no_such_rom.bin") : counter_rom,
+                            {temp_path("no_such.ckp")},
+                            10});
+            break;
+        }
+    }
+
+    BatchRunner runner(4, false);
+    ASSERT_EQ(runner.GetWorkerCount(), 4u);
+    for (int batch = 0; batch < 2; batch++) {
+        std::vector<BatchResult> results = runner.Run(jobs);
+        ASSERT_EQ(results.size(), jobs.size());
+        for (size_t i = 0; i < jobs.size(); i++) {
+            SCOPED_TRACE(i);
+            BatchResult expected = run_alone(jobs[i]);
+            EXPECT_EQ(results[i].status, expected.status);
+            EXPECT_LT(results[i].worker, 4u);
+            if (expected.status == BatchStatus::Failed) {
+                EXPECT_FALSE(results[i].error.empty());
+                continue;
+            }
+            EXPECT_EQ(results[i].cycles, expected.cycles);
+            EXPECT_EQ(results[i].PC, expected.PC);
+            EXPECT_EQ(results[i].AC, expected.AC);
+            EXPECT_EQ(results[i].X, expected.X);
+            EXPECT_EQ(results[i].Y, expected.Y);
+            EXPECT_EQ(results[i].SP, expected.SP);
+            EXPECT_EQ(results[i].SR, expected.SR);
+        }
+
+        std::ostringstream output;
+        WriteResults(output, jobs, results);
+        std::string first = output.str().substr(0, output.str().find('\n'));
+        EXPECT_EQ(first.find("{\"job\":0,\"rom\":\"" + counter_rom +
+                             "\",\"status\":\"finished\",\"cycles\":"),
+                  0u)
+            << first;
+    }
+}
+
+TEST(BatchTestSuite, OversizedROM) {
+    // One byte past the end of the address space when mapped at 0x8000.
+    std::vector<uint8_t> image(MEM_SIZE - 0x8000 + 1, Instruction::NOP);
+    std::string oversized =
+        write_rom("batch_oversized.bin", image.data(), image.size());
+    std::string counter_rom =
+        write_rom("batch_counter.bin", counter, sizeof(counter));
+
+    BatchRunner runner(2, false);
+    std::vector<BatchResult> results =
+        runner.Run({{oversized, {}, 100}, {counter_rom, {}, 100}});
+    ASSERT_EQ(results.size(), 2u);
+    EXPECT_EQ(results[0].status, BatchStatus::Failed);
+    EXPECT_NE(results[0].error.find(oversized), std::string::npos);
+    EXPECT_EQ(results[1].status, BatchStatus::Finished);
+}
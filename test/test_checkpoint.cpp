@@ -0,0 +1,100 @@
+#include <Checkpoint.h>
+#include <CPU.h>
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <instructions.h>
+#include <unistd.h>
+
+// Unique per process and test, as ctest runs this binary once per engine at
+// the same time.
+static std::string temp_path(const char* name) {
+    const testing::TestInfo* test =
+        testing::UnitTest::GetInstance()->current_test_info();
+    return testing::TempDir() + std::to_string(getpid()) + "_" +
+           test->name() + "_" + name;
+}
+
+static long file_size(const std::string& path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    return size;
+}
+
+// loop: INC $0300,X; DEX; BNE loop
+static uint8_t program[] = {Instruction::INC_ABSX, 0x00, 0x03,
+                            Instruction::DEX, Instruction::BNE, 0xFA};
+
+static void expect_same(CPU& expected, CPU& actual) {
+    EXPECT_EQ(actual.PC, expected.PC);
+    EXPECT_EQ(actual.AC, expected.AC);
+    EXPECT_EQ(actual.X, expected.X);
+    EXPECT_EQ(actual.Y, expected.Y);
+    EXPECT_EQ(actual.SP, expected.SP);
+    EXPECT_EQ(actual.SR.Z, expected.SR.Z);
+    EXPECT_EQ(actual.SR.N, expected.SR.N);
+    EXPECT_EQ(actual.GetCycles(), expected.GetCycles());
+    for (int address = 0; address < MEM_SIZE; address++) {
+        ASSERT_EQ(actual.Peek(address), expected.Peek(address)) << address;
+    }
+}
+
+TEST(CheckpointTestSuite, FullAndIncremental) {
+    std::string full = temp_path("checkpoint_full.bin");
+    std::string increment = temp_path("checkpoint_increment.bin");
+
+    CPU cpu(program, sizeof(program));
+    CheckpointWriter writer;
+    cpu.Run(100);
+    ASSERT_TRUE(writer.Write(cpu, full));
+
+    // Writes to the stack page only.
+    cpu.GetMemory().write(0x01FF, 0x42);
+    ASSERT_TRUE(writer.Write(cpu, increment));
+    EXPECT_EQ(writer.GetSequence(), 2u);
+
+    // Program, vectors and the counters of page 3.
+    EXPECT_EQ(file_size(full), CHECKPOINT_DATA_OFFSET + 3 * MEM_PAGE_SIZE);
+    EXPECT_EQ(file_size(increment), CHECKPOINT_DATA_OFFSET + MEM_PAGE_SIZE);
+
+    CPU restored(program, sizeof(program));
+    restored.GetMemory().write(0x4000, 0x99);
+    ASSERT_TRUE(LoadCheckpoint(restored, {full, increment}));
+    expect_same(cpu, restored);
+    EXPECT_EQ(restored.GetMemory().CountPrivatePages(), 0);
+
+    cpu.Run(4000);
+    restored.Run(4000);
+    expect_same(cpu, restored);
+
+    // Only the full checkpoint.
+    CPU older(program, sizeof(program));
+    ASSERT_TRUE(LoadCheckpoint(older, {full}));
+    EXPECT_EQ(older.Peek(0x01FF), 0x00);
+}
+
+TEST(CheckpointTestSuite, RejectsBrokenChains) {
+    std::string first = temp_path("checkpoint_first.bin");
+    std::string other = temp_path("checkpoint_other.bin");
+
+    CPU cpu(program, sizeof(program));
+    CheckpointWriter writer;
+    ASSERT_TRUE(writer.Write(cpu, first));
+    CheckpointWriter other_writer;
+    ASSERT_TRUE(other_writer.Write(cpu, other));
+    cpu.Run(100);
+    ASSERT_TRUE(other_writer.Write(cpu, other));
+
+    CPU target(program, sizeof(program));
+    target.X = 0x12;
+    EXPECT_FALSE(LoadCheckpoint(target, {first, other}));
+    EXPECT_FALSE(LoadCheckpoint(target, {other}));
+    EXPECT_FALSE(LoadCheckpoint(target, {temp_path("no_checkpoint.bin")}));
+    EXPECT_EQ(target.X, 0x12);
+
+    FILE* file = fopen(first.c_str(), "r+b");
+    fputc('X', file);
+    fclose(file);
+    EXPECT_FALSE(LoadCheckpoint(target, {first}));
+}
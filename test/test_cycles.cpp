@@ -0,0 +1,42 @@
+#include <CPU.h>
+#include <gtest/gtest.h>
+#include <instructions.h>
+
+// loop: NOP; JMP loop  (5 cycles per iteration, never leaves the program)
+static uint8_t program[] = {Instruction::NOP, Instruction::JMP_ABS, 0x00,
+                            0x80};
+
+TEST(CyclesTestSuite, CounterDoesNotWrap) {
+    for (auto engine : {Engine::Table, Engine::Threaded, Engine::Predecoded,
+                        Engine::Jit}) {
+        CPU cpu(program, sizeof(program), engine);
+        cpu.Run(100000);
+        EXPECT_GE(cpu.GetCycles(), 100000u);
+        EXPECT_EQ(cpu.GetCycles() % 5, 0u);
+    }
+}
+
+TEST(CyclesTestSuite, RunReturnsOvershoot) {
+    for (auto engine : {Engine::Table, Engine::Threaded, Engine::Predecoded,
+                        Engine::Jit}) {
+        CPU cpu(program, sizeof(program), engine);
+
+        EXPECT_EQ(cpu.Run(10), 0u);
+        EXPECT_EQ(cpu.GetCycles(), 10u);
+
+        // NOP ends at 12, JMP at 15
+        EXPECT_EQ(cpu.Run(3), 2u);
+        EXPECT_EQ(cpu.GetCycles(), 15u);
+        EXPECT_EQ(cpu.PC, 0x8000);
+    }
+}
+
+TEST(CyclesTestSuite, RunStopsOnTrap) {
+    uint8_t trap[] = {Instruction::NOP, 0x02};
+    CPU cpu(trap, sizeof(trap));
+    EXPECT_EQ(cpu.Run(1000), 0u);
+    EXPECT_TRUE(cpu.IsTrapped());
+    EXPECT_EQ(cpu.GetCycles(), 3u);
+    EXPECT_EQ(cpu.Run(1000), 0u);
+    EXPECT_EQ(cpu.GetCycles(), 3u);
+}
@@ -0,0 +1,183 @@
+#include <CPU.h>
+#include <gtest/gtest.h>
+#include <instructions.h>
+
+struct Expected {
+    uint8_t ac;
+    bool N, V, Z, C;
+};
+
+// Reference NMOS results, written digit by digit so they don't share code
+// with the emulator's tables. ADC takes N and V from the sum before the high
+// digit is adjusted and Z from the binary sum.
+static Expected reference_adc(int a, int b, int c) {
+    int low = (a & 0x0F) + (b & 0x0F) + c;
+    int half_carry = low > 9;
+    if (half_carry) {
+        low = (low + 6) & 0x0F;
+    }
+    int high = (a >> 4) + (b >> 4) + half_carry;
+
+    int signed_high = (int8_t)(a & 0xF0) + (int8_t)(b & 0xF0);
+    int intermediate = signed_high + (half_carry << 4) + low;
+
+    Expected expected;
+    expected.N = (intermediate & 0x80) != 0;
+    expected.V = intermediate < -128 || intermediate > 127;
+    expected.Z = ((a + b + c) & 0xFF) == 0;
+    if (high > 9) {
+        high += 6;
+    }
+    expected.C = high > 15;
+    expected.ac = (high << 4 | low) & 0xFF;
+    return expected;
+}
+
+// SBC adjusts each digit of the difference, borrowing from the high digit
+// through bit 4, and sets every flag from the binary difference.
+static Expected reference_sbc(int a, int b, int c) {
+    int difference = a - b + c - 1;
+    int low = (a & 0x0F) - (b & 0x0F) + c - 1;
+    int adjusted;
+    if (low & 0x10) {
+        adjusted = ((low - 6) & 0x0F) | ((a & 0xF0) - (b & 0xF0) - 0x10);
+    } else {
+        adjusted = (low & 0x0F) | ((a & 0xF0) - (b & 0xF0));
+    }
+    if (adjusted & 0x100) {
+        adjusted -= 0x60;
+    }
+
+    int signed_difference = (int8_t)a - (int8_t)b + c - 1;
+    return {(uint8_t)adjusted, (difference & 0x80) != 0,
+            signed_difference < -128 || signed_difference > 127,
+            (difference & 0xFF) == 0, difference >= 0};
+}
+
+static Expected reference_binary_sbc(int a, int b, int c) {
+    int difference = a - b + c - 1;
+    int signed_difference = (int8_t)a - (int8_t)b + c - 1;
+    return {(uint8_t)difference, (difference & 0x80) != 0,
+            signed_difference < -128 || signed_difference > 127,
+            (difference & 0xFF) == 0, difference >= 0};
+}
+
+static int from_bcd(int value) { return (value >> 4) * 10 + (value & 0x0F); }
+
+static int to_bcd(int value) { return (value / 10) << 4 | value % 10; }
+
+/**
+ * @brief Runs op_code on every AC, operand and carry combination, one
+ * instruction at a time.
+ * */
+template <typename CHECK>
+static void for_each_input(Instruction op_code, bool decimal, CHECK check) {
+    uint8_t program[] = {op_code, 0x00};
+    CPU cpu(program, sizeof(program));
+
+    for (int c = 0; c < 2; c++) {
+        for (int a = 0; a < 256; a++) {
+            for (int b = 0; b < 256; b++) {
+                cpu.GetMemory().write(0x8001, b);
+                cpu.PC = 0x8000;
+                cpu.AC = a;
+                cpu.SR.C = c;
+                cpu.SR.D = decimal;
+                cpu.Run(1);
+                ASSERT_EQ(cpu.PC, 0x8002);
+                check(cpu, a, b, c);
+                if (::testing::Test::HasFailure()) {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+static void expect_result(const CPU& cpu, const Expected& expected, int a,
+                          int b, int c) {
+    SCOPED_TRACE(testing::Message() << std::hex << "AC=" << a << " operand="
+                                    << b << " C=" << c);
+    EXPECT_EQ(cpu.AC, expected.ac);
+    EXPECT_EQ(cpu.SR.N, expected.N);
+    EXPECT_EQ(cpu.SR.V, expected.V);
+    EXPECT_EQ(cpu.SR.Z, expected.Z);
+    EXPECT_EQ(cpu.SR.C, expected.C);
+    EXPECT_EQ(cpu.SR.D, 1);
+}
+
+TEST(DecimalTestSuite, ADCAllInputs) {
+    for_each_input(Instruction::ADC_IMM, true,
+                   [](CPU& cpu, int a, int b, int c) {
+                       expect_result(cpu, reference_adc(a, b, c), a, b, c);
+                   });
+}
+
+TEST(DecimalTestSuite, SBCAllInputs) {
+    for_each_input(Instruction::SBC_IMM, true,
+                   [](CPU& cpu, int a, int b, int c) {
+                       expect_result(cpu, reference_sbc(a, b, c), a, b, c);
+                   });
+}
+
+TEST(DecimalTestSuite, ValidBCD) {
+    for_each_input(Instruction::ADC_IMM, true,
+                   [](CPU& cpu, int a, int b, int c) {
+                       if (a % 16 > 9 || a > 0x99 || b % 16 > 9 || b > 0x99) {
+                           return;
+                       }
+                       int sum = from_bcd(a) + from_bcd(b) + c;
+                       EXPECT_EQ(cpu.AC, to_bcd(sum % 100));
+                       EXPECT_EQ(cpu.SR.C, sum >= 100);
+                   });
+    for_each_input(Instruction::SBC_IMM, true,
+                   [](CPU& cpu, int a, int b, int c) {
+                       if (a % 16 > 9 || a > 0x99 || b % 16 > 9 || b > 0x99) {
+                           return;
+                       }
+                       int difference = from_bcd(a) - from_bcd(b) + c - 1;
+                       EXPECT_EQ(cpu.AC, to_bcd((difference + 100) % 100));
+                       EXPECT_EQ(cpu.SR.C, difference >= 0);
+                   });
+}
+
+TEST(DecimalTestSuite, KnownNMOSResults) {
+    struct Case {
+        Instruction op_code;
+        uint8_t a, b;
+        bool c;
+        Expected expected;
+    };
+    // 99 + 01 is 00 with Z clear since the binary sum is 0x9A, and N and V
+    // come from 0xA5 for 58 + 46 + 1.
+    Case cases[] = {
+        {Instruction::ADC_IMM, 0x99, 0x01, 0, {0x00, 1, 0, 0, 1}},
+        {Instruction::ADC_IMM, 0x58, 0x46, 1, {0x05, 1, 1, 0, 1}},
+        {Instruction::ADC_IMM, 0x12, 0x34, 0, {0x46, 0, 0, 0, 0}},
+        {Instruction::SBC_IMM, 0x00, 0x01, 1, {0x99, 1, 0, 0, 0}},
+        {Instruction::SBC_IMM, 0x46, 0x12, 1, {0x34, 0, 0, 0, 1}},
+        {Instruction::SBC_IMM, 0x40, 0x13, 1, {0x27, 0, 0, 0, 1}},
+    };
+
+    for (auto& test : cases) {
+        uint8_t program[] = {test.op_code, test.b};
+        CPU cpu(program, sizeof(program));
+        cpu.AC = test.a;
+        cpu.SR.C = test.c;
+        cpu.SR.D = 1;
+        cpu.Execute();
+        expect_result(cpu, test.expected, test.a, test.b, test.c);
+    }
+}
+
+TEST(DecimalTestSuite, BinarySBCAllInputs) {
+    for_each_input(Instruction::SBC_IMM, false,
+                   [](CPU& cpu, int a, int b, int c) {
+                       Expected expected = reference_binary_sbc(a, b, c);
+                       EXPECT_EQ(cpu.AC, expected.ac);
+                       EXPECT_EQ(cpu.SR.N, expected.N);
+                       EXPECT_EQ(cpu.SR.V, expected.V);
+                       EXPECT_EQ(cpu.SR.Z, expected.Z);
+                       EXPECT_EQ(cpu.SR.C, expected.C);
+                   });
+}
@@ -0,0 +1,153 @@
+#include <CPU.h>
+#include <gtest/gtest.h>
+#include <instructions.h>
+
+static void run_loop(CPU& cpu) {
+    cpu.X = 0x10;
+    cpu.Execute();
+}
+
+TEST(EngineTestSuite, ThreadedMatchesTable) {
+    // loop: ADC #3; EOR #$55; DEX; BNE loop; then an unknown op_code
+    uint8_t program[] = {Instruction::ADC_IMM, 0x03, Instruction::EOR_IMM,
+                         0x55,                 Instruction::DEX,
+                         Instruction::BNE,     0xF9,
+                         0x02};
+    CPU table(program, sizeof(program), Engine::Table);
+    CPU threaded(program, sizeof(program), Engine::Threaded);
+    EXPECT_EQ(table.GetEngine(), Engine::Table);
+    EXPECT_EQ(threaded.GetEngine(), Engine::Threaded);
+
+    run_loop(table);
+    run_loop(threaded);
+
+    EXPECT_EQ(threaded.PC, table.PC);
+    EXPECT_EQ(threaded.AC, table.AC);
+    EXPECT_EQ(threaded.X, 0);
+    EXPECT_EQ(threaded.SR.Value(), table.SR.Value());
+    EXPECT_EQ(threaded.GetCycles(), table.GetCycles());
+    EXPECT_TRUE(threaded.IsTrapped());
+    EXPECT_EQ(threaded.GetTrapOpCode(), 0x02);
+}
+
+TEST(EngineTestSuite, PredecodedMatchesTable) {
+    uint8_t program[] = {Instruction::ADC_IMM, 0x03, Instruction::EOR_IMM,
+                         0x55,                 Instruction::DEX,
+                         Instruction::BNE,     0xF9,
+                         0x02};
+    CPU table(program, sizeof(program), Engine::Table);
+    CPU predecoded(program, sizeof(program), Engine::Predecoded);
+
+    run_loop(table);
+    run_loop(predecoded);
+
+    EXPECT_EQ(predecoded.PC, table.PC);
+    EXPECT_EQ(predecoded.AC, table.AC);
+    EXPECT_EQ(predecoded.SR.Value(), table.SR.Value());
+    EXPECT_EQ(predecoded.GetCycles(), table.GetCycles());
+    EXPECT_TRUE(predecoded.IsTrapped());
+    EXPECT_EQ(predecoded.GetTrapOpCode(), 0x02);
+}
+
+TEST(EngineTestSuite, SelfModifyingCode) {
+    // loop: LDA #$00; CLC; ADC #1; STA loop + 1; DEX; BNE loop
+    uint8_t program[] = {Instruction::LDA_IMM, 0x00, Instruction::CLC,
+                         Instruction::ADC_IMM, 0x01, Instruction::STA_ABS,
+                         0x01,                 0x80, Instruction::DEX,
+                         Instruction::BNE,     0xF5};
+    for (auto engine : {Engine::Table, Engine::Threaded, Engine::Predecoded,
+                        Engine::Jit}) {
+        CPU cpu(program, sizeof(program), engine);
+        cpu.X = 5;
+        cpu.Execute();
+        EXPECT_EQ(cpu.AC, 5);
+        EXPECT_EQ(cpu.Peek(0x8001), 5);
+        EXPECT_EQ(cpu.GetCycles(), 5 * 15 - 1);
+    }
+}
+
+TEST(EngineTestSuite, PredecodedSeesHostWrites) {
+    // An immediate operand on the next page, then one on the same page.
+    CPU cpu(nullptr, 0, Engine::Predecoded);
+    uint8_t code[] = {Instruction::LDA_IMM, 0x11, Instruction::LDX_IMM, 0x22};
+    cpu.GetMemory().write(0x80FF, code, sizeof(code));
+
+    for (uint8_t value : {0x33, 0x44}) {
+        cpu.PC = 0x80FF;
+        cpu.Run(4);
+        EXPECT_EQ(cpu.PC, 0x8103);
+
+        cpu.GetMemory().write(0x8100, value);
+        cpu.GetMemory().write(0x8102, value + 1);
+        cpu.PC = 0x80FF;
+        cpu.Run(4);
+        EXPECT_EQ(cpu.AC, value);
+        EXPECT_EQ(cpu.X, value + 1);
+    }
+}
+
+TEST(EngineTestSuite, PredecodedFetchesFromDevices) {
+    struct NopDevice : Device {
+        uint8_t Read(uint16_t) override {
+            reads++;
+            return Instruction::NOP;
+        }
+        void Write(uint16_t, uint8_t) override {}
+        int reads = 0;
+    } device;
+
+    CPU cpu(nullptr, 0, Engine::Predecoded);
+    cpu.GetMemory().MapDevice(0x90, 1, &device);
+    cpu.PC = 0x9000;
+    cpu.Run(10);
+    EXPECT_EQ(device.reads, 5);
+    EXPECT_EQ(cpu.PC, 0x9005);
+}
+
+TEST(EngineTestSuite, FusedPairsMatchTable) {
+    // loop: LDA $10; EOR #7; STA $10; INX; CMX #$20; BNE loop; then an
+    // unknown op_code
+    uint8_t program[] = {Instruction::LDA_ZP,  0x10, Instruction::EOR_IMM,
+                         0x07,                 Instruction::STA_ZP,
+                         0x10,                 Instruction::INX,
+                         Instruction::CMX_IMM, 0x20, Instruction::BNE,
+                         0xF5,                 0x02};
+    CPU table(program, sizeof(program), Engine::Table);
+    CPU predecoded(program, sizeof(program), Engine::Predecoded);
+
+    // Budgets that stop between the instructions of a pair, and an event
+    // due after LDA $10 that sees PC on EOR #7.
+    uint16_t seen[2] = {};
+    int i = 0;
+    for (CPU* cpu : {&table, &predecoded}) {
+        uint16_t& pc = seen[i++];
+        cpu->ScheduleEvent(3, [&pc](CPU& c) { pc = c.PC; });
+        for (uint64_t budget : {3, 4, 5, 2, 9, 100000}) {
+            cpu->Run(budget);
+        }
+    }
+    EXPECT_EQ(seen[0], 0x8002);
+    EXPECT_EQ(seen[1], seen[0]);
+    EXPECT_EQ(predecoded.PC, table.PC);
+    EXPECT_EQ(predecoded.AC, table.AC);
+    EXPECT_EQ(predecoded.X, 0x20);
+    EXPECT_EQ(predecoded.SR.Value(), table.SR.Value());
+    EXPECT_EQ(predecoded.GetCycles(), table.GetCycles());
+    EXPECT_EQ(predecoded.Peek(0x0010), table.Peek(0x0010));
+    EXPECT_TRUE(predecoded.IsTrapped());
+}
+
+TEST(EngineTestSuite, EventRewritesSecondInstructionOfPair) {
+    // LDA $10; EOR #0; STA $11; then an unknown op_code. An event between
+    // the first two turns the EOR into EOR #$FF.
+    uint8_t program[] = {Instruction::LDA_ZP, 0x10, Instruction::EOR_IMM,
+                         0x00, Instruction::STA_ZP, 0x11, 0x02};
+    for (auto engine : {Engine::Table, Engine::Threaded, Engine::Predecoded,
+                        Engine::Jit}) {
+        CPU cpu(program, sizeof(program), engine);
+        cpu.GetMemory().write(0x0010, 0x5A);
+        cpu.ScheduleEvent(3, [](CPU& c) { c.GetMemory().write(0x8003, 0xFF); });
+        cpu.Execute();
+        EXPECT_EQ(cpu.Peek(0x0011), 0xA5);
+    }
+}
@@ -0,0 +1,37 @@
+#include <CPU.h>
+#include <gtest/gtest.h>
+#include <instructions.h>
+
+static void check_registers(CPU& cpu, uint16_t cycles) {
+    EXPECT_EQ(cpu.GetCycles(), cycles);
+
+    EXPECT_EQ(cpu.SR.N, ((cpu.AC & 0x80) > 0));
+    EXPECT_EQ(cpu.SR.Z, (cpu.AC == 0));
+}
+
+TEST(EORTestSuite, IMM) {
+    uint8_t program[] = {Instruction::EOR_IMM, 0x0F};
+    CPU cpu(program, sizeof(program));
+    cpu.AC = 0xFF;
+    cpu.Execute();
+    check_registers(cpu, 2);
+    EXPECT_EQ(cpu.AC, 0xF0);
+}
+
+TEST(EORTestSuite, ZP) {
+    uint8_t program[] = {Instruction::EOR_ZP, 0x00};
+    CPU cpu(program, sizeof(program));
+    cpu.AC = 0x42;
+    cpu.Execute();
+    check_registers(cpu, 3);
+    EXPECT_EQ(cpu.AC, 0x42);
+}
+
+TEST(EORTestSuite, ABS) {
+    uint8_t program[] = {Instruction::EOR_ABS, 0x00, 0x80};
+    CPU cpu(program, sizeof(program));
+    cpu.AC = Instruction::EOR_ABS;
+    cpu.Execute();
+    check_registers(cpu, 4);
+    EXPECT_EQ(cpu.AC, 0);
+}
@@ -0,0 +1,99 @@
+#include <CPU.h>
+#include <gtest/gtest.h>
+#include <instructions.h>
+
+static const Engine engines[] = {Engine::Table, Engine::Threaded,
+                                 Engine::Predecoded, Engine::Jit};
+
+// loop: INX; INY; JMP loop
+static uint8_t loop[] = {Instruction::INX, Instruction::INY,
+                         Instruction::JMP_ABS, 0x00, 0x80};
+
+// JSR $9000; INY; then zeroed memory, a BRK
+static uint8_t call[] = {Instruction::JSR, 0x00, 0x90, Instruction::INY};
+
+// $9000: INX; RTS
+static uint8_t sub[] = {Instruction::INX, Instruction::RTS};
+
+TEST(HaltTestSuite, InstructionCount) {
+    for (auto engine : engines) {
+        CPU cpu(loop, sizeof(loop), engine);
+        HaltConditions halt;
+        halt.instructions = 7;
+        EXPECT_EQ(cpu.Run(halt), HaltReason::Instructions);
+        EXPECT_EQ(cpu.X, 3);
+        EXPECT_EQ(cpu.Y, 2);
+        EXPECT_EQ(cpu.GetCycles(), 3u * 2 + 2 * 2 + 2 * 3);
+
+        halt.instructions = 2;
+        EXPECT_EQ(cpu.Run(halt), HaltReason::Instructions);
+        EXPECT_EQ(cpu.Y, 3);
+        EXPECT_EQ(cpu.PC, 0x8000);
+
+        // Whichever condition comes first.
+        halt.instructions = 1000;
+        halt.cycles = 10;
+        EXPECT_EQ(cpu.Run(halt), HaltReason::Cycles);
+        EXPECT_EQ(cpu.GetCycles(), 21u + 11);
+    }
+}
+
+TEST(HaltTestSuite, SentinelPC) {
+    for (auto engine : engines) {
+        CPU cpu(call, sizeof(call), engine);
+        cpu.GetMemory().write(0x9000, sub, sizeof(sub));
+        HaltConditions halt;
+        halt.pc = 0x8003;
+        EXPECT_EQ(cpu.Run(halt), HaltReason::PC);
+        EXPECT_FALSE(cpu.IsWatchHit());
+        EXPECT_EQ(cpu.PC, 0x8003);
+        EXPECT_EQ(cpu.X, 1);
+        EXPECT_EQ(cpu.Y, 0);
+        EXPECT_EQ(cpu.GetCycles(), 6u + 2 + 6);
+
+        // Continuing runs the instruction at the sentinel.
+        halt.brk = true;
+        EXPECT_EQ(cpu.Run(halt), HaltReason::Trap);
+        EXPECT_EQ(cpu.Y, 1);
+        EXPECT_EQ(cpu.PC, 0x8004);
+    }
+}
+
+TEST(HaltTestSuite, BRK) {
+    for (auto engine : engines) {
+        // Calls outside the program no longer end Execute.
+        CPU cpu(call, sizeof(call), engine);
+        cpu.GetMemory().write(0x9000, sub, sizeof(sub));
+        cpu.Execute();
+        EXPECT_EQ(cpu.GetHaltReason(), HaltReason::Trap);
+        EXPECT_EQ(cpu.GetTrapOpCode(), Instruction::BRK);
+        EXPECT_EQ(cpu.PC, 0x8004);
+        EXPECT_EQ(cpu.X, 1);
+        EXPECT_EQ(cpu.Y, 1);
+        // BRK isn't fetched.
+        EXPECT_EQ(cpu.GetCycles(), 6u + 2 + 6 + 2);
+        EXPECT_EQ(cpu.SP, 0xFF);
+    }
+}
+
+TEST(HaltTestSuite, Callback) {
+    for (auto engine : engines) {
+        CPU cpu(loop, sizeof(loop), engine);
+        int calls = 0;
+        HaltConditions halt;
+        halt.callback_interval = 100;
+        halt.callback = [&calls](CPU& cpu) {
+            EXPECT_GE(cpu.GetCycles(), 100u * (calls + 1));
+            return ++calls < 3;
+        };
+        EXPECT_EQ(cpu.Run(halt), HaltReason::Callback);
+        EXPECT_EQ(calls, 3);
+        EXPECT_GE(cpu.GetCycles(), 300u);
+        EXPECT_LT(cpu.GetCycles(), 300u + 7);
+
+        // The callback ends with its run.
+        cpu.Run(1000);
+        EXPECT_EQ(cpu.GetHaltReason(), HaltReason::Cycles);
+        EXPECT_EQ(calls, 3);
+    }
+}
@@ -0,0 +1,26 @@
+#include <CPU.h>
+#include <gtest/gtest.h>
+#include <instructions.h>
+
+TEST(INCTestSuite, ZP) {
+    uint8_t program[] = {Instruction::INC_ZP, 0x10};
+    CPU cpu(program, sizeof(program));
+    cpu.GetMemory().write(0x0010, 0x7F);
+    cpu.Execute();
+    EXPECT_EQ(cpu.GetCycles(), 5);
+    EXPECT_EQ(cpu.GetMemory().peek(0x0010), 0x80);
+    // Not the operand, as immediate addressing would have it.
+    EXPECT_EQ(cpu.GetMemory().peek(0x8001), 0x10);
+    EXPECT_EQ(cpu.SR.Z, 0);
+    EXPECT_EQ(cpu.SR.N, 1);
+}
+
+TEST(INCTestSuite, ZPWraps) {
+    uint8_t program[] = {Instruction::INC_ZP, 0x10};
+    CPU cpu(program, sizeof(program));
+    cpu.GetMemory().write(0x0010, 0xFF);
+    cpu.Execute();
+    EXPECT_EQ(cpu.GetMemory().peek(0x0010), 0x00);
+    EXPECT_EQ(cpu.SR.Z, 1);
+    EXPECT_EQ(cpu.SR.N, 0);
+}
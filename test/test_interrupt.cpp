@@ -0,0 +1,124 @@
+#include <CPU.h>
+#include <gtest/gtest.h>
+#include <instructions.h>
+#include <vector>
+
+// CLI; loop: INY; JMP loop
+static uint8_t program[] = {Instruction::CLI, Instruction::INY,
+                            Instruction::JMP_ABS, 0x01, 0x80};
+
+// handler: INC $10; RTI
+static uint8_t handler[] = {Instruction::INC_ZP, 0x10, Instruction::RTI};
+
+static void install_vector(CPU& cpu, uint16_t vector, uint16_t address) {
+    auto [low, high] = bytes_from_address(address);
+    cpu.GetMemory().write(vector, low);
+    cpu.GetMemory().write(vector + 1, high);
+    cpu.GetMemory().write(address, handler, sizeof(handler));
+}
+
+TEST(InterruptTestSuite, EventsRunInCycleOrder) {
+    CPU cpu(program, sizeof(program));
+    std::vector<int> order;
+    cpu.ScheduleEvent(30, [&](CPU&) { order.push_back(2); });
+    cpu.ScheduleEvent(10, [&](CPU& c) {
+        order.push_back(1);
+        EXPECT_GE(c.GetCycles(), 10u);
+        EXPECT_LT(c.GetCycles(), 15u);
+    });
+    cpu.ScheduleEvent(30, [&](CPU&) { order.push_back(3); });
+    uint64_t cancelled =
+        cpu.ScheduleEvent(20, [&](CPU&) { order.push_back(0); });
+    EXPECT_TRUE(cpu.CancelEvent(cancelled));
+    EXPECT_FALSE(cpu.CancelEvent(cancelled));
+
+    cpu.Run(100);
+    EXPECT_EQ(order, (std::vector<int>{1, 2, 3}));
+}
+
+TEST(InterruptTestSuite, IRQFromTimer) {
+    for (auto engine : {Engine::Table, Engine::Threaded, Engine::Predecoded,
+                        Engine::Jit}) {
+        CPU cpu(program, sizeof(program), engine);
+        install_vector(cpu, 0xFFFE, 0x9000);
+        cpu.ScheduleEvent(50, [](CPU& c) { c.AssertIRQ(); });
+        // Released while the handler runs with interrupts disabled.
+        cpu.ScheduleEvent(60, [](CPU& c) { c.ReleaseIRQ(); });
+
+        cpu.Run(200);
+        EXPECT_EQ(cpu.Peek(0x0010), 1);
+        EXPECT_EQ(cpu.SR.I, 0);
+        EXPECT_EQ(cpu.SP, 0xFF);
+        EXPECT_GE(cpu.PC, 0x8001);
+        EXPECT_LT(cpu.PC, 0x8005);
+        // The pushed status has B clear and bit 5 set.
+        EXPECT_EQ(cpu.Peek(0x01FD) & 0x30, 0x20);
+    }
+}
+
+TEST(InterruptTestSuite, IRQWaitsForCLI) {
+    // SEI; NOP x4; CLI; loop: JMP loop
+    uint8_t masked[] = {Instruction::SEI, Instruction::NOP, Instruction::NOP,
+                        Instruction::NOP, Instruction::NOP, Instruction::CLI,
+                        Instruction::JMP_ABS, 0x06, 0x80};
+    CPU cpu(masked, sizeof(masked));
+    install_vector(cpu, 0xFFFE, 0x9000);
+    cpu.SR.I = 1; // I is clear at power on
+    cpu.AssertIRQ(0x4);
+    EXPECT_TRUE(cpu.IsIRQAsserted());
+
+    cpu.Run(8);
+    EXPECT_EQ(cpu.Peek(0x0010), 0);
+    cpu.Run(11); // NOP, CLI, then the 7 cycles of the interrupt sequence
+    EXPECT_EQ(cpu.PC, 0x9000);
+
+    cpu.ReleaseIRQ(0x4);
+    EXPECT_FALSE(cpu.IsIRQAsserted());
+    cpu.Run(100);
+    EXPECT_EQ(cpu.Peek(0x0010), 1);
+}
+
+TEST(InterruptTestSuite, NMIIgnoresMask) {
+    uint8_t masked[] = {Instruction::SEI, Instruction::JMP_ABS, 0x01, 0x80};
+    CPU cpu(masked, sizeof(masked));
+    install_vector(cpu, 0xFFFA, 0x9100);
+    cpu.ScheduleEvent(20, [](CPU& c) { c.TriggerNMI(); });
+
+    cpu.Run(100);
+    EXPECT_EQ(cpu.Peek(0x0010), 1);
+    EXPECT_EQ(cpu.SR.I, 1);
+}
+
+TEST(InterruptTestSuite, BRKAndRTI) {
+    // BRK; padding; LDA #1
+    uint8_t brk[] = {Instruction::BRK, 0xFF, Instruction::LDA_IMM, 0x01};
+    CPU cpu(brk, sizeof(brk));
+    install_vector(cpu, 0xFFFE, 0x9000);
+
+    cpu.Run(7);
+    EXPECT_EQ(cpu.PC, 0x9000);
+    EXPECT_EQ(cpu.GetCycles(), 7u);
+    EXPECT_EQ(cpu.Peek(0x01FF), 0x80);
+    EXPECT_EQ(cpu.Peek(0x01FE), 0x02);
+    EXPECT_EQ(cpu.Peek(0x01FD) & 0x30, 0x30);
+
+    cpu.Run(11 + 2);
+    EXPECT_EQ(cpu.AC, 0x01);
+    EXPECT_EQ(cpu.Peek(0x0010), 1);
+}
+
+TEST(InterruptTestSuite, Reset) {
+    uint8_t trap[] = {0x02};
+    CPU cpu(trap, sizeof(trap));
+    cpu.Run(10);
+    EXPECT_TRUE(cpu.IsTrapped());
+
+    cpu.GetMemory().write(0xFFFC, 0x34);
+    cpu.GetMemory().write(0xFFFD, 0x12);
+    cpu.Reset();
+    EXPECT_FALSE(cpu.IsTrapped());
+    EXPECT_EQ(cpu.PC, 0x1234);
+    EXPECT_EQ(cpu.SP, 0xFC);
+    EXPECT_EQ(cpu.SR.I, 1);
+    EXPECT_EQ(cpu.GetCycles(), 1u + 7u);
+}
@@ -0,0 +1,238 @@
+#include <CPU.h>
+#include <JitCache.h>
+#include <gtest/gtest.h>
+#include <instructions.h>
+#include <random>
+#include <vector>
+
+#if JIT_AVAILABLE
+
+TEST(JitTestSuite, CompilesHotBlocks) {
+    // loop: CLC; ADC #3; DEX; BNE loop
+    uint8_t code[] = {Instruction::CLC, Instruction::ADC_IMM, 0x03,
+                      Instruction::DEX, Instruction::BNE, 0xFA};
+    Memory memory;
+    memory.write(0x8000, code, sizeof(code));
+
+    JitCache cache;
+    for (int i = 1; i < JIT_HOT_THRESHOLD; i++) {
+        EXPECT_EQ(cache.Lookup(memory, 0x8000), nullptr);
+    }
+    const JitBlock* block = cache.Lookup(memory, 0x8000);
+    ASSERT_NE(block, nullptr);
+    EXPECT_EQ(cache.CountCompiledBlocks(), 1u);
+    EXPECT_EQ(block->last, 4);
+    EXPECT_EQ(block->max_cycles, 2 + 2 + 2 + 3);
+
+    // Loops on itself until another run would reach the limit.
+    JitContext context = {memory.GetReadPointers(), memory.GetWritePointers(),
+                          0, 20, 0x8000, 0x01, 0, 3, 0, 0};
+    block->code(&context);
+    EXPECT_EQ(context.pc, 0x8000);
+    EXPECT_EQ(context.cycles, 18u);
+    EXPECT_EQ(context.ac, 6);
+    EXPECT_EQ(context.x, 1);
+
+    context.limit = UINT64_MAX;
+    block->code(&context);
+    EXPECT_EQ(context.pc, 0x8006);
+    EXPECT_EQ(context.cycles, 26u);
+    EXPECT_EQ(context.ac, 9);
+    EXPECT_EQ(context.x, 0);
+
+    // Writing the page drops the block.
+    memory.write(0x8002, 0x05);
+    EXPECT_EQ(cache.Lookup(memory, 0x8000), nullptr);
+}
+
+/**
+ * @brief Loops of random instructions over pages 0 to 5. X only counts the
+ * iterations, zero page stores stay below the pointers of the indirect
+ * modes at 0x80, which all point to pages 2 and 3.
+ * */
+static std::vector<uint8_t> random_loop(std::mt19937& random) {
+    using I = Instruction;
+    static const uint8_t zero_page[] = {
+        I::LDA_ZP,  I::LDY_ZP,  I::ADC_ZP,  I::SBC_ZP,  I::AND_ZP,
+        I::ORA_ZP,  I::EOR_ZP,  I::CMP_ZP,  I::CMX_ZP,  I::CMY_ZP,
+        I::BIT_ZP,  I::STA_ZP,  I::STX_ZP,  I::STY_ZP,  I::INC_ZP,
+        I::DEC_ZP,  I::ASL_ZP,  I::LSR_ZP,  I::ROL_ZP,  I::ROR_ZP,
+        I::LDA_ZPX, I::ADC_ZPX, I::STA_ZPX, I::LDY_ZPX, I::STY_ZPX,
+        I::INC_ZPX, I::ROR_ZPX, I::EOR_ZPX, I::SBC_ZPX, I::CMP_ZPX};
+    static const uint8_t immediate[] = {
+        I::LDA_IMM, I::LDY_IMM, I::ADC_IMM, I::SBC_IMM, I::AND_IMM,
+        I::ORA_IMM, I::EOR_IMM, I::CMP_IMM, I::CMX_IMM, I::CMY_IMM};
+    static const uint8_t absolute[] = {
+        I::LDA_ABS,  I::STA_ABS,  I::ADC_ABS,  I::INC_ABS,  I::LSR_ABS,
+        I::LDA_ABSX, I::LDA_ABSY, I::STA_ABSX, I::STA_ABSY, I::SBC_ABSY,
+        I::LDY_ABSX, I::CMP_ABSX, I::ORA_ABSY, I::BIT_ABS,  I::STX_ABS,
+        I::STY_ABS,  I::CMX_ABS,  I::DEC_ABS,  I::ROL_ABS,  I::ASL_ABS};
+    static const uint8_t indirect[] = {
+        I::LDA_INDX, I::LDA_INDY, I::STA_INDX, I::STA_INDY, I::ADC_INDY,
+        I::SBC_INDX, I::CMP_INDY, I::AND_INDX, I::EOR_INDY, I::ORA_INDY};
+    // TYA and PHA/PLA aren't compiled and end a block.
+    static const uint8_t implied[] = {
+        I::INY,     I::DEY,     I::TAY,     I::TXA,     I::CLC,
+        I::SEC,     I::CLV,     I::NOP,     I::ASL_ACC, I::LSR_ACC,
+        I::ROL_ACC, I::ROR_ACC, I::TYA,     I::SED,     I::CLD,
+        I::CLD,     I::CLD,     I::PHA,     I::PLA};
+    static const uint8_t branches[] = {I::BCC, I::BCS, I::BEQ, I::BNE,
+                                       I::BMI, I::BPL, I::BVC, I::BVS};
+
+    auto pick = [&](const auto& list) {
+        return list[random() % (sizeof(list) / sizeof(list[0]))];
+    };
+
+    std::vector<uint8_t> code;
+    int count = 1 + random() % 20;
+    for (int i = 0; i < count; i++) {
+        switch (random() % 6) {
+        case 0:
+            code.insert(code.end(), {pick(zero_page), uint8_t(random() % 0x20)});
+            break;
+        case 1:
+            code.insert(code.end(), {pick(immediate), uint8_t(random())});
+            break;
+        case 2:
+            code.insert(code.end(), {pick(absolute), uint8_t(random()),
+                                     uint8_t(2 + random() % 3)});
+            break;
+        case 3:
+            code.insert(code.end(),
+                        {pick(indirect), uint8_t(0x80 + random() % 0x40)});
+            break;
+        case 4:
+            code.push_back(pick(implied));
+            break;
+        default:
+            // Taken or not, the next instruction follows.
+            code.insert(code.end(), {pick(branches), 0x00});
+            break;
+        }
+    }
+
+    // DEX; BNE loop; then an unknown op_code
+    code.insert(code.end(), {Instruction::DEX, Instruction::BNE,
+                             uint8_t(-int(code.size() + 3)), 0x02});
+    return code;
+}
+
+static void setup(CPU& cpu, uint32_t seed) {
+    std::mt19937 random(seed);
+    for (uint16_t address = 0; address < 0x80; address++) {
+        cpu.GetMemory().write(address, uint8_t(random()));
+    }
+    for (uint16_t address = 0x80; address < 0x100; address++) {
+        cpu.GetMemory().write(address, uint8_t(2 + random() % 2));
+    }
+    for (uint16_t address = 0x200; address < 0x600; address++) {
+        cpu.GetMemory().write(address, uint8_t(random()));
+    }
+    cpu.AC = random();
+    cpu.Y = random();
+    cpu.X = 40;
+}
+
+static void expect_same(CPU& jit, CPU& table) {
+    EXPECT_EQ(jit.PC, table.PC);
+    EXPECT_EQ(jit.AC, table.AC);
+    EXPECT_EQ(jit.X, table.X);
+    EXPECT_EQ(jit.Y, table.Y);
+    EXPECT_EQ(jit.SP, table.SP);
+    EXPECT_EQ(jit.SR.Value(), table.SR.Value());
+    EXPECT_EQ(jit.GetCycles(), table.GetCycles());
+    EXPECT_EQ(jit.IsTrapped(), table.IsTrapped());
+    for (uint32_t address = 0; address < 0x600; address++) {
+        ASSERT_EQ(jit.Peek(address), table.Peek(address)) << address;
+    }
+}
+
+TEST(JitTestSuite, RandomLoopsMatchTable) {
+    for (uint32_t seed = 0; seed < 300; seed++) {
+        std::mt19937 random(seed);
+        auto code = random_loop(random);
+
+        CPU table(code.data(), code.size(), Engine::Table);
+        CPU jit(code.data(), code.size(), Engine::Jit);
+        setup(table, seed);
+        setup(jit, seed);
+
+        table.Execute();
+        jit.Execute();
+        SCOPED_TRACE(seed);
+        expect_same(jit, table);
+    }
+}
+
+TEST(JitTestSuite, RandomLoopsKeepEventTiming) {
+    for (uint32_t seed = 0; seed < 100; seed++) {
+        std::mt19937 random(seed);
+        auto code = random_loop(random);
+        uint64_t event = 50 + random() % 500;
+        uint64_t budget = 100 + random() % 1000;
+
+        std::vector<uint64_t> seen[2];
+        CPU table(code.data(), code.size(), Engine::Table);
+        CPU jit(code.data(), code.size(), Engine::Jit);
+        int i = 0;
+        for (CPU* cpu : {&table, &jit}) {
+            setup(*cpu, seed);
+            auto& cycles = seen[i++];
+            cpu->ScheduleEvent(event, [&cycles](CPU& c) {
+                cycles.push_back(c.GetCycles());
+                c.Y++;
+            });
+            cpu->Run(budget);
+            cpu->Run(budget / 3);
+        }
+
+        SCOPED_TRACE(seed);
+        EXPECT_EQ(seen[1], seen[0]);
+        expect_same(jit, table);
+    }
+}
+
+TEST(JitTestSuite, DeviceAccessesLeaveCompiledCode) {
+    struct CountingDevice : Device {
+        uint8_t Read(uint16_t) override { return reads++; }
+        void Write(uint16_t, uint8_t data) override { written.push_back(data); }
+        uint8_t reads = 0;
+        std::vector<uint8_t> written;
+    };
+
+    // loop: LDA $9000; STA $9001,X; INY; DEX; BNE loop
+    uint8_t program[] = {Instruction::LDA_ABS,  0x00, 0x90,
+                         Instruction::STA_ABSX, 0x01, 0x90,
+                         Instruction::INY,      Instruction::DEX,
+                         Instruction::BNE,      0xF6};
+    CountingDevice devices[2];
+    uint64_t cycles[2];
+    int i = 0;
+    for (auto engine : {Engine::Table, Engine::Jit}) {
+        CPU cpu(program, sizeof(program), engine);
+        cpu.GetMemory().MapDevice(0x90, 1, &devices[i]);
+        cpu.X = 50;
+        cpu.Execute();
+        EXPECT_EQ(cpu.Y, 50);
+        cycles[i++] = cpu.GetCycles();
+    }
+    EXPECT_EQ(devices[1].reads, 50);
+    EXPECT_EQ(devices[1].written, devices[0].written);
+    EXPECT_EQ(cycles[1], cycles[0]);
+}
+
+TEST(JitTestSuite, SelfModifyingCode) {
+    // loop: LDA #$00; CLC; ADC #1; STA loop + 1; DEX; BNE loop
+    uint8_t program[] = {Instruction::LDA_IMM, 0x00, Instruction::CLC,
+                         Instruction::ADC_IMM, 0x01, Instruction::STA_ABS,
+                         0x01,                 0x80, Instruction::DEX,
+                         Instruction::BNE,     0xF5};
+    CPU cpu(program, sizeof(program), Engine::Jit);
+    cpu.X = 100;
+    cpu.Execute();
+    EXPECT_EQ(cpu.AC, 100);
+    EXPECT_EQ(cpu.Peek(0x8001), 100);
+    EXPECT_EQ(cpu.GetCycles(), 100 * 15 - 1);
+}
+
+#endif
@@ -0,0 +1,32 @@
+#include <CPU.h>
+#include <gtest/gtest.h>
+#include <instructions.h>
+
+// JSR sub; INY; an unknown op_code; sub: LDX #7; RTS
+static uint8_t program[] = {Instruction::JSR,     0x05, 0x80, Instruction::INY,
+                            0x02,                 Instruction::LDX_IMM,
+                            0x07,                 Instruction::RTS};
+
+TEST(JSRTestSuite, TEST_JSR_RTS) {
+    CPU cpu(program, sizeof(program));
+
+    cpu.Run(1);
+    EXPECT_EQ(cpu.GetCycles(), 6);
+    EXPECT_EQ(cpu.PC, 0x8005);
+    EXPECT_EQ(cpu.SP, 0xFD);
+    // The address of the last byte of JSR, high byte first.
+    EXPECT_EQ(cpu.Peek(0x01FF), 0x80);
+    EXPECT_EQ(cpu.Peek(0x01FE), 0x02);
+
+    cpu.Run(1);
+    EXPECT_EQ(cpu.X, 7);
+
+    cpu.Run(1);
+    EXPECT_EQ(cpu.GetCycles(), 6 + 2 + 6);
+    EXPECT_EQ(cpu.PC, 0x8003);
+    EXPECT_EQ(cpu.SP, 0xFF);
+
+    cpu.Run(100);
+    EXPECT_TRUE(cpu.IsTrapped());
+    EXPECT_EQ(cpu.Y, 1);
+}
@@ -0,0 +1,209 @@
+#include <CPU.h>
+#include <Lockstep.h>
+#include <gtest/gtest.h>
+#include <instructions.h>
+#include <random>
+#include <vector>
+
+/**
+ * @brief Random straight code of the instructions the kernels run, mixed
+ * with some that run on single lanes, ending in a JMP back to the start.
+ * Branches skip the instruction after them when taken, so lanes diverge
+ * and meet again.
+ * */
+static std::vector<uint8_t> random_program(std::mt19937& random) {
+    using I = Instruction;
+    static const uint8_t zero_page[] = {
+        I::LDA_ZP,  I::LDX_ZP,  I::LDY_ZP,  I::ADC_ZP,  I::SBC_ZP,
+        I::AND_ZP,  I::ORA_ZP,  I::EOR_ZP,  I::CMP_ZP,  I::CMX_ZP,
+        I::CMY_ZP,  I::STA_ZP,  I::STX_ZP,  I::STY_ZP,  I::LDA_ZPX,
+        I::ADC_ZPX, I::STA_ZPX, I::LDY_ZPX, I::STY_ZPX, I::LDX_ZPY,
+        I::STX_ZPY, I::INC_ZP,  I::ROR_ZP,  I::BIT_ZP,  I::LDA_INDY};
+    static const uint8_t immediate[] = {
+        I::LDA_IMM, I::LDX_IMM, I::LDY_IMM, I::ADC_IMM, I::SBC_IMM,
+        I::AND_IMM, I::ORA_IMM, I::EOR_IMM, I::CMP_IMM, I::CMX_IMM,
+        I::CMY_IMM};
+    static const uint8_t absolute[] = {
+        I::LDA_ABS,  I::STA_ABS,  I::ADC_ABS,  I::SBC_ABSY, I::LDA_ABSX,
+        I::LDA_ABSY, I::STA_ABSX, I::STA_ABSY, I::LDX_ABSY, I::LDY_ABSX,
+        I::CMP_ABSX, I::ORA_ABSY, I::STX_ABS,  I::STY_ABS,  I::CMX_ABS,
+        I::INC_ABS};
+    static const uint8_t implied[] = {
+        I::INX,     I::INY,     I::DEX,     I::DEY,     I::TAX,
+        I::TAY,     I::TXA,     I::CLC,     I::SEC,     I::CLV,
+        I::CLD,     I::SED,     I::NOP,     I::ASL_ACC, I::LSR_ACC,
+        I::ROL_ACC, I::ROR_ACC, I::PHA,     I::PLA,     I::TYA};
+    static const uint8_t branches[] = {I::BCC, I::BCS, I::BEQ, I::BNE,
+                                       I::BMI, I::BPL, I::BVC, I::BVS};
+
+    auto pick = [&](const auto& list) {
+        return list[random() % (sizeof(list) / sizeof(list[0]))];
+    };
+
+    std::vector<std::vector<uint8_t>> instructions;
+    int count = 1 + random() % 30;
+    for (int i = 0; i < count; i++) {
+        switch (random() % 6) {
+        case 0:
+            instructions.push_back({pick(zero_page), uint8_t(random())});
+            break;
+        case 1:
+            instructions.push_back({pick(immediate), uint8_t(random())});
+            break;
+        case 2:
+            instructions.push_back({pick(absolute), uint8_t(random()),
+                                    uint8_t(2 + random() % 2)});
+            break;
+        case 3:
+            instructions.push_back({pick(implied)});
+            break;
+        default:
+            instructions.push_back({pick(branches), 0});
+            break;
+        }
+    }
+
+    std::vector<uint8_t> code;
+    for (size_t i = 0; i < instructions.size(); i++) {
+        if (instructions[i].size() == 2 && i + 1 < instructions.size() &&
+            instructions[i][1] == 0) {
+            instructions[i][1] = instructions[i + 1].size();
+        }
+        code.insert(code.end(), instructions[i].begin(), instructions[i].end());
+    }
+    code.insert(code.end(), {Instruction::JMP_ABS, 0x00, 0x80});
+    return code;
+}
+
+static void setup_lane(CPU& cpu, uint32_t seed) {
+    std::mt19937 random(seed);
+    for (uint16_t address = 0; address < 0x100; address++) {
+        cpu.GetMemory().write(address, uint8_t(random()));
+    }
+    for (uint16_t address = 0x200; address < 0x400; address++) {
+        cpu.GetMemory().write(address, uint8_t(random()));
+    }
+    cpu.AC = random();
+    cpu.X = random();
+    cpu.Y = random();
+    // Mostly binary mode, some lanes decimal.
+    cpu.SR.Set(random() & (random() % 4 == 0 ? 0xFF : 0xF7));
+    cpu.SR.I = 0;
+
+    // Some lanes take an IRQ, serviced by INC $40; RTI at 0x9000.
+    if (random() % 2 == 0) {
+        uint64_t cycle = random() % 1000;
+        cpu.ScheduleEvent(cycle, [](CPU& c) { c.AssertIRQ(); });
+        cpu.ScheduleEvent(cycle + 30, [](CPU& c) { c.ReleaseIRQ(); });
+    }
+}
+
+static void setup_prototype(CPU& cpu) {
+    uint8_t handler[] = {Instruction::INC_ZP, 0x40, Instruction::RTI};
+    cpu.GetMemory().write(0x9000, handler, sizeof(handler));
+    cpu.GetMemory().write(0xFFFE, 0x00);
+    cpu.GetMemory().write(0xFFFF, 0x90);
+}
+
+static void expect_same(CPU& lane, CPU& scalar) {
+    EXPECT_EQ(lane.PC, scalar.PC);
+    EXPECT_EQ(lane.AC, scalar.AC);
+    EXPECT_EQ(lane.X, scalar.X);
+    EXPECT_EQ(lane.Y, scalar.Y);
+    EXPECT_EQ(lane.SP, scalar.SP);
+    EXPECT_EQ(lane.SR.Value(), scalar.SR.Value());
+    EXPECT_EQ(lane.GetCycles(), scalar.GetCycles());
+    EXPECT_EQ(lane.IsTrapped(), scalar.IsTrapped());
+    for (uint32_t address = 0; address < 0x400; address++) {
+        ASSERT_EQ(lane.Peek(address), scalar.Peek(address)) << address;
+    }
+}
+
+TEST(LockstepTestSuite, RandomProgramsMatchScalar) {
+    const size_t lanes = 24;
+    for (uint32_t seed = 0; seed < 100; seed++) {
+        std::mt19937 random(seed);
+        auto code = random_program(random);
+        uint64_t budgets[] = {50 + random() % 2000, 1 + random() % 100};
+
+        CPU prototype(code.data(), code.size(), Engine::Table);
+        setup_prototype(prototype);
+        Lockstep batch(prototype, lanes);
+        std::vector<std::unique_ptr<CPU>> scalars;
+        for (size_t i = 0; i < lanes; i++) {
+            scalars.emplace_back(
+                new CPU(code.data(), code.size(), Engine::Table));
+            setup_prototype(*scalars[i]);
+            setup_lane(*scalars[i], seed * lanes + i);
+            setup_lane(batch.GetLane(i), seed * lanes + i);
+        }
+        // A lane whose code page isn't shared runs on its own.
+        batch.GetLane(3).GetMemory().write(0x80FF, 0xEA);
+        scalars[3]->GetMemory().write(0x80FF, 0xEA);
+
+        for (uint64_t budget : budgets) {
+            batch.Run(budget);
+            for (auto& scalar : scalars) {
+                scalar->Run(budget);
+            }
+        }
+
+        SCOPED_TRACE(seed);
+        for (size_t i = 0; i < lanes; i++) {
+            SCOPED_TRACE(i);
+            expect_same(batch.GetLane(i), *scalars[i]);
+        }
+    }
+}
+
+TEST(LockstepTestSuite, DivergentLoopsRegroup) {
+    // loop: CLC; ADC #3; STA $0200,X; DEX; BNE loop; then an unknown op_code
+    uint8_t program[] = {Instruction::CLC,      Instruction::ADC_IMM, 0x03,
+                         Instruction::STA_ABSX, 0x00,                 0x02,
+                         Instruction::DEX,      Instruction::BNE,     0xF7,
+                         0x02};
+    CPU prototype(program, sizeof(program), Engine::Table);
+    Lockstep batch(prototype, 16);
+    for (size_t i = 0; i < batch.GetLaneCount(); i++) {
+        batch.GetLane(i).X = 10 + i;
+    }
+    batch.Run(1000);
+
+    for (size_t i = 0; i < batch.GetLaneCount(); i++) {
+        CPU scalar(program, sizeof(program), Engine::Table);
+        scalar.X = 10 + i;
+        scalar.Run(1000);
+        SCOPED_TRACE(i);
+        expect_same(batch.GetLane(i), scalar);
+        EXPECT_TRUE(batch.GetLane(i).IsTrapped());
+    }
+    // Only the first store to page 2, which copies it, and the trapping
+    // op_code ran on single lanes.
+    EXPECT_EQ(batch.CountScalarInstructions(), 2u * 16);
+    EXPECT_GT(batch.CountVectorInstructions(), 16u * 10 * 5);
+}
+
+TEST(LockstepTestSuite, BreakpointStopsOneLane) {
+    // loop: DEX; BNE loop; then an unknown op_code
+    uint8_t program[] = {Instruction::DEX, Instruction::BNE, 0xFD, 0x02};
+    CPU prototype(program, sizeof(program), Engine::Table);
+    Lockstep batch(prototype, 8);
+    for (size_t i = 0; i < batch.GetLaneCount(); i++) {
+        batch.GetLane(i).X = 20;
+    }
+    // Lanes have memories of their own.
+    batch.GetLane(3).SetBreakpoint(0x8003);
+    batch.Run(1000);
+
+    for (size_t i = 0; i < batch.GetLaneCount(); i++) {
+        SCOPED_TRACE(i);
+        EXPECT_EQ(batch.GetLane(i).IsWatchHit(), i == 3);
+        EXPECT_EQ(batch.GetLane(i).IsTrapped(), i != 3);
+        EXPECT_EQ(batch.GetLane(i).PC, 0x8003);
+        EXPECT_EQ(batch.GetLane(i).X, 0);
+    }
+
+    batch.Run(1000);
+    EXPECT_TRUE(batch.GetLane(3).IsTrapped());
+    EXPECT_EQ(batch.GetLane(3).GetCycles(), batch.GetLane(0).GetCycles());
+}
@@ -0,0 +1,102 @@
+#include <CPU.h>
+#include <Mapper.h>
+#include <gtest/gtest.h>
+#include <instructions.h>
+#include <vector>
+
+/**
+ * @brief An image whose every bank starts with its own number, so reading the
+ * first byte of a window tells which bank is mapped there.
+ * */
+static std::vector<uint8_t> make_image(uint32_t bank_size, uint32_t banks) {
+    std::vector<uint8_t> image(bank_size * banks, 0xEA);
+    for (uint32_t bank = 0; bank < banks; bank++) {
+        image[bank * bank_size] = bank;
+    }
+    return image;
+}
+
+TEST(MapperTestSuite, UxROMSwitchesLowerWindow) {
+    auto image = make_image(16 * 1024, 8);
+    UxROMMapper mapper(image.data(), image.size());
+    Memory memory;
+    mapper.Attach(memory);
+
+    EXPECT_EQ(mapper.GetBankCount(), 8u);
+    EXPECT_EQ(memory.read(0x8000), 0);
+    EXPECT_EQ(memory.read(0xC000), 7);
+    EXPECT_EQ(memory.GetPageKind(0x80), PageKind::ROM);
+
+    memory.write(0x9234, 5);
+    EXPECT_EQ(mapper.GetBank(), 5u);
+    EXPECT_EQ(memory.read(0x8000), 5);
+    EXPECT_EQ(memory.read(0xC000), 7);
+
+    // The bank register ignores the bits above the bank count.
+    memory.write(0xFFFF, 8 + 3);
+    EXPECT_EQ(memory.read(0x8000), 3);
+}
+
+TEST(MapperTestSuite, BankSwitchDoesNotCopy) {
+    auto image = make_image(16 * 1024, 4);
+    UxROMMapper mapper(image.data(), image.size());
+    Memory memory;
+    mapper.Attach(memory);
+
+    memory.write(0x8000, 2);
+    image[2 * 16 * 1024 + 0x10] = 0x42;
+    EXPECT_EQ(memory.read(0x8010), 0x42);
+
+    // The CPU can not write through ROM into the image.
+    EXPECT_EQ(memory.read(0xC000), 3);
+    EXPECT_EQ(image[3 * 16 * 1024], 3);
+}
+
+TEST(MapperTestSuite, WindowRegisters) {
+    auto image = make_image(8 * 1024, 16);
+    WindowMapper mapper(image.data(), image.size(), 0x50);
+    Memory memory;
+    mapper.Attach(memory);
+
+    EXPECT_EQ(memory.GetPageKind(0x50), PageKind::DEVICE);
+    EXPECT_EQ(memory.read(0x8000), 0);
+    EXPECT_EQ(memory.read(0xA000), 1);
+    EXPECT_EQ(memory.read(0xC000), 2);
+    EXPECT_EQ(memory.read(0xE000), 15);
+
+    memory.write(0x5001, 9);
+    memory.write(0x5006, 12); // mirrors register 2
+    EXPECT_EQ(memory.read(0xA000), 9);
+    EXPECT_EQ(memory.read(0xC000), 12);
+    EXPECT_EQ(memory.read(0x5002), 12);
+    EXPECT_EQ(mapper.GetBank(1), 9u);
+
+    // Writes to the windows are ignored.
+    memory.write(0xA000, 3);
+    EXPECT_EQ(memory.read(0xA000), 9);
+}
+
+TEST(MapperTestSuite, CPUSwitchesBanks) {
+    // STA $5000 with A=1 maps bank 1 over the running code in bank 0, so
+    // the following LDX reads its operand from bank 1.
+    auto image = make_image(8 * 1024, 4);
+    for (uint8_t bank : {0, 1}) {
+        uint8_t code[] = {Instruction::LDA_IMM, 0x01,
+                          Instruction::STA_ABS, 0x00,
+                          0x50,                 Instruction::LDX_IMM,
+                          (uint8_t)(0x10 + bank), 0x02};
+        std::copy(code, code + sizeof(code), &image[bank * 8 * 1024]);
+    }
+    // Reset vector in the last bank, mapped at 0xE000.
+    image[4 * 8 * 1024 - 4] = 0x00;
+    image[4 * 8 * 1024 - 3] = 0x80;
+
+    WindowMapper mapper(image.data(), image.size(), 0x50);
+    CPU cpu(mapper);
+    EXPECT_EQ(cpu.PC, 0x8000);
+    cpu.Execute();
+
+    EXPECT_EQ(cpu.X, 0x11);
+    EXPECT_EQ(mapper.GetBank(0), 1u);
+    EXPECT_TRUE(cpu.IsTrapped());
+}
@@ -0,0 +1,161 @@
+#include <CPU.h>
+#include <gtest/gtest.h>
+#include <instructions.h>
+#include <vector>
+
+class RecordingDevice : public Device {
+  public:
+    uint8_t Read(uint16_t address) override {
+        reads.push_back(address);
+        return 0x5A;
+    }
+
+    void Write(uint16_t address, uint8_t data) override {
+        writes.push_back({address, data});
+    }
+
+    uint8_t Peek(uint16_t) override { return 0x5A; }
+
+    std::vector<uint16_t> reads;
+    std::vector<std::pair<uint16_t, uint8_t>> writes;
+};
+
+TEST(MemoryTestSuite, RAMByDefault) {
+    Memory memory;
+    for (int page = 0; page < MEM_PAGE_COUNT; page++) {
+        EXPECT_EQ(memory.GetPageKind(page), PageKind::RAM);
+    }
+    memory.write(0x1234, 0x42);
+    EXPECT_EQ(memory.read(0x1234), 0x42);
+    EXPECT_EQ(memory.read(0x1235), 0x00);
+}
+
+TEST(MemoryTestSuite, ROMIgnoresWrites) {
+    Memory memory;
+    uint8_t image[] = {0x11, 0x22};
+    memory.MapROM(0xE0, 0x20);
+    memory.write(0xE000, image, sizeof(image));
+
+    memory.write(0xE000, 0xFF);
+    EXPECT_EQ(memory.read(0xE000), 0x11);
+    EXPECT_EQ(memory.read(0xE001), 0x22);
+    EXPECT_EQ(memory.GetPageKind(0xFF), PageKind::ROM);
+    EXPECT_EQ(memory.GetPageKind(0xDF), PageKind::RAM);
+}
+
+TEST(MemoryTestSuite, DeviceSeesAccesses) {
+    Memory memory;
+    RecordingDevice device;
+    memory.MapDevice(0xD0, 1, &device);
+
+    EXPECT_EQ(memory.read(0xD012), 0x5A);
+    memory.write(0xD0FF, 0x01);
+    EXPECT_EQ(memory.peek(0xD000), 0x5A);
+    memory.write(0xD100, 0x02);
+
+    EXPECT_EQ(device.reads, std::vector<uint16_t>{0xD012});
+    ASSERT_EQ(device.writes.size(), 1u);
+    EXPECT_EQ(device.writes[0].first, 0xD0FF);
+    EXPECT_EQ(device.writes[0].second, 0x01);
+    EXPECT_EQ(memory.read(0xD100), 0x02);
+}
+
+TEST(MemoryTestSuite, CPUWritesToDevice) {
+    uint8_t program[] = {Instruction::LDA_ABS, 0x00, 0xD0,
+                         Instruction::STA_ABS, 0x01, 0xD0};
+    CPU cpu(program, sizeof(program));
+    RecordingDevice device;
+    cpu.GetMemory().MapDevice(0xD0, 1, &device);
+    cpu.Execute();
+
+    EXPECT_EQ(cpu.AC, 0x5A);
+    EXPECT_EQ(device.reads, std::vector<uint16_t>{0xD000});
+    ASSERT_EQ(device.writes.size(), 1u);
+    EXPECT_EQ(device.writes[0].first, 0xD001);
+    EXPECT_EQ(device.writes[0].second, 0x5A);
+    EXPECT_EQ(cpu.GetCycles(), 8u);
+}
+
+TEST(MemoryTestSuite, NewMemoryAllocatesNothing) {
+    Memory memory;
+    EXPECT_EQ(memory.CountPrivatePages(), 0);
+    EXPECT_EQ(memory.read(0x0000), 0x00);
+    EXPECT_EQ(memory.read(0xFFFF), 0x00);
+
+    memory.write(0x0201, 0x42);
+    memory.write(0x02FF, 0x43);
+    EXPECT_EQ(memory.CountPrivatePages(), 1);
+    EXPECT_EQ(memory.read(0x0201), 0x42);
+    EXPECT_EQ(memory.read(0x0301), 0x00);
+}
+
+TEST(MemoryTestSuite, CloneIsCopyOnWrite) {
+    auto memory = std::make_shared<Memory>();
+    memory->write(0x0010, 0x11);
+    memory->write(0x0110, 0x22);
+    memory->MapROM(0xF0, 0x10);
+    uint8_t rom[] = {0x33};
+    memory->write(0xF000, rom, sizeof(rom));
+    EXPECT_EQ(memory->CountPrivatePages(), 3);
+
+    auto clone = memory->Clone();
+    EXPECT_EQ(memory->CountPrivatePages(), 0);
+    EXPECT_EQ(clone->CountPrivatePages(), 0);
+    EXPECT_EQ(clone->read(0x0010), 0x11);
+    EXPECT_EQ(clone->read(0xF000), 0x33);
+    EXPECT_EQ(clone->GetPageKind(0xF0), PageKind::ROM);
+
+    clone->write(0x0010, 0x99);
+    EXPECT_EQ(clone->read(0x0010), 0x99);
+    EXPECT_EQ(memory->read(0x0010), 0x11);
+    EXPECT_EQ(clone->CountPrivatePages(), 1);
+
+    // The original is the last owner of its pages once the clone is gone.
+    clone.reset();
+    EXPECT_EQ(memory->CountPrivatePages(), 3);
+    memory->write(0x0110, 0x23);
+    EXPECT_EQ(memory->read(0x0110), 0x23);
+}
+
+TEST(MemoryTestSuite, CPUsShareMemory) {
+    uint8_t program[] = {Instruction::INC_ABS, 0x00, 0x02};
+    auto memory = std::make_shared<Memory>();
+    memory->write(0x8000, program, sizeof(program));
+    memory->write(0xFFFD, 0x80);
+
+    CPU first(memory);
+    CPU second(memory);
+    CPU cloned(memory->Clone());
+    EXPECT_EQ(first.PC, 0x8000);
+    first.Execute();
+    second.Execute();
+    cloned.Execute();
+
+    EXPECT_EQ(memory->read(0x0200), 2);
+    EXPECT_EQ(cloned.Peek(0x0200), 1);
+    EXPECT_LT(sizeof(CPU), 256u);
+}
+
+TEST(MemoryTestSuite, CodeVersions) {
+    Memory memory;
+    Memory other;
+    EXPECT_NE(memory.GetCodeVersion(0x80), other.GetCodeVersion(0x80));
+
+    uint32_t version = memory.GetCodeVersion(0x80);
+    memory.write(0x8000, 0x01);
+    EXPECT_EQ(memory.GetCodeVersion(0x80), version);
+
+    // Only the written code page changes, and only once until marked again.
+    memory.MarkCode(0x80);
+    memory.write(0x8010, 0x02);
+    EXPECT_NE(memory.GetCodeVersion(0x80), version);
+    EXPECT_EQ(memory.GetCodeVersion(0x81), version);
+    EXPECT_EQ(memory.read(0x8010), 0x02);
+    version = memory.GetCodeVersion(0x80);
+    memory.write(0x8011, 0x03);
+    EXPECT_EQ(memory.GetCodeVersion(0x80), version);
+
+    memory.MapROM(0x80, 1);
+    EXPECT_NE(memory.GetCodeVersion(0x80), version);
+    EXPECT_EQ(memory.read(0x8011), 0x03);
+}
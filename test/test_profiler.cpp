@@ -0,0 +1,189 @@
+#include <CPU.h>
+#include <Profiler.h>
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <instructions.h>
+#include <sstream>
+#include <vector>
+
+// LDX #3; loop: DEX; BNE loop; then an unknown op_code
+static uint8_t program[] = {Instruction::LDX_IMM, 0x03, Instruction::DEX,
+                            Instruction::BNE,     0xFD, 0x02};
+
+TEST(ProfilerTestSuite, CyclesPerPCAndOpCode) {
+    CPU cpu(program, sizeof(program));
+    Profiler profiler;
+    cpu.SetProfiler(&profiler);
+    cpu.Execute();
+
+    CPU plain(program, sizeof(program));
+    plain.Execute();
+    EXPECT_EQ(cpu.GetCycles(), plain.GetCycles());
+
+    EXPECT_EQ(profiler.GetCycles(0x8000), 2u);
+    EXPECT_EQ(profiler.GetCycles(0x8002), 3u * 2);
+    // Taken twice, then falls through.
+    EXPECT_EQ(profiler.GetCycles(0x8003), 3u + 3 + 2);
+    EXPECT_EQ(profiler.GetCycles(0x8005), cpu.GetCycles() - 16);
+    EXPECT_EQ(profiler.GetTotalCycles(), cpu.GetCycles());
+
+    EXPECT_EQ(profiler.GetOpCount(Instruction::LDX_IMM), 1u);
+    EXPECT_EQ(profiler.GetOpCount(Instruction::DEX), 3u);
+    EXPECT_EQ(profiler.GetOpCount(Instruction::BNE), 3u);
+    EXPECT_EQ(profiler.GetOpCount(0x02), 1u);
+    EXPECT_EQ(profiler.GetOpCycles(Instruction::BNE), 8u);
+
+    // A second run adds up, Reset starts over.
+    CPU again(program, sizeof(program));
+    again.SetProfiler(&profiler);
+    again.Execute();
+    EXPECT_EQ(profiler.GetOpCount(Instruction::DEX), 6u);
+    profiler.Reset();
+    EXPECT_EQ(profiler.GetTotalCycles(), 0u);
+    EXPECT_EQ(profiler.GetOpCount(Instruction::DEX), 0u);
+}
+
+TEST(ProfilerTestSuite, Reports) {
+    CPU cpu(program, sizeof(program));
+    Profiler profiler;
+    cpu.SetProfiler(&profiler);
+    cpu.Execute();
+
+    std::ostringstream hotspots, op_codes, flame_graph;
+    profiler.WriteHotspots(hotspots, 2);
+    profiler.WriteOpCodes(op_codes);
+    profiler.WriteFlameGraph(flame_graph);
+
+    std::string text = hotspots.str();
+    EXPECT_EQ(std::count(text.begin(), text.end(), '\n'), 3);
+    std::string line;
+    std::istringstream lines(text);
+    std::getline(lines, line);
+    std::getline(lines, line);
+    EXPECT_EQ(line.rfind("0x8003              8", 0), 0u) << line;
+    EXPECT_NE(line.find("BNE"), std::string::npos) << line;
+
+    lines = std::istringstream(op_codes.str());
+    std::getline(lines, line);
+    std::getline(lines, line);
+    EXPECT_EQ(line.rfind("BNE ", 0), 0u) << line;
+    EXPECT_NE(op_codes.str().find("OP_02"), std::string::npos);
+
+    EXPECT_EQ(flame_graph.str(), "page_80;8000_LDX_IMM 2\n"
+                                 "page_80;8002_DEX 6\n"
+                                 "page_80;8003_BNE 8\n"
+                                 "page_80;8005_OP_02 " +
+                                     std::to_string(cpu.GetCycles() - 16) +
+                                     "\n");
+}
+
+static void load(CPU& cpu, uint16_t address, std::vector<uint8_t> code) {
+    cpu.GetMemory().write(address, code.data(), code.size());
+}
+
+// JSR $8010; an unknown op_code
+static uint8_t caller[] = {Instruction::JSR, 0x10, 0x80, 0x02};
+
+TEST(ProfilerTestSuite, InclusiveAndExclusiveCycles) {
+    CPU cpu(caller, sizeof(caller));
+    // outer: JSR inner; LDA #1; RTS  inner: NOP; RTS
+    load(cpu, 0x8010,
+         {Instruction::JSR, 0x20, 0x80, Instruction::LDA_IMM, 0x01,
+          Instruction::RTS});
+    load(cpu, 0x8020, {Instruction::NOP, Instruction::RTS});
+    Profiler profiler;
+    cpu.SetProfiler(&profiler);
+    cpu.Run(1000);
+    ASSERT_TRUE(cpu.IsTrapped());
+
+    EXPECT_EQ(profiler.GetExclusiveCycles(0x8020), 2u + 6);
+    EXPECT_EQ(profiler.GetInclusiveCycles(0x8020), 2u + 6);
+    EXPECT_EQ(profiler.GetExclusiveCycles(0x8010), 6u + 2 + 6);
+    EXPECT_EQ(profiler.GetInclusiveCycles(0x8010), 6u + 2 + 6 + 8);
+    EXPECT_EQ(profiler.GetInclusiveCycles(0x8000), cpu.GetCycles());
+    EXPECT_EQ(profiler.GetCallCount(0x8010), 1u);
+    EXPECT_EQ(profiler.GetCallStack(), std::vector<std::string>{"start_8000"});
+
+    std::ostringstream stacks;
+    profiler.WriteCallStacks(stacks);
+    EXPECT_EQ(stacks.str(), "start_8000 " +
+                                std::to_string(cpu.GetCycles() - 22) +
+                                "\n"
+                                "start_8000;sub_8010 14\n"
+                                "start_8000;sub_8010;sub_8020 8\n");
+
+    std::ostringstream routines;
+    profiler.WriteRoutines(routines);
+    std::istringstream lines(routines.str());
+    std::string line;
+    std::getline(lines, line);
+    std::getline(lines, line);
+    EXPECT_EQ(line.rfind("start_8000 ", 0), 0u) << line;
+    std::getline(lines, line);
+    EXPECT_EQ(line.rfind("sub_8010 ", 0), 0u) << line;
+}
+
+TEST(ProfilerTestSuite, RecursionCountsOnce) {
+    CPU cpu(caller, sizeof(caller));
+    // DEX; BEQ +3; JSR $8010; RTS
+    load(cpu, 0x8010,
+         {Instruction::DEX, Instruction::BEQ, 0x03, Instruction::JSR, 0x10,
+          0x80, Instruction::RTS});
+    cpu.X = 3;
+    Profiler profiler;
+    cpu.SetProfiler(&profiler);
+    cpu.Run(1000);
+
+    EXPECT_EQ(profiler.GetCallCount(0x8010), 3u);
+    EXPECT_EQ(profiler.GetInclusiveCycles(0x8010),
+              profiler.GetExclusiveCycles(0x8010));
+    EXPECT_EQ(profiler.GetInclusiveCycles(0x8000), cpu.GetCycles());
+}
+
+TEST(ProfilerTestSuite, StackTricks) {
+    CPU cpu(caller, sizeof(caller));
+    // Reads its return address like a routine with inline arguments would,
+    // puts it back and jumps through an RTS dispatch to $8030.
+    load(cpu, 0x8010,
+         {Instruction::PLA, Instruction::STA_ZP, 0x10, Instruction::PLA,
+          Instruction::PHA, Instruction::LDA_ZP, 0x10, Instruction::PHA,
+          Instruction::LDA_IMM, 0x80, Instruction::PHA, Instruction::LDA_IMM,
+          0x2F, Instruction::PHA, Instruction::RTS});
+    load(cpu, 0x8030, {Instruction::NOP, Instruction::RTS});
+    Profiler profiler;
+    cpu.SetProfiler(&profiler);
+
+    // Up to the NOP at $8030.
+    cpu.Run(6 + 3 + 3 + 4 + 3 + 3 + 3 + 2 + 3 + 2 + 3 + 6 + 2);
+    EXPECT_EQ(cpu.PC, 0x8031);
+    EXPECT_EQ(profiler.GetCallStack(),
+              (std::vector<std::string>{"start_8000", "sub_8030"}));
+
+    cpu.Run(1000);
+    ASSERT_TRUE(cpu.IsTrapped());
+    EXPECT_EQ(profiler.GetCallStack(), std::vector<std::string>{"start_8000"});
+    EXPECT_EQ(profiler.GetCallCount(0x8030), 1u);
+    EXPECT_EQ(profiler.GetExclusiveCycles(0x8030), 2u + 6);
+}
+
+TEST(ProfilerTestSuite, InterruptRightAfterJSR) {
+    CPU cpu(caller, sizeof(caller));
+    load(cpu, 0x8010, {Instruction::NOP, Instruction::RTS});
+    load(cpu, 0x9000, {Instruction::INC_ZP, 0x10, Instruction::RTI});
+    load(cpu, 0xFFFE, {0x00, 0x90});
+    cpu.ScheduleEvent(6, [](CPU& c) { c.AssertIRQ(); });
+    cpu.ScheduleEvent(10, [](CPU& c) { c.ReleaseIRQ(); });
+    Profiler profiler;
+    cpu.SetProfiler(&profiler);
+    cpu.Run(1000);
+    ASSERT_TRUE(cpu.IsTrapped());
+    ASSERT_EQ(cpu.Peek(0x10), 1);
+
+    std::ostringstream stacks;
+    profiler.WriteCallStacks(stacks);
+    EXPECT_NE(stacks.str().find("start_8000;sub_8010;int_9000 11\n"),
+              std::string::npos)
+        << stacks.str();
+    EXPECT_EQ(profiler.GetCallCount(0x9000), 1u);
+    EXPECT_EQ(profiler.GetCallStack(), std::vector<std::string>{"start_8000"});
+}
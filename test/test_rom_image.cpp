@@ -0,0 +1,40 @@
+#include <CPU.h>
+#include <RomImage.h>
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <instructions.h>
+#include <unistd.h>
+
+static std::string write_image(const uint8_t* data, size_t size) {
+    // ctest runs this binary once per engine at the same time.
+    std::string path = testing::TempDir() + "rom_image_test_" +
+                       std::to_string(getpid()) + ".bin";
+    FILE* file = fopen(path.c_str(), "wb");
+    fwrite(data, 1, size, file);
+    fclose(file);
+    return path;
+}
+
+TEST(RomImageTestSuite, MissingFile) {
+    RomImage rom(testing::TempDir() + "no_such_image.bin");
+    EXPECT_FALSE(rom.IsOpen());
+}
+
+TEST(RomImageTestSuite, MappedAsROM) {
+    uint8_t program[] = {Instruction::LDA_IMM, 0x42, Instruction::STA_ABS,
+                         0x00,                 0x80};
+    RomImage rom(write_image(program, sizeof(program)));
+    ASSERT_TRUE(rom.IsOpen());
+    ASSERT_EQ(rom.GetSize(), sizeof(program));
+
+    CPU cpu(rom);
+    EXPECT_EQ(cpu.PC, 0x8000);
+    EXPECT_EQ(cpu.GetMemory().GetPageKind(0x80), PageKind::ROM);
+    EXPECT_EQ(cpu.GetMemory().GetPageKind(0x81), PageKind::RAM);
+    cpu.Execute();
+
+    EXPECT_EQ(cpu.AC, 0x42);
+    EXPECT_EQ(cpu.Peek(0x8000), Instruction::LDA_IMM);
+    EXPECT_EQ(cpu.Peek(0x8005), 0x00);
+    EXPECT_EQ(cpu.GetCycles(), 6u);
+}
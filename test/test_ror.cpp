@@ -0,0 +1,27 @@
+#include <CPU.h>
+#include <gtest/gtest.h>
+#include <instructions.h>
+
+TEST(RORTestSuite, ACC) {
+    uint8_t program[] = {Instruction::ROR_ACC};
+    CPU cpu(program, sizeof(program));
+    cpu.AC = 0x03;
+    cpu.SR.C = 1;
+    cpu.Execute();
+    EXPECT_EQ(cpu.GetCycles(), 2);
+    EXPECT_EQ(cpu.AC, 0x81);
+    EXPECT_EQ(cpu.SR.C, 1);
+    EXPECT_EQ(cpu.SR.N, 1);
+    EXPECT_EQ(cpu.SR.Z, 0);
+}
+
+TEST(RORTestSuite, ACCToZero) {
+    uint8_t program[] = {Instruction::ROR_ACC};
+    CPU cpu(program, sizeof(program));
+    cpu.AC = 0x01;
+    cpu.Execute();
+    EXPECT_EQ(cpu.AC, 0x00);
+    EXPECT_EQ(cpu.SR.C, 1);
+    EXPECT_EQ(cpu.SR.Z, 1);
+    EXPECT_EQ(cpu.SR.N, 0);
+}
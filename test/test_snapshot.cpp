@@ -0,0 +1,81 @@
+#include <CPU.h>
+#include <gtest/gtest.h>
+#include <instructions.h>
+
+TEST(SnapshotTestSuite, RestoreRegistersAndMemory) {
+    // INC $0200; INX; SEC; LDA $0200; then an unknown op_code
+    uint8_t program[] = {Instruction::INC_ABS, 0x00, 0x02,
+                         Instruction::INX,     Instruction::SEC,
+                         Instruction::LDA_ABS, 0x00,
+                         0x02,                 0x02};
+    CPU cpu(program, sizeof(program));
+    auto state = cpu.Snapshot();
+    EXPECT_EQ(cpu.GetMemory().CountDirtyPages(), 0);
+
+    cpu.Execute();
+    EXPECT_TRUE(cpu.IsTrapped());
+    EXPECT_EQ(cpu.AC, 1);
+    EXPECT_EQ(cpu.GetMemory().CountDirtyPages(), 1);
+
+    for (int run = 0; run < 3; run++) {
+        cpu.Restore(state);
+        EXPECT_EQ(cpu.GetMemory().CountDirtyPages(), 0);
+        EXPECT_EQ(cpu.GetMemory().CountPrivatePages(), 0);
+        EXPECT_EQ(cpu.PC, 0x8000);
+        EXPECT_EQ(cpu.X, 0);
+        EXPECT_EQ(cpu.SR.C, 0);
+        EXPECT_EQ(cpu.GetCycles(), 0u);
+        EXPECT_FALSE(cpu.IsTrapped());
+        EXPECT_EQ(cpu.Peek(0x0200), 0);
+
+        cpu.Execute();
+        EXPECT_EQ(cpu.AC, 1);
+        EXPECT_EQ(cpu.X, 1);
+        EXPECT_EQ(cpu.SR.C, 1);
+        EXPECT_EQ(cpu.GetCycles(), 15u);
+    }
+}
+
+TEST(SnapshotTestSuite, RestoreMidRun) {
+    // loop: INC $0300,X; DEX; BNE loop
+    uint8_t program[] = {Instruction::INC_ABSX, 0x00, 0x03, Instruction::DEX,
+                         Instruction::BNE,      0xFA};
+    CPU cpu(program, sizeof(program));
+    cpu.Run(100);
+    auto state = cpu.Snapshot();
+    uint8_t page[256];
+    for (int i = 0; i < 256; i++) {
+        page[i] = cpu.Peek(0x0300 + i);
+    }
+
+    cpu.Run(4000);
+    cpu.Restore(state);
+    EXPECT_EQ(cpu.PC, state.PC);
+    EXPECT_EQ(cpu.X, state.X);
+    for (int i = 0; i < 256; i++) {
+        EXPECT_EQ(cpu.Peek(0x0300 + i), page[i]);
+    }
+
+    cpu.Run(4000);
+    for (int i = 0; i < 256; i++) {
+        EXPECT_EQ(cpu.Peek(0x0300 + i), 1);
+    }
+}
+
+TEST(SnapshotTestSuite, RestoreOlderSnapshot) {
+    uint8_t program[] = {Instruction::INC_ABS, 0x00, 0x02};
+    CPU cpu(program, sizeof(program));
+    auto first = cpu.Snapshot();
+    cpu.Execute();
+    auto second = cpu.Snapshot();
+    cpu.GetMemory().MapROM(0x02, 1);
+
+    cpu.Restore(first);
+    EXPECT_EQ(cpu.Peek(0x0200), 0);
+    EXPECT_EQ(cpu.GetCycles(), 0u);
+    EXPECT_EQ(cpu.GetMemory().GetPageKind(0x02), PageKind::RAM);
+
+    cpu.Restore(second);
+    EXPECT_EQ(cpu.Peek(0x0200), 1);
+    EXPECT_EQ(cpu.GetCycles(), 6u);
+}
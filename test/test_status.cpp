@@ -34,3 +34,58 @@ TEST(StatusTestSuite, TEST_CLV) {
     EXPECT_EQ(cpu.GetCycles(), 2);
     EXPECT_EQ(cpu.SR.V, 0);
 }
+
+TEST(StatusTestSuite, SetValueRoundTrip) {
+    CPU::StatusRegister sr;
+    for (int value = 0; value < 256; value++) {
+        sr.Set(value);
+        EXPECT_EQ(sr.Value(), value | 0x20);
+        EXPECT_EQ(sr.N, GET_BIT(value, 7));
+        EXPECT_EQ(sr.Z, GET_BIT(value, 1));
+        EXPECT_EQ(sr.C, GET_BIT(value, 0));
+    }
+}
+
+TEST(StatusTestSuite, FlagsAssignIndependently) {
+    CPU::StatusRegister sr;
+    EXPECT_EQ(sr.Value(), 0x20);
+    sr.N = 1;
+    sr.Z = 1;
+    EXPECT_EQ(sr.Value(), 0xA2);
+    sr.SetNZ(0x00);
+    sr.N = 1;
+    EXPECT_EQ(sr.Value(), 0xA2);
+    sr.Z = 0;
+    EXPECT_EQ(sr.N, 1);
+    EXPECT_EQ(sr.Value(), 0xA0);
+    sr.C = 1;
+    sr.V = 1;
+    EXPECT_EQ(sr.Value(), 0xE1);
+}
+
+TEST(StatusTestSuite, PHPSeesLazyFlags) {
+    // LDA #$00; BIT $10; PHP
+    uint8_t program[] = {Instruction::LDA_IMM, 0x00, Instruction::BIT_ZP, 0x10,
+                         Instruction::PHP};
+    CPU cpu(program, sizeof(program));
+    cpu.GetMemory().write(0x0010, 0xC0);
+    cpu.Execute();
+    // N and V from the operand, Z from AC & operand.
+    EXPECT_EQ(cpu.Peek(0x01FF), 0xE2);
+}
+
+TEST(StatusTestSuite, IncrementAndRotateFlags) {
+    // LDX #$FF; INX; PHP; SEC; LDA #$80; ROR A; PHP; ROL A; PHP
+    uint8_t program[] = {Instruction::LDX_IMM, 0xFF, Instruction::INX,
+                         Instruction::PHP,     Instruction::SEC,
+                         Instruction::LDA_IMM, 0x80, Instruction::ROR_ACC,
+                         Instruction::PHP,     Instruction::ROL_ACC,
+                         Instruction::PHP};
+    CPU cpu(program, sizeof(program));
+    cpu.Execute();
+    EXPECT_EQ(cpu.Peek(0x01FF), 0x22);
+    // ROR moves the carry into bit 7.
+    EXPECT_EQ(cpu.Peek(0x01FE), 0xA0);
+    EXPECT_EQ(cpu.Peek(0x01FD), 0xA1);
+    EXPECT_EQ(cpu.AC, 0x80);
+}
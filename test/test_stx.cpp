@@ -0,0 +1,25 @@
+#include <CPU.h>
+#include <gtest/gtest.h>
+#include <instructions.h>
+
+TEST(STXTestSuite, ZPY) {
+    uint8_t program[] = {Instruction::STX_ZPY, 0x10};
+    CPU cpu(program, sizeof(program));
+    cpu.X = 0x42;
+    cpu.Y = 0x03;
+    cpu.Execute();
+    EXPECT_EQ(cpu.GetCycles(), 4);
+    EXPECT_EQ(cpu.GetMemory().peek(0x0013), 0x42);
+    // Indexed by Y, not X.
+    EXPECT_EQ(cpu.GetMemory().peek(0x0052), 0x00);
+}
+
+TEST(STXTestSuite, ZPYWraps) {
+    uint8_t program[] = {Instruction::STX_ZPY, 0xFF};
+    CPU cpu(program, sizeof(program));
+    cpu.X = 0x42;
+    cpu.Y = 0x02;
+    cpu.Execute();
+    EXPECT_EQ(cpu.GetMemory().peek(0x0001), 0x42);
+    EXPECT_EQ(cpu.GetMemory().peek(0x0101), 0x00);
+}
@@ -0,0 +1,100 @@
+#include <CPU.h>
+#include <gtest/gtest.h>
+#include <instructions.h>
+#include <sstream>
+#include <trace.h>
+#include <unistd.h>
+
+class CountingSink : public TraceSink {
+  public:
+    void Trace(CPU& cpu) override { pcs.push_back(cpu.PC); }
+    void Flush() override { flushed = true; }
+
+    std::vector<uint16_t> pcs;
+    bool flushed = false;
+};
+
+TEST(TraceTestSuite, SinkSeesEveryInstruction) {
+    uint8_t program[] = {Instruction::LDX_IMM, 0x02, Instruction::DEX,
+                         Instruction::BNE, 0xFD};
+    for (auto engine : {Engine::Table, Engine::Threaded, Engine::Predecoded,
+                        Engine::Jit}) {
+        CPU cpu(program, sizeof(program), engine);
+        CountingSink sink;
+        cpu.SetTraceSink(&sink);
+        cpu.Execute();
+
+        std::vector<uint16_t> expected = {0x8000, 0x8002, 0x8003, 0x8002,
+                                          0x8003};
+        EXPECT_EQ(sink.pcs, expected);
+        EXPECT_TRUE(sink.flushed);
+    }
+}
+
+TEST(TraceTestSuite, TextFormat) {
+    uint8_t program[] = {Instruction::LDA_IMM, 0x80};
+    CPU cpu(program, sizeof(program));
+    std::ostringstream out;
+    TextTraceSink sink(out);
+    cpu.SetTraceSink(&sink);
+    cpu.Execute();
+
+    EXPECT_EQ(out.str(), "0x8000: 0xA9 LDA_IMM  [A: 0x0 , X: 0x0 , Y: 0x0 , "
+                         "SP: 0xFF, SR(NV_BDIZC): 0b00100000] 0\n");
+}
+
+TEST(TraceTestSuite, DetachedSinkIsNotCalled) {
+    uint8_t program[] = {Instruction::NOP};
+    CPU cpu(program, sizeof(program));
+    CountingSink sink;
+    cpu.SetTraceSink(&sink);
+    cpu.SetTraceSink(nullptr);
+    cpu.Execute();
+    EXPECT_TRUE(sink.pcs.empty());
+    EXPECT_FALSE(sink.flushed);
+}
+
+TEST(TraceTestSuite, BinaryMatchesText) {
+    uint8_t program[] = {Instruction::LDX_IMM, 0x40, Instruction::SEC,
+                         Instruction::ADC_IMM, 0x01, Instruction::DEX,
+                         Instruction::BNE,     0xFA};
+    // ctest runs this binary once per engine at the same time.
+    std::string path = testing::TempDir() + "trace_test_" +
+                       std::to_string(getpid()) + ".bin";
+
+    std::ostringstream text;
+    {
+        CPU cpu(program, sizeof(program));
+        TextTraceSink sink(text);
+        cpu.SetTraceSink(&sink);
+        cpu.Execute();
+    }
+    {
+        CPU cpu(program, sizeof(program));
+        BinaryTraceSink sink(path, 16); // small ring to exercise wrap-around
+        ASSERT_TRUE(sink.IsOpen());
+        cpu.SetTraceSink(&sink);
+        cpu.Execute();
+    }
+
+    FILE* file = fopen(path.c_str(), "rb");
+    ASSERT_NE(file, nullptr);
+    TraceFileHeader header;
+    ASSERT_EQ(fread(&header, sizeof(header), 1, file), 1u);
+    EXPECT_STREQ(header.magic, TRACE_FILE_MAGIC);
+    EXPECT_EQ(header.version, TRACE_FILE_VERSION);
+    EXPECT_EQ(header.record_size, sizeof(TraceRecord));
+
+    std::ostringstream rendered;
+    TraceRecord record;
+    size_t count = 0;
+    while (fread(&record, sizeof(record), 1, file) == 1) {
+        FormatTraceRecord(rendered, record);
+        count++;
+    }
+    fclose(file);
+    remove(path.c_str());
+
+    EXPECT_EQ(count, 1u + 0x40 * 4);
+    EXPECT_EQ(rendered.str(), text.str());
+}
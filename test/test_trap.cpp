@@ -0,0 +1,21 @@
+#include <CPU.h>
+#include <gtest/gtest.h>
+#include <instructions.h>
+
+TEST(TrapTestSuite, UnknownOpCode) {
+    uint8_t program[] = {Instruction::LDA_IMM, 0x01, 0x02, Instruction::NOP};
+    CPU cpu(program, sizeof(program));
+    auto pc = cpu.PC;
+    cpu.Execute();
+    EXPECT_TRUE(cpu.IsTrapped());
+    EXPECT_EQ(cpu.GetTrapOpCode(), 0x02);
+    EXPECT_EQ(cpu.PC, pc + 2);
+    EXPECT_EQ(cpu.AC, 0x01);
+    EXPECT_EQ(cpu.GetCycles(), 3);
+}
+
+TEST(TrapTestSuite, TableCoversInstructionSet) {
+    EXPECT_NE(isa_table[Instruction::NOP], INST_TRAP);
+    EXPECT_EQ(isa_table[0x02], INST_TRAP);
+    EXPECT_EQ(isa_table[0xFF], INST_TRAP);
+}
@@ -0,0 +1,97 @@
+#include <CPU.h>
+#include <gtest/gtest.h>
+#include <instructions.h>
+
+static const Engine engines[] = {Engine::Table, Engine::Threaded,
+                                 Engine::Predecoded, Engine::Jit};
+
+// LDA #1; STA $10; INC $10; LDA $0201; STA $0200; an unknown op_code
+static uint8_t program[] = {Instruction::LDA_IMM, 0x01,
+                            Instruction::STA_ZP,  0x10,
+                            Instruction::INC_ZP,  0x10,
+                            Instruction::LDA_ABS, 0x01,
+                            0x02,                 Instruction::STA_ABS,
+                            0x00,                 0x02,
+                            0x02};
+
+TEST(WatchTestSuite, BreakpointStopsInFront) {
+    CPU plain(program, sizeof(program));
+    plain.Execute();
+
+    for (auto engine : engines) {
+        CPU cpu(program, sizeof(program), engine);
+        cpu.SetBreakpoint(0x8004);
+        cpu.Execute();
+        EXPECT_TRUE(cpu.IsWatchHit());
+        EXPECT_FALSE(cpu.IsTrapped());
+        EXPECT_EQ(cpu.GetWatchKind(), WATCH_EXECUTE);
+        EXPECT_EQ(cpu.GetWatchAddress(), 0x8004);
+        EXPECT_EQ(cpu.PC, 0x8004);
+        EXPECT_EQ(cpu.GetCycles(), 2u + 3);
+        EXPECT_EQ(cpu.Peek(0x10), 1);
+
+        // Continuing runs the instruction at the breakpoint.
+        cpu.Execute();
+        EXPECT_FALSE(cpu.IsWatchHit());
+        EXPECT_TRUE(cpu.IsTrapped());
+        EXPECT_EQ(cpu.Peek(0x10), 2);
+        EXPECT_EQ(cpu.GetCycles(), plain.GetCycles());
+    }
+}
+
+TEST(WatchTestSuite, WatchpointsStopAfterTheAccess) {
+    for (auto engine : engines) {
+        CPU cpu(program, sizeof(program), engine);
+        cpu.SetWatchpoint(0x0201, WATCH_READ);
+        cpu.SetWatchpoint(0x0200, WATCH_WRITE);
+        // Same page, not watched for writes.
+        cpu.SetWatchpoint(0x0202, WATCH_READ);
+
+        cpu.Execute();
+        EXPECT_TRUE(cpu.IsWatchHit());
+        EXPECT_EQ(cpu.GetWatchKind(), WATCH_READ);
+        EXPECT_EQ(cpu.GetWatchAddress(), 0x0201);
+        EXPECT_EQ(cpu.PC, 0x8009);
+
+        cpu.Execute();
+        EXPECT_TRUE(cpu.IsWatchHit());
+        EXPECT_EQ(cpu.GetWatchKind(), WATCH_WRITE);
+        EXPECT_EQ(cpu.GetWatchAddress(), 0x0200);
+        EXPECT_EQ(cpu.PC, 0x800C);
+        EXPECT_EQ(cpu.Peek(0x0200), 0);
+
+        cpu.ClearWatchpoint(0x0200, WATCH_WRITE);
+        cpu.Execute();
+        EXPECT_FALSE(cpu.IsWatchHit());
+        EXPECT_TRUE(cpu.IsTrapped());
+    }
+}
+
+TEST(WatchTestSuite, BreakpointInHotLoop) {
+    // loop: INX; INY; JMP loop
+    uint8_t loop[] = {Instruction::INX, Instruction::INY, Instruction::JMP_ABS,
+                      0x00, 0x80};
+    for (auto engine : engines) {
+        CPU cpu(loop, sizeof(loop), engine);
+        CPU::State start = cpu.Snapshot();
+        // Long enough for the caches to decode and compile the loop.
+        cpu.Run(10000);
+        EXPECT_FALSE(cpu.IsWatchHit());
+
+        cpu.SetBreakpoint(0x8001);
+        cpu.Run(10000);
+        EXPECT_TRUE(cpu.IsWatchHit());
+        EXPECT_EQ(cpu.PC, 0x8001);
+        EXPECT_EQ(uint8_t(cpu.X - cpu.Y), 1);
+
+        // Breakpoints belong to the memory, not its contents.
+        cpu.Restore(start);
+        cpu.Run(10000);
+        EXPECT_TRUE(cpu.IsWatchHit());
+        EXPECT_EQ(cpu.GetCycles(), 2u);
+
+        cpu.ClearBreakpoint(0x8001);
+        cpu.Run(10000);
+        EXPECT_FALSE(cpu.IsWatchHit());
+    }
+}
@@ -0,0 +1,83 @@
+#include <BatchRunner.h>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+/**
+ * Run the jobs of a manifest (see ParseManifest) on all cores and print one
+ * JSON line per job, in manifest order, followed by a summary on stderr.
+ * Exits with 1 when any job failed to load.
+ * */
+int main(int argc, char** argv) {
+    size_t workers = 0;
+    bool pin = true;
+    Engine engine = CPU::GetDefaultEngine();
+    const char* output_file = nullptr;
+    const char* path = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            workers = strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--no-pin") == 0) {
+            pin = false;
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output_file = argv[++i];
+        } else if (strcmp(argv[i], "--engine=table") == 0) {
+            engine = Engine::Table;
+        } else if (strcmp(argv[i], "--engine=threaded") == 0) {
+            engine = Engine::Threaded;
+        } else if (strcmp(argv[i], "--engine=predecoded") == 0) {
+            engine = Engine::Predecoded;
+        } else if (strcmp(argv[i], "--engine=jit") == 0) {
+            engine = Engine::Jit;
+        } else {
+            path = argv[i];
+        }
+    }
+
+    if (path == nullptr) {
+        ASSERT(0, "Usage: 6502_batch [--workers N] [--no-pin] "
+                  "[--engine=table|threaded|predecoded|jit] "
+                  "[--output file] <manifest>")
+    }
+
+    std::ifstream manifest(path);
+    ASSERT(manifest, "Couldn't open " << path)
+    const char* slash = strrchr(path, '/');
+    std::string directory =
+        slash != nullptr ? std::string(path, slash - path) : "";
+
+    std::vector<BatchJob> jobs;
+    std::string error;
+    ASSERT(ParseManifest(manifest, directory, jobs, error),
+           path << ": " << error)
+
+    BatchRunner runner(workers, pin, engine);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<BatchResult> results = runner.Run(jobs);
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+
+    if (output_file != nullptr) {
+        std::ofstream output(output_file);
+        ASSERT(output, "Couldn't open " << output_file)
+        WriteResults(output, jobs, results);
+    } else {
+        WriteResults(std::cout, jobs, results);
+    }
+
+    uint64_t cycles = 0;
+    size_t failed = 0;
+    for (const BatchResult& result : results) {
+        cycles += result.cycles;
+        failed += result.status == BatchStatus::Failed;
+    }
+    std::cerr << jobs.size() << " jobs (" << failed << " failed), " << cycles
+              << " cycles in " << seconds << " s on "
+              << runner.GetWorkerCount() << " workers, "
+              << cycles / seconds / 1e6 << " emulated MHz, "
+              << runner.CountSteals() << " jobs stolen" << std::endl;
+    return failed > 0;
+}
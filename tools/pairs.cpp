@@ -0,0 +1,97 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <handlers.h>
+#include <iomanip>
+#include <iostream>
+#include <trace.h>
+#include <vector>
+
+/**
+ * Count the op_code pairs of binary traces written by BinaryTraceSink and
+ * print the most frequent ones that the predecoded engine can fuse, in the
+ * format of fusion_profile.h. A pair counts when its second instruction
+ * directly follows the first in memory and in time, so interrupts and
+ * branches in between don't.
+ * */
+int main(int argc, char** argv) {
+    size_t top = 16;
+    std::vector<const char*> paths;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--top") == 0 && i + 1 < argc) {
+            top = strtoul(argv[++i], nullptr, 10);
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.empty()) {
+        ASSERT(0, "Usage: 6502_pairs [--top <count>] <trace files>")
+    }
+
+    constexpr std::array<DecodeInfo, 256> decode_table = make_decode_table();
+    const dispatch_table_t handlers = make_isa_table();
+    std::vector<uint64_t> counts(256 * 256);
+    uint64_t total = 0;
+
+    for (const char* path : paths) {
+        FILE* file = fopen(path, "rb");
+        ASSERT(file, "Couldn't open " << path)
+
+        TraceFileHeader header;
+        bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+                     memcmp(header.magic, TRACE_FILE_MAGIC,
+                            sizeof(TRACE_FILE_MAGIC)) == 0 &&
+                     header.version == TRACE_FILE_VERSION &&
+                     header.record_size == sizeof(TraceRecord);
+        ASSERT(valid, path << " is not a version " << TRACE_FILE_VERSION
+                           << " trace file")
+
+        TraceRecord records[4096];
+        TraceRecord previous;
+        bool first = true;
+        size_t count;
+        while ((count = fread(records, sizeof(TraceRecord), 4096, file)) > 0) {
+            for (size_t i = 0; i < count; i++) {
+                const TraceRecord& record = records[i];
+                uint8_t op_code = previous.op_code;
+                if (!first && falls_through(op_code) &&
+                    handlers[op_code] != INST_TRAP &&
+                    handlers[record.op_code] != INST_TRAP &&
+                    uint16_t(previous.pc + decode_table[op_code].length) ==
+                        record.pc) {
+                    counts[op_code << 8 | record.op_code]++;
+                    total++;
+                }
+                previous = record;
+                first = false;
+            }
+        }
+        fclose(file);
+    }
+
+    std::vector<uint32_t> pairs;
+    for (uint32_t pair = 0; pair < counts.size(); pair++) {
+        if (counts[pair] > 0) {
+            pairs.push_back(pair);
+        }
+    }
+    std::sort(pairs.begin(), pairs.end(), [&](uint32_t a, uint32_t b) {
+        return counts[a] > counts[b];
+    });
+    pairs.resize(std::min(pairs.size(), top));
+
+    uint64_t covered = 0;
+    for (uint32_t pair : pairs) {
+        covered += counts[pair];
+    }
+    std::cout << "// " << pairs.size() << " pairs covering " << std::fixed
+              << std::setprecision(1) << 100.0 * covered / std::max(total, 1ul)
+              << "% of " << total << " pairs counted\n";
+    std::cout << "#define FUSION_PROFILE(M)";
+    for (uint32_t pair : pairs) {
+        std::cout << " \\\n    M(" << ToString(Instruction(pair >> 8)) << ", "
+                  << ToString(Instruction(pair & 0xFF)) << ")";
+    }
+    std::cout << "\n";
+    return 0;
+}
@@ -0,0 +1,36 @@
+#include <cstring>
+#include <iostream>
+#include <trace.h>
+
+/**
+ * Render a binary trace written by BinaryTraceSink in the text format of
+ * TextTraceSink.
+ * */
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        ASSERT(0, "Usage: 6502_trace <trace file>")
+    }
+
+    FILE* file = fopen(argv[1], "rb");
+    ASSERT(file, "Couldn't open " << argv[1])
+
+    TraceFileHeader header;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+                 memcmp(header.magic, TRACE_FILE_MAGIC,
+                        sizeof(TRACE_FILE_MAGIC)) == 0 &&
+                 header.version == TRACE_FILE_VERSION &&
+                 header.record_size == sizeof(TraceRecord);
+    ASSERT(valid, argv[1] << " is not a version " << TRACE_FILE_VERSION
+                          << " trace file")
+
+    TraceRecord records[4096];
+    size_t count;
+    while ((count = fread(records, sizeof(TraceRecord), 4096, file)) > 0) {
+        for (size_t i = 0; i < count; i++) {
+            FormatTraceRecord(std::cout, records[i]);
+        }
+    }
+
+    fclose(file);
+    return 0;
+}